@@ -0,0 +1,38 @@
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/sys/barrier.h>
+#include <hal/nrf_gpio.h>
+#include "ppr_ring.h"
+#include "ppr_seq.h"
+#include "ppr_hal.h"
+#include "config.h"
+
+#define PIN_MASK(pin) BIT((pin) & 0x1F)
+
+static ppr_shm *const shm = (ppr_shm *)DT_REG_ADDR(DT_CHOSEN(chronos_ppr_shm));
+static ppr_seq seq;
+
+int main(void) {
+    // Programs may only drive the phase and switch pins, like on the
+    // application core; the DAC bus belongs to the HAL
+    const uint32_t allowed_pins[STIM_PROGRAM_PORTS] = {
+        [PPR_PHASE_PIN >> 5] = PIN_MASK(PPR_PHASE_PIN) | PIN_MASK(PPR_SWITCH0_PIN) |
+                               PIN_MASK(PPR_SWITCH1_PIN),
+    };
+    ppr_msg ready = {.type = PPR_MSG_READY, .seq = PPR_SHM_VERSION};
+
+    ppr_hal_init();
+    ppr_seq_init(&seq, PPR_MIN_DELTA_US * PPR_TICKS_PER_US, allowed_pins);
+    ppr_ring_init(&shm->cmd);
+    ppr_ring_init(&shm->evt);
+    shm->version = PPR_SHM_VERSION;
+    // Both rings are set up before the application core may use them
+    barrier_dmem_fence_full();
+    shm->magic = PPR_SHM_MAGIC;
+    ppr_ring_put(&shm->evt, &ready);
+
+    for (;;) {
+        ppr_seq_poll(&seq, &shm->cmd, &shm->evt);
+    }
+    return 0;
+}
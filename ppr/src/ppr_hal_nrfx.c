@@ -0,0 +1,72 @@
+#include <hal/nrf_gpio.h>
+#include <hal/nrf_timer.h>
+#include <hal/nrf_spim.h>
+#include <zephyr/kernel.h>
+#include "ppr_hal.h"
+#include "ppr_ring.h"
+#include "stim_program.h"
+#include "spi.h"
+#include "config.h"
+
+// Both in the slow global domain, next to the PPR: register accesses take a
+// few cycles and nothing on the application core shares them
+#define PPR_TIMER NRF_TIMER130
+#define PPR_SPIM NRF_SPIM130
+#define PPR_TIMER_CAPTURE NRF_TIMER_CC_CHANNEL0
+
+static NRF_GPIO_Type *const ports[STIM_PROGRAM_PORTS] = {NRF_P0, NRF_P1};
+static const uint32_t dac_cs_pins[] = {0, PPR_DAC1_CS_PIN, PPR_DAC2_CS_PIN};
+static uint8_t dac_tx[DAC_TX_LEN];
+
+void ppr_hal_init(void) {
+    nrf_timer_mode_set(PPR_TIMER, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(PPR_TIMER, NRF_TIMER_BIT_WIDTH_32);
+    nrf_timer_prescaler_set(PPR_TIMER,
+        NRF_TIMER_PRESCALER_CALCULATE(NRF_TIMER_BASE_FREQUENCY_GET(PPR_TIMER),
+                                      PPR_TICKS_PER_US * 1000000));
+    nrf_timer_task_trigger(PPR_TIMER, NRF_TIMER_TASK_CLEAR);
+    nrf_timer_task_trigger(PPR_TIMER, NRF_TIMER_TASK_START);
+
+    nrf_gpio_cfg_output(PPR_PHASE_PIN);
+    nrf_gpio_pin_clear(PPR_PHASE_PIN);
+    nrf_gpio_cfg_output(PPR_SWITCH0_PIN);
+    nrf_gpio_pin_clear(PPR_SWITCH0_PIN);
+    nrf_gpio_cfg_output(PPR_SWITCH1_PIN);
+    nrf_gpio_pin_clear(PPR_SWITCH1_PIN);
+    for (size_t i = STIM_PROGRAM_DAC1; i < ARRAY_SIZE(dac_cs_pins); i++) {
+        nrf_gpio_cfg_output(dac_cs_pins[i]);
+        nrf_gpio_pin_set(dac_cs_pins[i]);   // inactive
+    }
+
+    // Same bus settings as the application core's DAC driver: mode 0, MSB first, 8 MHz
+    nrf_gpio_cfg_output(PPR_SCK_PIN);
+    nrf_gpio_cfg_output(PPR_MOSI_PIN);
+    nrf_gpio_cfg_input(PPR_MISO_PIN, NRF_GPIO_PIN_NOPULL);
+    nrf_spim_pins_set(PPR_SPIM, PPR_SCK_PIN, PPR_MOSI_PIN, PPR_MISO_PIN);
+    nrf_spim_configure(PPR_SPIM, NRF_SPIM_MODE_0, NRF_SPIM_BIT_ORDER_MSB_FIRST);
+    nrf_spim_frequency_set(PPR_SPIM, NRF_SPIM_FREQ_8M);
+    nrf_spim_rx_buffer_set(PPR_SPIM, NULL, 0);
+    nrf_spim_enable(PPR_SPIM);
+}
+
+uint32_t ppr_hal_now(void) {
+    nrf_timer_task_trigger(PPR_TIMER, nrf_timer_capture_task_get(PPR_TIMER_CAPTURE));
+    return nrf_timer_cc_get(PPR_TIMER, PPR_TIMER_CAPTURE);
+}
+
+void ppr_hal_pins(uint8_t port, uint32_t set_mask, uint32_t clr_mask) {
+    nrf_gpio_port_out_set(ports[port], set_mask);
+    nrf_gpio_port_out_clear(ports[port], clr_mask);
+}
+
+void ppr_hal_dac_write(uint8_t dac, uint16_t code) {
+    dac_tx[0] = (code >> 8) & 0xFF;     // MSB
+    dac_tx[1] = code & 0xFF;            // LSB
+    nrf_gpio_pin_clear(dac_cs_pins[dac]);
+    nrf_spim_tx_buffer_set(PPR_SPIM, dac_tx, DAC_TX_LEN);
+    nrf_spim_event_clear(PPR_SPIM, NRF_SPIM_EVENT_END);
+    nrf_spim_task_trigger(PPR_SPIM, NRF_SPIM_TASK_START);
+    while (!nrf_spim_event_check(PPR_SPIM, NRF_SPIM_EVENT_END)) {
+    }
+    nrf_gpio_pin_set(dac_cs_pins[dac]);
+}
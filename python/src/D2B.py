@@ -15,6 +15,7 @@
 # R_SESNSE = 100 Ohm
 ################################################################################
 import math
+import numpy as np
 from numpy import clip
 
 V_REF = 3.3  # Reference voltage for DAC
@@ -29,4 +30,21 @@ def decimal_to_binary(decimal_value, bits=16):
     code = int((DAC + 1) * 32768)  # Convert to 16-bit code
     code = clip(code, 0, 65535)  # Ensure code is within 16-bit range
     #print(f"Code: {code} (Decimal), Hex: {hex(code)}")
-    return code
\ No newline at end of file
+    return code
+
+# Batch version of decimal_to_binary for sweep, envelope and waveform tables.
+# Same arithmetic in the same order on float64, so every element matches the
+# scalar result exactly. Returns little-endian uint16 codes in the shape of
+# the input; .tobytes() gives the u16 codes[] of a BLE payload.
+def decimal_to_binary_array(decimal_values):
+    values = np.asarray(decimal_values, dtype=np.float64)
+    if np.isnan(values).any():
+        raise ValueError("NaN has no DAC code")
+    V_DAC = (values * R_SENSE / 10.0) / 1000000  # Convert uA to V
+    DAC = np.clip(V_DAC / V_REF, -1, 1)  # Normalize to V_REF, clamp to -1 to 1
+    code = np.trunc((DAC + 1) * 32768)  # int() of the scalar version
+    return np.clip(code, 0, 65535).astype('<u2')
+
+# Packed codes, ready for a waveform upload
+def decimal_to_bytes(decimal_values):
+    return decimal_to_binary_array(decimal_values).tobytes()
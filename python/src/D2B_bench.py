@@ -0,0 +1,39 @@
+# Scalar vs batch µA -> DAC code conversion, for the table sizes a sweep or a
+# waveform upload builds.
+#
+#   python3 D2B_bench.py
+#   python3 D2B_bench.py --points 4096 --repeat 20
+import argparse
+import timeit
+
+import numpy as np
+
+import D2B
+
+
+def main():
+    parser = argparse.ArgumentParser(description="D2B scalar vs batch conversion")
+    parser.add_argument("--points", type=int, default=50000)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    values = np.linspace(-1.2 * D2B.MAX_CURRENT, 1.2 * D2B.MAX_CURRENT, args.points)
+    as_list = values.tolist()
+
+    def scalar():
+        return b"".join(int(D2B.decimal_to_binary(v)).to_bytes(2, "little") for v in as_list)
+
+    def batch():
+        return D2B.decimal_to_bytes(values)
+
+    if scalar() != batch():
+        raise SystemExit("batch and scalar codes differ")
+
+    for name, fn in (("scalar", scalar), ("batch", batch)):
+        best = min(timeit.repeat(fn, number=1, repeat=args.repeat))
+        print(f"{name:>6}: {args.points} points in {best * 1000:.2f} ms, "
+              f"{best / args.points * 1e9:.0f} ns/point")
+
+
+if __name__ == "__main__":
+    main()
@@ -2,15 +2,11 @@ import tkinter as tk
 from tkinter import ttk, messagebox
 import asyncio
 import threading
-import struct
-from bleak import BleakClient, BleakScanner
-import logging
 import D2B
+from chronos_client import ChronosClient, BleakTransport
 # install tkinter and bleak if not already installed
-# Nordic UART Service UUIDs
-NUS_SERVICE_UUID = "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
-NUS_RX_CHAR_UUID = "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"  # Write to device
-NUS_TX_CHAR_UUID = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"  # Read from device
+# All BLE work is done by chronos_client on its own asyncio loop thread; the
+# GUI only submits coroutines to it and reports the results.
 
 class NordicBLEGUI:
     def __init__(self, root):
@@ -18,9 +14,8 @@ class NordicBLEGUI:
         self.root.title("Nordic BLE Control - Chronos")
         self.root.geometry("400x550")  # Increased height for new checkbox
         
-        self.client = None
+        self.chronos = None
         self.connected = False
-        self.device_address = None
         
         # Create asyncio event loop for the thread
         self.loop = None
@@ -175,12 +170,8 @@ class NordicBLEGUI:
             frequency = int(self.freq_var.get()) if self.freq_var.get().isdigit() else 100
             
             # 0x8000 = 32768 decimal = 0V output
-            data = struct.pack('<HHH', 0x8000, pulse_width, frequency)
-            
             self.log_message("Sending STOP command: DAC=0V (0x8000)")
-            
-            future = self.run_coroutine(self._send_data(data))
-            threading.Thread(target=self._check_send_result, args=(future,), daemon=True).start()
+            self._send_settings(0x8000, pulse_width, frequency)
             
         except Exception as e:
             self.log_message(f"Stop command error: {str(e)}")
@@ -209,68 +200,38 @@ class NordicBLEGUI:
         self.ble_thread = threading.Thread(target=run_ble_loop, daemon=True)
         self.ble_thread.start()
     
-    def run_coroutine(self, coro):
-        """Run a coroutine in the BLE thread"""
-        if self.loop:
-            future = asyncio.run_coroutine_threadsafe(coro, self.loop)
-            return future
-        return None
+    def run_coroutine(self, coro, on_done=None):
+        """Run a coroutine in the BLE thread; on_done(future) is called on
+        the Tk thread once it has finished"""
+        if not self.loop:
+            coro.close()
+            return None
+        future = asyncio.run_coroutine_threadsafe(coro, self.loop)
+        if on_done:
+            future.add_done_callback(lambda f: self.root.after(0, lambda: on_done(f)))
+        return future
     
     def scan_and_connect(self):
         """Scan for Chronos device and connect"""
         self.scan_button.config(state="disabled")
         self.log_message("Scanning for Chronos device...")
-        
-        future = self.run_coroutine(self._scan_and_connect())
-        if future:
-            # Check result in a separate thread to avoid blocking GUI
-            threading.Thread(target=self._check_connection_result, args=(future,), daemon=True).start()
-    
-    async def _scan_and_connect(self):
-        """Async scan and connect"""
-        try:
-            devices = await BleakScanner.discover(timeout=10.0)
-            chronos_device = None
-            
-            for device in devices:
-                if device.name and "Chronos" in device.name:
-                    chronos_device = device
-                    break
-            
-            if not chronos_device:
-                self.root.after(0, lambda: self.log_message("Chronos device not found"))
-                self.root.after(0, lambda: self.scan_button.config(state="normal"))
-                return False
-            
-            self.device_address = chronos_device.address
-            self.root.after(0, lambda: self.log_message(f"Found Chronos: {chronos_device.address}"))
-            
-            # Connect to device
-            self.client = BleakClient(chronos_device.address)
-            await self.client.connect()
-            
-            if self.client.is_connected:
-                self.connected = True
-                self.root.after(0, self._update_connection_status)
-                self.root.after(0, lambda: self.log_message("Connected successfully!"))
-                return True
-            else:
-                self.root.after(0, lambda: self.log_message("Failed to connect"))
-                self.root.after(0, lambda: self.scan_button.config(state="normal"))
-                return False
-                
-        except Exception as e:
-            self.root.after(0, lambda: self.log_message(f"Connection error: {str(e)}"))
-            self.root.after(0, lambda: self.scan_button.config(state="normal"))
-            return False
-    
-    def _check_connection_result(self, future):
-        """Check the connection result (runs in separate thread)"""
-        try:
-            result = future.result(timeout=15.0)  # Wait up to 15 seconds
-        except Exception as e:
-            self.root.after(0, lambda: self.log_message(f"Connection timeout: {str(e)}"))
-            self.root.after(0, lambda: self.scan_button.config(state="normal"))
+        self.chronos = ChronosClient(BleakTransport())
+        self.run_coroutine(self.chronos.connect(), self._on_connected)
+
+    def _on_connected(self, future):
+        """Connection result (Tk thread)"""
+        error = future.exception()
+        if error:
+            self.log_message(f"Connection error: {str(error)}")
+            self.chronos = None
+            self.scan_button.config(state="normal")
+            return
+        self.connected = True
+        self.chronos.subscribe_text(
+            lambda data: self.log_message(data.decode(errors="replace").rstrip()))
+        self.log_message(f"Found Chronos: {self.chronos.transport.address}")
+        self.log_message("Connected successfully!")
+        self._update_connection_status()
     
     def _update_connection_status(self):
         """Update GUI connection status (called from main thread)"""
@@ -291,27 +252,19 @@ class NordicBLEGUI:
     
     def disconnect(self):
         """Disconnect from device"""
-        if self.client and self.connected:
-            future = self.run_coroutine(self._disconnect())
-            threading.Thread(target=self._check_disconnect_result, args=(future,), daemon=True).start()
-    
-    async def _disconnect(self):
-        """Async disconnect"""
-        try:
-            await self.client.disconnect()
-            self.connected = False
-            self.client = None
-            self.root.after(0, self._update_connection_status)
-            self.root.after(0, lambda: self.log_message("Disconnected"))
-        except Exception as e:
-            self.root.after(0, lambda: self.log_message(f"Disconnect error: {str(e)}"))
+        if self.chronos and self.connected:
+            self.run_coroutine(self.chronos.disconnect(), self._on_disconnected)
     
-    def _check_disconnect_result(self, future):
-        """Check disconnect result"""
-        try:
-            future.result(timeout=5.0)
-        except Exception as e:
-            self.root.after(0, lambda: self.log_message(f"Disconnect timeout: {str(e)}"))
+    def _on_disconnected(self, future):
+        """Disconnect result (Tk thread)"""
+        error = future.exception()
+        if error:
+            self.log_message(f"Disconnect error: {str(error)}")
+            return
+        self.connected = False
+        self.chronos = None
+        self._update_connection_status()
+        self.log_message("Disconnected")
     
     def send_parameters(self):
         """Send stimulation parameters to device"""
@@ -338,12 +291,7 @@ class NordicBLEGUI:
                 dac_binary = D2B.decimal_to_binary(dac_amp)
                 self.log_message(f"Stimulation ENABLED - Sending: DAC={dac_amp}μA, Pulse={pulse_width}μs, Freq={frequency}Hz")
             
-            # Pack data as little-endian uint16 values (matching C struct)
-            data = struct.pack('<HHH', dac_binary, pulse_width, frequency)
-            
-            # Send data
-            future = self.run_coroutine(self._send_data(data))
-            threading.Thread(target=self._check_send_result, args=(future,), daemon=True).start()
+            self._send_settings(dac_binary, pulse_width, frequency)
             
         except ValueError as e:
             messagebox.showerror("Input Error", str(e))
@@ -351,26 +299,21 @@ class NordicBLEGUI:
         except Exception as e:
             self.log_message(f"Send error: {str(e)}")
     
-    async def _send_data(self, data):
-        """Async send data"""
-        try:
-            if self.client and self.connected:
-                await self.client.write_gatt_char(NUS_RX_CHAR_UUID, data)
-                self.root.after(0, lambda: self.log_message("Data sent successfully"))
-                return True
-            else:
-                self.root.after(0, lambda: self.log_message("Not connected to device"))
-                return False
-        except Exception as e:
-            self.root.after(0, lambda: self.log_message(f"Send failed: {str(e)}"))
-            return False
-    
-    def _check_send_result(self, future):
-        """Check send result"""
-        try:
-            future.result(timeout=5.0)
-        except Exception as e:
-            self.root.after(0, lambda: self.log_message(f"Send timeout: {str(e)}"))
+    def _send_settings(self, dac_code, pulse_width, frequency):
+        """Queue a settings write; a newer one replaces it while it waits"""
+        if not (self.chronos and self.connected):
+            self.log_message("Not connected to device")
+            return
+        self.run_coroutine(self.chronos.send_settings(dac_code, pulse_width, frequency),
+                           self._on_sent)
+
+    def _on_sent(self, future):
+        """Send result (Tk thread)"""
+        error = future.exception()
+        if error:
+            self.log_message(f"Send failed: {str(error)}")
+        else:
+            self.log_message("Data sent successfully")
     
     def on_closing(self):
         """Handle window closing"""
@@ -0,0 +1,171 @@
+# Decoder for the Chronos flash black box (CONFIG_CHRONOS_BLACKBOX).
+#
+#   python3 blackbox_decode.py --read --save box.bin   # read out a board
+#   python3 blackbox_decode.py box.bin                  # decode a saved readout
+#   python3 blackbox_decode.py --page-size 4096 dump.bin  # raw partition dump
+#
+# The partition is a ring of 240-byte blocks that never cross a flash page
+# (see src/blackbox_block.h in the firmware). A readout streams the valid
+# blocks, oldest first, each as one notification behind a 4-byte header, and
+# ends with a header-only frame carrying BLACKBOX_FRAME_LAST.
+################################################################################
+# block:   u32 magic "CBB1", u32 seq, u16 record count, u16 crc, u32 reserved,
+#          then up to 14 records, 0xFF padded
+# record:  u32 timestamp (ms), u8 type, u8 index, u16 reserved, u32 value[2]
+# frame:   u8 0xC9, u8 flags, u16 frame seq, block
+################################################################################
+import argparse
+import asyncio
+import binascii
+import struct
+from collections import namedtuple
+
+
+BLACKBOX_BLOCK_MAGIC = 0x31424243
+BLACKBOX_BLOCK_LEN = 240
+BLACKBOX_HEADER_LEN = 16
+BLACKBOX_RECORD_LEN = 16
+BLACKBOX_BLOCK_RECORDS = (BLACKBOX_BLOCK_LEN - BLACKBOX_HEADER_LEN) // BLACKBOX_RECORD_LEN
+BLACKBOX_FRAME_MAGIC = 0xC9
+BLACKBOX_FRAME_HEADER_LEN = 4
+BLACKBOX_FRAME_LAST = 0x01
+
+BLACKBOX_BOOT = 1           # value0: seq of the first block of this boot
+BLACKBOX_SETTING = 2        # value0: frequency << 16 | pulse width, value1: DAC code
+BLACKBOX_PULSES = 3         # value0: pulses since boot, value1: since the last record
+BLACKBOX_SPI_ERROR = 4      # value0: nrfx error, value1: chip select pin
+BLACKBOX_CONNECTED = 5
+BLACKBOX_DISCONNECTED = 6   # index: HCI reason
+BLACKBOX_DROPPED = 7        # value0: records lost since boot, value1: since the last record
+
+BlackboxRecord = namedtuple("BlackboxRecord", "seq timestamp type index value0 value1")
+
+
+def block_crc(seq, count, records):
+    """CRC-16/ITU-T seeded with 0xFFFF, as crc16_itu_t in the firmware"""
+    return binascii.crc_hqx(struct.pack('<IH', seq, count) + records, 0xFFFF)
+
+
+def decode_block(block):
+    """(seq, [BlackboxRecord]) of a written block, None for an erased or
+    damaged one"""
+    if len(block) != BLACKBOX_BLOCK_LEN:
+        return None
+    magic, seq, count, crc, _ = struct.unpack_from('<IIHHI', block)
+    if magic != BLACKBOX_BLOCK_MAGIC or not 0 < count <= BLACKBOX_BLOCK_RECORDS:
+        return None
+    body = bytes(block[BLACKBOX_HEADER_LEN:BLACKBOX_HEADER_LEN + count * BLACKBOX_RECORD_LEN])
+    if crc != block_crc(seq, count, body):
+        return None
+    records = []
+    for i in range(count):
+        timestamp, rtype, index, _, value0, value1 = struct.unpack_from(
+            '<IBBHII', body, i * BLACKBOX_RECORD_LEN)
+        records.append(BlackboxRecord(seq, timestamp, rtype, index, value0, value1))
+    return seq, records
+
+
+def decode_frame(frame):
+    """(frame_seq, last, block) of a readout notification, block None on the
+    last one. Returns None for anything else."""
+    if len(frame) < BLACKBOX_FRAME_HEADER_LEN or frame[0] != BLACKBOX_FRAME_MAGIC:
+        return None
+    flags = frame[1]
+    frame_seq = struct.unpack_from('<H', frame, 2)[0]
+    block = bytes(frame[BLACKBOX_FRAME_HEADER_LEN:])
+    if flags & BLACKBOX_FRAME_LAST:
+        return frame_seq, True, None
+    if len(block) != BLACKBOX_BLOCK_LEN:
+        return None
+    return frame_seq, False, block
+
+
+def split_image(data, page_size=0):
+    """The blocks of a raw partition dump, laid out as the firmware does.
+    page_size 0 is a saved readout: blocks back to back."""
+    blocks = []
+    if page_size:
+        per_page = page_size // BLACKBOX_BLOCK_LEN
+        for page in range(0, len(data) - page_size + 1, page_size):
+            for i in range(per_page):
+                offset = page + i * BLACKBOX_BLOCK_LEN
+                blocks.append(data[offset:offset + BLACKBOX_BLOCK_LEN])
+    else:
+        for offset in range(0, len(data) - BLACKBOX_BLOCK_LEN + 1, BLACKBOX_BLOCK_LEN):
+            blocks.append(data[offset:offset + BLACKBOX_BLOCK_LEN])
+    return blocks
+
+
+def decode_blocks(blocks):
+    """Records of every valid block, oldest block first. seq wraps around,
+    so the order counts back from the newest block."""
+    decoded = [d for d in (decode_block(b) for b in blocks) if d is not None]
+    if not decoded:
+        return []
+    newest = decoded[0][0]
+    for seq, _ in decoded:
+        if (seq - newest) & 0xFFFFFFFF < 0x80000000:
+            newest = seq
+    decoded.sort(key=lambda d: (newest - d[0]) & 0xFFFFFFFF, reverse=True)
+    return [record for _, records in decoded for record in records]
+
+
+def decode_image(data, page_size=0):
+    return decode_blocks(split_image(data, page_size))
+
+
+def format_record(record):
+    """One line per record, as the serial console would print it"""
+    head = f"[{record.timestamp / 1000:12.3f} s] #{record.seq:<6} "
+    if record.type == BLACKBOX_BOOT:
+        return head + "boot"
+    if record.type == BLACKBOX_SETTING:
+        frequency, pulse_width = record.value0 >> 16, record.value0 & 0xFFFF
+        return head + f"setting {frequency} Hz, {pulse_width} us, DAC 0x{record.value1:04X}"
+    if record.type == BLACKBOX_PULSES:
+        return head + f"{record.value0} pulses (+{record.value1})"
+    if record.type == BLACKBOX_SPI_ERROR:
+        return head + f"SPI error 0x{record.value0:08X}, CS pin {record.value1}"
+    if record.type == BLACKBOX_CONNECTED:
+        return head + "connected"
+    if record.type == BLACKBOX_DISCONNECTED:
+        return head + f"disconnected, reason 0x{record.index:02X}"
+    if record.type == BLACKBOX_DROPPED:
+        return head + f"{record.value1} records dropped ({record.value0} since boot)"
+    return head + (f"type {record.type} index {record.index} "
+                   f"0x{record.value0:08X} 0x{record.value1:08X}")
+
+
+async def read_device(address):
+    import chronos_client as cc
+    async with cc.ChronosClient(cc.BleakTransport(address=address)) as client:
+        return await client.read_blackbox()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the Chronos flash black box")
+    parser.add_argument("file", nargs="?", help="saved readout, or partition dump with --page-size")
+    parser.add_argument("--read", action="store_true", help="read out a board over BLE")
+    parser.add_argument("--address", help="BLE address; the cached one otherwise")
+    parser.add_argument("--save", help="write the blocks read to this file")
+    parser.add_argument("--page-size", type=int, default=0,
+                        help="flash page size of a raw partition dump")
+    args = parser.parse_args()
+
+    if args.read:
+        blocks = asyncio.run(read_device(args.address))
+        if args.save:
+            with open(args.save, "wb") as f:
+                f.write(b"".join(blocks))
+        records = decode_blocks(blocks)
+    elif args.file:
+        with open(args.file, "rb") as f:
+            records = decode_image(f.read(), args.page_size)
+    else:
+        parser.error("give a file or --read")
+    for record in records:
+        print(format_record(record))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+# Command throughput and write->apply latency of the Chronos client.
+#
+#   python3 chronos_bench.py                      # against the mock link
+#   python3 chronos_bench.py --address XX:XX:...  # against a board
+#
+# Each command is a settings write with its own DAC code. The device reports
+# the code of every pulse in its TELEMETRY_PULSE records, so the first record
+# carrying a code marks the pulse where that setting was applied. Latency is
+# taken up to the arrival of that record, so it includes the wait for the
+# next pulse boundary and the telemetry flush. It is reported twice:
+#   submit->apply  from submit_settings, including the time in the queue
+#   write->apply   from the hand-off of the write to the stack
+# A setting that a later one replaces before the next pulse is never applied
+# and is counted as superseded.
+import argparse
+import asyncio
+import statistics
+
+import chronos_client as cc
+import chronos_mock
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+async def run(client, count, frequency, pulse_width, gap_ms):
+    loop = asyncio.get_running_loop()
+    submitted = {}
+    written = {}
+    latencies = {"submit->apply": [], "write->apply": []}
+
+    def on_telemetry(frame_seq, records):
+        now = loop.time()
+        for record in records:
+            if record.type != cc.TELEMETRY_PULSE:
+                continue
+            code = record.value1 >> 16
+            if code in submitted:
+                latencies["submit->apply"].append(now - submitted.pop(code))
+                latencies["write->apply"].append(now - written.pop(code))
+
+    def on_written(code):
+        return lambda future: written.__setitem__(code, loop.time())
+
+    await client.set_telemetry(True)
+    client.subscribe_telemetry(on_telemetry)
+    # Codes 0x8001.. so every command is told apart from the idle 0x8000
+    start = loop.time()
+    for i in range(count):
+        code = 0x8001 + i
+        submitted[code] = loop.time()
+        future = client.submit_settings(code, pulse_width, frequency, coalesce=False)
+        future.add_done_callback(on_written(code))
+        if gap_ms:
+            await asyncio.sleep(gap_ms / 1000.0)
+    await client.drain()
+    elapsed = loop.time() - start
+    # Last pulse boundary plus the telemetry flush
+    await asyncio.sleep(2.0 / frequency + 0.1)
+    await client.set_telemetry(False)
+    return elapsed, latencies
+
+
+def report(label, count, elapsed, latencies):
+    print(f"{label}: {count} commands in {elapsed * 1000:.1f} ms, {count / elapsed:.0f} commands/s")
+    for name, values in latencies.items():
+        if values:
+            ms = [latency * 1000 for latency in values]
+            print(f"  {name} latency (ms) n: {len(ms)} min: {min(ms):.2f} "
+                  f"p50: {statistics.median(ms):.2f} p99: {percentile(ms, 99):.2f} max: {max(ms):.2f}")
+    print(f"  superseded before the next pulse: {count - len(latencies['write->apply'])}")
+
+
+async def main():
+    parser = argparse.ArgumentParser(
+        description="Chronos command throughput and write->apply latency")
+    parser.add_argument("--address", help="BLE address of a board; the mock link otherwise")
+    parser.add_argument("--count", type=int, default=200)
+    parser.add_argument("--frequency", type=int, default=1000, help="pulse frequency (Hz)")
+    parser.add_argument("--pulse-width", type=int, default=100, help="us")
+    parser.add_argument("--gap-ms", type=float, default=0.0,
+                        help="pause between submissions, 0 for back to back")
+    parser.add_argument("--interval-ms", type=float, default=7.5,
+                        help="mock connection interval")
+    args = parser.parse_args()
+
+    for response in (False, True):
+        if args.address:
+            transport = cc.BleakTransport(address=args.address)
+        else:
+            transport = chronos_mock.MockTransport(interval_ms=args.interval_ms,
+                                                   frequency=args.frequency)
+        async with cc.ChronosClient(transport, response=response) as client:
+            elapsed, latencies = await run(client, args.count, args.frequency,
+                                           args.pulse_width, args.gap_ms)
+        label = "write with response" if response else "write without response"
+        report(label, args.count, elapsed, latencies)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
@@ -0,0 +1,394 @@
+# Headless asyncio client for Chronos over the Nordic UART Service (NUS).
+# Everything the GUI does can be scripted with it:
+#
+#   async with ChronosClient() as chronos:
+#       await chronos.set_telemetry(True)
+#       chronos.subscribe_telemetry(print)
+#       await chronos.send_settings(D2B.decimal_to_binary(500), 200, 100)
+#
+# Writes go through one queue drained by a single writer task, so callers can
+# submit many updates without waiting on each one (pipelining). By default
+# they use write without response, which lets the stack put several writes
+# into one connection event instead of one per round trip.
+################################################################################
+# Wire format (see src/data.h and src/telemetry_frame.h in the firmware):
+# settings write: u16 DAC code, u16 pulse width (us), u16 frequency (Hz)
+# command:        u8 0xC7, u8 opcode, u16 seq, payload
+# timed settings: command 0x41, u32 host time (us), settings write
+# telemetry:      u8 0xC8, u8 record count, u16 frame seq, 16-byte records
+# black box:      u8 0xC9, u8 flags, u16 frame seq, 240-byte block (blackbox_decode.py)
+################################################################################
+import asyncio
+import json
+import os
+import struct
+from collections import namedtuple
+
+import blackbox_decode
+
+NUS_SERVICE_UUID = "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
+NUS_RX_CHAR_UUID = "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"  # Write to device
+NUS_TX_CHAR_UUID = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"  # Read from device
+DEVICE_NAME = "Chronos"
+DEFAULT_CACHE_PATH = os.path.join(os.path.expanduser("~"), ".chronos_device.json")
+
+CMD_MAGIC = 0xC7
+CMD_WAVEFORM_BEGIN = 0x10
+CMD_WAVEFORM_DATA = 0x11
+CMD_WAVEFORM_COMMIT = 0x12
+CMD_CHANNEL_SET = 0x20
+CMD_PROGRAM_BEGIN = 0x30
+CMD_PROGRAM_DATA = 0x31
+CMD_PROGRAM_COMMIT = 0x32
+CMD_TELEMETRY = 0x40
+CMD_SETTINGS_TIMED = 0x41
+CMD_BURST_SET = 0x50
+CMD_PROFILE_SAVE = 0x60
+CMD_PROFILE_SELECT = 0x61
+CMD_PROFILE_DELETE = 0x62
+CMD_BLACKBOX_READ = 0x70
+PROFILE_NAME_LEN = 16
+PROGRAM_ENTRY_LEN = 16  # u32 delta_us, u32 set, u32 clr, u16 code, u8 port, u8 dac
+
+TELEMETRY_MAGIC = 0xC8
+TELEMETRY_HEADER_LEN = 4
+TELEMETRY_RECORD_LEN = 16
+TELEMETRY_PULSE = 1     # value0: pulse count, value1: DAC1 code << 16 | DAC2 code
+TELEMETRY_JITTER = 2    # index: compare event, value0: p99, value1: max (ticks)
+TELEMETRY_CHARGE = 3    # index: alert flags, value0/1: cathodic/anodic charge
+TELEMETRY_BURST = 4     # value0: burst number, value1: pulses delivered
+TELEMETRY_LATENCY = 5   # index: LATENCY_* stage, value0: command seq
+LATENCY_RX = 0          # value1: host time (us) the command carried
+LATENCY_APPLY = 1
+LATENCY_PULSE = 2       # value1: pulse count
+TELEMETRY_CLOCK_HZ = 64000000   # record timestamps: DWT CYCCNT of the app core
+
+SETTINGS_FORMAT = '<HHH'
+SETTINGS_LEN = struct.calcsize(SETTINGS_FORMAT)
+
+TelemetryRecord = namedtuple("TelemetryRecord", "timestamp type index value0 value1")
+
+
+def encode_settings(dac_code, pulse_width, frequency):
+    """Pack a stim_setting write (little-endian, like the C struct)"""
+    return struct.pack(SETTINGS_FORMAT, dac_code, pulse_width, frequency)
+
+
+def decode_settings(data):
+    """Inverse of encode_settings: (dac_code, pulse_width, frequency)"""
+    return struct.unpack(SETTINGS_FORMAT, data)
+
+
+def encode_command(opcode, payload=b"", seq=0):
+    """Prefix a command payload with its cmd_header"""
+    return struct.pack('<BBH', CMD_MAGIC, opcode, seq & 0xFFFF) + bytes(payload)
+
+
+def encode_program_begin(entry_count):
+    """CMD_PROGRAM_BEGIN payload. The reserved u16 keeps the command 8 bytes
+    long: a 6-byte write is always taken for settings."""
+    return struct.pack('<HH', entry_count, 0)
+
+
+def decode_telemetry(frame):
+    """Split a telemetry notification into (frame_seq, [TelemetryRecord]).
+    Returns None for anything else, e.g. the UART bridge text."""
+    if len(frame) < TELEMETRY_HEADER_LEN or frame[0] != TELEMETRY_MAGIC:
+        return None
+    count = frame[1]
+    frame_seq = struct.unpack_from('<H', frame, 2)[0]
+    if len(frame) != TELEMETRY_HEADER_LEN + count * TELEMETRY_RECORD_LEN:
+        return None
+    records = []
+    for i in range(count):
+        offset = TELEMETRY_HEADER_LEN + i * TELEMETRY_RECORD_LEN
+        timestamp, rtype, index, _, value0, value1 = struct.unpack_from('<IBBHII', frame, offset)
+        records.append(TelemetryRecord(timestamp, rtype, index, value0, value1))
+    return frame_seq, records
+
+
+class BleakTransport:
+    """NUS link to a real device through bleak. The address of the last
+    device found is cached on disk, so reconnecting skips the scan."""
+
+    def __init__(self, address=None, name=DEVICE_NAME, cache_path=DEFAULT_CACHE_PATH,
+                 scan_timeout=10.0):
+        self.address = address
+        self.name = name
+        self.cache_path = cache_path
+        self.scan_timeout = scan_timeout
+        self.client = None
+
+    def _cached_address(self):
+        try:
+            with open(self.cache_path) as f:
+                return json.load(f).get(self.name)
+        except (OSError, ValueError):
+            return None
+
+    def _cache_address(self, address):
+        if not self.cache_path:
+            return
+        try:
+            with open(self.cache_path) as f:
+                cache = json.load(f)
+        except (OSError, ValueError):
+            cache = {}
+        cache[self.name] = address
+        try:
+            with open(self.cache_path, "w") as f:
+                json.dump(cache, f)
+        except OSError:
+            pass
+
+    async def _find_device(self):
+        # bleak is only needed for real hardware
+        from bleak import BleakScanner
+
+        address = self.address or (self.cache_path and self._cached_address())
+        if address:
+            device = await BleakScanner.find_device_by_address(address, timeout=self.scan_timeout / 2)
+            if device:
+                return device
+        return await BleakScanner.find_device_by_filter(
+            lambda device, adv: bool(device.name and self.name in device.name),
+            timeout=self.scan_timeout)
+
+    async def connect(self):
+        from bleak import BleakClient
+
+        device = await self._find_device()
+        if device is None:
+            raise ConnectionError(f"{self.name} device not found")
+        self.client = BleakClient(device)
+        await self.client.connect()
+        self.address = device.address
+        self._cache_address(device.address)
+
+    async def disconnect(self):
+        if self.client:
+            await self.client.disconnect()
+            self.client = None
+
+    @property
+    def is_connected(self):
+        return bool(self.client and self.client.is_connected)
+
+    @property
+    def mtu(self):
+        return self.client.mtu_size if self.client else 23
+
+    async def write(self, data, response):
+        await self.client.write_gatt_char(NUS_RX_CHAR_UUID, data, response=response)
+
+    async def start_notify(self, callback):
+        await self.client.start_notify(NUS_TX_CHAR_UUID, lambda _, data: callback(bytes(data)))
+
+
+class _Write:
+    __slots__ = ("data", "future")
+
+    def __init__(self, data, future):
+        self.data = data
+        self.future = future
+
+
+class ChronosClient:
+    """Async Chronos client. The transport defaults to BLE through bleak;
+    chronos_mock.MockTransport stands in for a device in tests and
+    benchmarks."""
+
+    def __init__(self, transport=None, response=False):
+        self.transport = transport if transport is not None else BleakTransport()
+        self.response = response
+        self._queue = None
+        self._writer = None
+        self._pending_settings = None   # queued settings write that may be coalesced
+        self._seq = 0
+        self._telemetry_callbacks = []
+        self._text_callbacks = []
+        self._blackbox_callback = None
+
+    async def __aenter__(self):
+        await self.connect()
+        return self
+
+    async def __aexit__(self, *exc):
+        await self.disconnect()
+
+    @property
+    def is_connected(self):
+        return self.transport.is_connected
+
+    async def connect(self):
+        await self.transport.connect()
+        await self.transport.start_notify(self._on_notification)
+        self._queue = asyncio.Queue()
+        self._writer = asyncio.get_running_loop().create_task(self._write_loop())
+
+    async def disconnect(self):
+        """Flush the queued writes, then drop the link"""
+        if self._writer:
+            if self.transport.is_connected:
+                await self.drain()
+            self._writer.cancel()
+            try:
+                await self._writer
+            except asyncio.CancelledError:
+                pass
+            self._writer = None
+            self._fail_queued(ConnectionError("disconnected"))
+        await self.transport.disconnect()
+
+    def _fail_queued(self, error):
+        while self._queue and not self._queue.empty():
+            write = self._queue.get_nowait()
+            if not write.future.done():
+                write.future.set_exception(error)
+            self._queue.task_done()
+        self._pending_settings = None
+
+    async def _write_loop(self):
+        while True:
+            write = await self._queue.get()
+            if write is self._pending_settings:
+                self._pending_settings = None
+            try:
+                await self.transport.write(write.data, self.response)
+                if not write.future.done():
+                    write.future.set_result(True)
+            except Exception as e:
+                if not write.future.done():
+                    # Without the traceback: it holds this task's live frame
+                    write.future.set_exception(e.with_traceback(None))
+            finally:
+                self._queue.task_done()
+
+    def _enqueue(self, data):
+        if self._queue is None:
+            raise ConnectionError("not connected")
+        write = _Write(bytes(data), asyncio.get_running_loop().create_future())
+        self._queue.put_nowait(write)
+        return write
+
+    def submit(self, data):
+        """Queue one write and return a future that completes once the
+        write has been handed to the stack. Writes leave in submit order."""
+        return self._enqueue(data).future
+
+    async def send(self, data):
+        await self.submit(data)
+
+    def submit_settings(self, dac_code, pulse_width, frequency, coalesce=True):
+        """Queue a settings write. With coalesce, a settings write that is
+        still queued is updated in place instead, as the device only ever
+        applies the latest one."""
+        data = encode_settings(dac_code, pulse_width, frequency)
+        if coalesce and self._pending_settings is not None:
+            self._pending_settings.data = data
+            return self._pending_settings.future
+        write = self._enqueue(data)
+        if coalesce:
+            self._pending_settings = write
+        return write.future
+
+    async def send_settings(self, dac_code, pulse_width, frequency):
+        await self.submit_settings(dac_code, pulse_width, frequency)
+
+    def submit_command(self, opcode, payload=b""):
+        self._seq = (self._seq + 1) & 0xFFFF
+        return self.submit(encode_command(opcode, payload, self._seq))
+
+    def submit_timed_settings(self, dac_code, pulse_width, frequency, host_time_us):
+        """Queue a settings write the device reports on: TELEMETRY_LATENCY
+        records for its receipt, its apply and the first pulse on it, all
+        carrying the command seq. Never coalesced. Returns (seq, future)."""
+        payload = struct.pack('<I', host_time_us & 0xFFFFFFFF)
+        future = self.submit_command(CMD_SETTINGS_TIMED,
+                                     payload + encode_settings(dac_code, pulse_width, frequency))
+        return self._seq, future
+
+    async def set_telemetry(self, enable):
+        await self.submit_command(CMD_TELEMETRY, bytes([1 if enable else 0]))
+
+    async def set_burst(self, pulses, burst_period_ms, train_on_s=0, train_off_s=0):
+        """pulses 0 returns to a continuous train"""
+        payload = struct.pack('<HHHH', pulses, burst_period_ms, train_on_s, train_off_s)
+        await self.submit_command(CMD_BURST_SET, payload)
+
+    async def upload_program(self, entries):
+        """Load a pulse program, a list of PROGRAM_ENTRY_LEN-byte entries, and
+        commit it. Entries are sent in as few writes as the MTU allows."""
+        per_write = max(1, (self.transport.mtu - 3 - 4 - 2) // PROGRAM_ENTRY_LEN)
+        self.submit_command(CMD_PROGRAM_BEGIN, encode_program_begin(len(entries)))
+        for offset in range(0, len(entries), per_write):
+            chunk = b"".join(bytes(entry) for entry in entries[offset:offset + per_write])
+            self.submit_command(CMD_PROGRAM_DATA, struct.pack('<H', offset) + chunk)
+        await self.submit_command(CMD_PROGRAM_COMMIT)
+
+    async def save_profile(self, slot, name):
+        """Store the device's current setting as a named profile"""
+        encoded = name.encode("utf-8")[:PROFILE_NAME_LEN - 1]
+        payload = bytes([slot]) + encoded.ljust(PROFILE_NAME_LEN, b"\0")
+        await self.submit_command(CMD_PROFILE_SAVE, payload)
+
+    async def select_profile(self, slot):
+        await self.submit_command(CMD_PROFILE_SELECT, bytes([slot]))
+
+    async def delete_profile(self, slot):
+        await self.submit_command(CMD_PROFILE_DELETE, bytes([slot]))
+
+    async def read_blackbox(self, timeout=30.0):
+        """Read out the device's flash black box: the raw blocks, oldest
+        first, for blackbox_decode.decode_blocks. The frames ride the
+        telemetry link, so the MTU must allow a 244-byte notification."""
+        done = asyncio.get_running_loop().create_future()
+        blocks = []
+
+        def on_frame(frame_seq, last, block):
+            if done.done():
+                return
+            if frame_seq != len(blocks):
+                done.set_exception(ConnectionError(f"black box frame {len(blocks)} lost"))
+            elif last:
+                done.set_result(blocks)
+            else:
+                blocks.append(block)
+
+        self._blackbox_callback = on_frame
+        try:
+            await self.submit_command(CMD_BLACKBOX_READ)
+            return await asyncio.wait_for(done, timeout)
+        finally:
+            self._blackbox_callback = None
+
+    async def drain(self):
+        """Wait until every queued write has been handed to the stack"""
+        if self._queue:
+            await self._queue.join()
+
+    def subscribe_telemetry(self, callback):
+        """callback(frame_seq, records) for every telemetry notification.
+        Returns a function that removes the subscription."""
+        self._telemetry_callbacks.append(callback)
+        return lambda: self._telemetry_callbacks.remove(callback)
+
+    def subscribe_text(self, callback):
+        """callback(bytes) for every other notification (UART bridge)"""
+        self._text_callbacks.append(callback)
+        return lambda: self._text_callbacks.remove(callback)
+
+    def _on_notification(self, data):
+        if data and data[0] == blackbox_decode.BLACKBOX_FRAME_MAGIC:
+            frame = blackbox_decode.decode_frame(data)
+            if frame is not None:
+                if self._blackbox_callback:
+                    self._blackbox_callback(*frame)
+                return
+        decoded = decode_telemetry(data)
+        if decoded is not None:
+            for callback in list(self._telemetry_callbacks):
+                callback(*decoded)
+        else:
+            for callback in list(self._text_callbacks):
+                callback(data)
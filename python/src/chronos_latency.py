@@ -0,0 +1,162 @@
+# End-to-end latency of settings updates, from the host write to the DAC.
+#
+#   python3 chronos_latency.py                      # against the mock link
+#   python3 chronos_latency.py --address XX:XX:...  # against a board
+#
+# Each update is a timed settings command (CMD_SETTINGS_TIMED) carrying the
+# host time it was submitted. The device answers with three
+# TELEMETRY_LATENCY records, stamped on its own clock:
+#   RX     the BLE write reaching bt_receive_cb
+#   APPLY  the command work queue committing the setting
+#   PULSE  the first pulse on it, DAC already written
+# so the total splits into
+#   transit     submit -> RX: the client queue, the stack and the air
+#   queueing    RX -> APPLY: the firmware command path
+#   pulse wait  APPLY -> PULSE: the wait for the next pulse boundary
+# Transit crosses the two clocks. Their offset is bounded from above by the
+# RX stamps (a write cannot arrive before it was sent) and from below by the
+# notifications (a record cannot arrive before it was made); the estimate is
+# the middle of the two, good to about half a connection interval.
+import argparse
+import asyncio
+import statistics
+from collections import namedtuple
+
+import chronos_client as cc
+import chronos_mock
+
+LatencySample = namedtuple("LatencySample", "seq total transit queueing pulse_wait")
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+class LatencyTracker:
+    """Collects the TELEMETRY_LATENCY records of a run and splits each
+    update's latency. Times are in seconds; arrival is the host clock the
+    submitted host times were taken on."""
+
+    def __init__(self, clock_hz=cc.TELEMETRY_CLOCK_HZ):
+        self.clock_hz = clock_hz
+        self.stages = {}            # seq -> {stage: device time}
+        self.host_times = {}        # seq -> submit time, from the RX record
+        self.offset_max = None      # device clock - host clock, upper bound
+        self.offset_min = None      # and lower bound
+        self._last_cycles = None
+        self._cycles = 0
+
+    def _device_time(self, timestamp):
+        # CYCCNT wraps every 67 s at 64 MHz; records arrive close to in order
+        if self._last_cycles is None:
+            self._cycles = timestamp
+        else:
+            delta = (timestamp - self._last_cycles) & 0xFFFFFFFF
+            self._cycles += delta - (1 << 32) if delta & 0x80000000 else delta
+        self._last_cycles = timestamp
+        return self._cycles / self.clock_hz
+
+    def on_telemetry(self, records, arrival):
+        for record in records:
+            device_time = self._device_time(record.timestamp)
+            bound = device_time - arrival
+            if self.offset_min is None or bound > self.offset_min:
+                self.offset_min = bound
+            if record.type != cc.TELEMETRY_LATENCY:
+                continue
+            seq = record.value0 & 0xFFFF
+            self.stages.setdefault(seq, {})[record.index] = device_time
+            if record.index == cc.LATENCY_RX:
+                # The u32 of microseconds wraps; it was sent shortly before
+                now_us = int(arrival * 1e6)
+                host_time = (now_us - ((now_us - record.value1) & 0xFFFFFFFF)) / 1e6
+                self.host_times[seq] = host_time
+                bound = device_time - host_time
+                if self.offset_max is None or bound < self.offset_max:
+                    self.offset_max = bound
+
+    @property
+    def offset(self):
+        if self.offset_min is None or self.offset_max is None:
+            return None
+        return (self.offset_min + self.offset_max) / 2
+
+    def samples(self):
+        """One LatencySample per update seen through to its first pulse"""
+        offset = self.offset
+        samples = []
+        for seq, stages in self.stages.items():
+            if seq not in self.host_times or any(
+                    stage not in stages
+                    for stage in (cc.LATENCY_RX, cc.LATENCY_APPLY, cc.LATENCY_PULSE)):
+                continue
+            rx, apply, pulse = (stages[cc.LATENCY_RX], stages[cc.LATENCY_APPLY],
+                                stages[cc.LATENCY_PULSE])
+            transit = rx - offset - self.host_times[seq]
+            samples.append(LatencySample(seq, transit + pulse - rx, transit, apply - rx,
+                                         pulse - apply))
+        return samples
+
+
+async def run(client, count, frequency, pulse_width, gap_ms):
+    loop = asyncio.get_running_loop()
+    tracker = LatencyTracker()
+
+    await client.set_telemetry(True)
+    client.subscribe_telemetry(lambda frame_seq, records:
+                               tracker.on_telemetry(records, loop.time()))
+    for i in range(count):
+        # Alternate codes so every update changes the output
+        code = 0x8001 + (i & 1)
+        client.submit_timed_settings(code, pulse_width, frequency, int(loop.time() * 1e6))
+        if gap_ms:
+            await asyncio.sleep(gap_ms / 1000.0)
+    await client.drain()
+    # Last pulse boundary plus the telemetry flush
+    await asyncio.sleep(2.0 / frequency + 0.1)
+    await client.set_telemetry(False)
+    return tracker
+
+
+def report(count, tracker):
+    samples = tracker.samples()
+    print(f"{len(samples)} of {count} updates measured")
+    if samples:
+        # Transit is only as good as the offset estimate
+        spread = (tracker.offset_max - tracker.offset_min) * 1000
+        print(f"  clock offset bounds {spread:.3f} ms apart")
+    for name in ("total", "transit", "queueing", "pulse_wait"):
+        if samples:
+            ms = [getattr(sample, name) * 1000 for sample in samples]
+            print(f"  {name:<10} (ms) min: {min(ms):7.3f} p50: {statistics.median(ms):7.3f} "
+                  f"p99: {percentile(ms, 99):7.3f} max: {max(ms):7.3f}")
+    # Replaced before the next pulse, or lost with a dropped record
+    print(f"  superseded or lost: {count - len(samples)}")
+
+
+async def main():
+    parser = argparse.ArgumentParser(
+        description="Chronos settings latency, split into transit, queueing and pulse wait")
+    parser.add_argument("--address", help="BLE address of a board; the mock link otherwise")
+    parser.add_argument("--count", type=int, default=100)
+    parser.add_argument("--frequency", type=int, default=1000, help="pulse frequency (Hz)")
+    parser.add_argument("--pulse-width", type=int, default=100, help="us")
+    parser.add_argument("--gap-ms", type=float, default=20.0,
+                        help="pause between updates, long enough for each to reach a pulse")
+    parser.add_argument("--interval-ms", type=float, default=7.5,
+                        help="mock connection interval")
+    args = parser.parse_args()
+
+    if args.address:
+        transport = cc.BleakTransport(address=args.address)
+    else:
+        transport = chronos_mock.MockTransport(interval_ms=args.interval_ms,
+                                               frequency=args.frequency)
+    async with cc.ChronosClient(transport) as client:
+        tracker = await run(client, args.count, args.frequency, args.pulse_width, args.gap_ms)
+    report(args.count, tracker)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
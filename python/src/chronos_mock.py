@@ -0,0 +1,223 @@
+# In-process stand-in for a Chronos board behind a BLE link, for tests and
+# benchmarks on a machine without hardware or a radio. It models what sets
+# the timing a client sees:
+#   - connection events, each carrying a few packets in either direction,
+#   - the controller buffers that writes without response wait for,
+#   - the firmware applying a setting at the next pulse boundary,
+#   - TELEMETRY_PULSE records packed into frames and flushed after
+#     CONFIG_CHRONOS_TELEMETRY_FLUSH_MS, as the telemetry thread does,
+#   - a black box readout, one block per notification,
+#   - TELEMETRY_LATENCY records of timed settings: receipt at the connection
+#     event, apply after the command work queue, first pulse on the setting.
+# Pulses are generated lazily at connection events with their exact boundary
+# times, so a 1 kHz train costs no timer per pulse.
+import asyncio
+import collections
+import struct
+
+import blackbox_decode as bb
+import chronos_client as cc
+
+CPU_HZ = cc.TELEMETRY_CLOCK_HZ
+
+
+def dac_opposite_code(code):
+    """DAC2 code for a DAC1 code, as in src/spi.c"""
+    return 0xFFFF if code == 0 else (0x10000 - code) & 0xFFFF
+
+
+class MockChronos:
+    """Firmware model: the settings handoff and the telemetry stream"""
+
+    def __init__(self, start_time, frequency=100, dac_code=0x8000, pulse_width=500,
+                 work_delay=50e-6):
+        self.frequency = frequency
+        self.dac_code = dac_code
+        self.pulse_width = pulse_width
+        self.staged = None              # committed, waits for the next pulse
+        self.probe = None               # seq of a staged timed setting
+        self.work_delay = work_delay    # BT RX to the command work queue applying it
+        self.start_time = start_time
+        self.next_pulse = start_time + 1.0 / frequency
+        self.pulse_count = 0
+        self.telemetry = False
+        self.records = collections.deque()     # (time, record bytes)
+        self.writes = []                # every write, as received
+        self.commands = []              # (opcode, seq, payload) of every command
+        self.applied = []               # (time, dac_code, pulse_width, frequency)
+        self.blackbox_blocks = []       # raw blocks, oldest first, as a readout sends them
+        self.outbox = collections.deque()      # notifications other than telemetry
+
+    def receive(self, data, now):
+        self.advance(now)
+        self.writes.append(bytes(data))
+        if len(data) == cc.SETTINGS_LEN:
+            self.staged = cc.decode_settings(data)
+            self.probe = None
+        elif len(data) >= 4 and data[0] == cc.CMD_MAGIC:
+            opcode, seq = data[1], struct.unpack_from('<H', data, 2)[0]
+            payload = bytes(data[4:])
+            self.commands.append((opcode, seq, payload))
+            if opcode == cc.CMD_TELEMETRY and len(payload) == 1:
+                self.telemetry = payload[0] != 0
+            elif (opcode == cc.CMD_SETTINGS_TIMED
+                  and len(payload) == 4 + cc.SETTINGS_LEN):
+                host_time_us = struct.unpack_from('<I', payload)[0]
+                self.latency_record(now, cc.LATENCY_RX, seq, host_time_us)
+                applied = now + self.work_delay
+                self.advance(applied)
+                self.staged = cc.decode_settings(payload[4:])
+                self.probe = seq
+                self.latency_record(applied, cc.LATENCY_APPLY, seq, 0)
+            elif opcode == cc.CMD_BLACKBOX_READ and not payload:
+                for frame_seq, block in enumerate(self.blackbox_blocks):
+                    self.outbox.append(struct.pack('<BBH', bb.BLACKBOX_FRAME_MAGIC, 0,
+                                                   frame_seq) + block)
+                self.outbox.append(struct.pack('<BBH', bb.BLACKBOX_FRAME_MAGIC,
+                                               bb.BLACKBOX_FRAME_LAST,
+                                               len(self.blackbox_blocks)))
+
+    def timestamp(self, t):
+        return int((t - self.start_time) * CPU_HZ) & 0xFFFFFFFF
+
+    def latency_record(self, t, stage, seq, value1):
+        if self.telemetry:
+            record = struct.pack('<IBBHII', self.timestamp(t), cc.TELEMETRY_LATENCY, stage, 0,
+                                 seq, value1)
+            self.records.append((t, record))
+
+    def advance(self, now):
+        """Run the pulse train up to now"""
+        while self.next_pulse <= now:
+            t = self.next_pulse
+            if self.staged is not None:
+                dac_code, pulse_width, frequency = self.staged
+                self.staged = None
+                self.dac_code, self.pulse_width = dac_code, pulse_width
+                if frequency > 0:
+                    self.frequency = frequency
+                self.applied.append((t, dac_code, pulse_width, self.frequency))
+            self.pulse_count += 1
+            if self.telemetry:
+                codes = (self.dac_code << 16) | dac_opposite_code(self.dac_code)
+                record = struct.pack('<IBBHII', self.timestamp(t), cc.TELEMETRY_PULSE, 0, 0,
+                                     self.pulse_count & 0xFFFFFFFF, codes)
+                self.records.append((t, record))
+            if self.probe is not None:
+                self.latency_record(t, cc.LATENCY_PULSE, self.probe,
+                                    self.pulse_count & 0xFFFFFFFF)
+                self.probe = None
+            self.next_pulse = t + 1.0 / self.frequency
+
+
+class MockTransport:
+    """Drop-in for BleakTransport backed by MockChronos. Defaults follow the
+    firmware's link setup: 7.5 ms interval, 247-byte MTU."""
+
+    def __init__(self, interval_ms=7.5, packets_per_event=6, tx_buffers=10, mtu=247,
+                 flush_ms=20, frequency=100):
+        self.interval = interval_ms / 1000.0
+        self.packets_per_event = packets_per_event
+        self.tx_buffers = tx_buffers
+        self._mtu = mtu
+        self.flush = flush_ms / 1000.0
+        self.frequency = frequency
+        self.device = None
+        self._air = collections.deque()     # (data, response future or None)
+        self._responses = []                # answered at the next event
+        self._space = None
+        self._notify = None
+        self._events = None
+        self._frame_seq = 0
+
+    @property
+    def is_connected(self):
+        return self._events is not None
+
+    @property
+    def mtu(self):
+        return self._mtu
+
+    async def connect(self):
+        loop = asyncio.get_running_loop()
+        self.device = MockChronos(loop.time(), frequency=self.frequency)
+        self._space = asyncio.Condition()
+        self._events = loop.create_task(self._run())
+
+    async def disconnect(self):
+        if self._events:
+            self._events.cancel()
+            try:
+                await self._events
+            except asyncio.CancelledError:
+                pass
+            self._events = None
+        for _, future in self._air:
+            if future and not future.done():
+                future.set_exception(ConnectionError("disconnected"))
+        self._air.clear()
+
+    async def start_notify(self, callback):
+        self._notify = callback
+
+    async def write(self, data, response):
+        if not self.is_connected:
+            raise ConnectionError("not connected")
+        if len(data) > self._mtu - 3:
+            raise ValueError(f"{len(data)} byte write exceeds the ATT MTU")
+        if response:
+            # One ATT request at a time: the next write waits for the answer
+            future = asyncio.get_running_loop().create_future()
+            self._air.append((bytes(data), future))
+            await future
+            return
+        async with self._space:
+            await self._space.wait_for(lambda: len(self._air) < self.tx_buffers)
+            self._air.append((bytes(data), None))
+
+    def _frames(self, now, budget):
+        capacity = (min(self._mtu - 3, 244) - cc.TELEMETRY_HEADER_LEN) // cc.TELEMETRY_RECORD_LEN
+        records = self.device.records
+        frames = []
+        while records and len(frames) < budget:
+            if len(records) < capacity and now - records[0][0] < self.flush:
+                break
+            count = min(capacity, len(records))
+            body = b"".join(records.popleft()[1] for _ in range(count))
+            header = struct.pack('<BBH', cc.TELEMETRY_MAGIC, count, self._frame_seq)
+            self._frame_seq = (self._frame_seq + 1) & 0xFFFF
+            frames.append(header + body)
+        return frames
+
+    async def _run(self):
+        loop = asyncio.get_running_loop()
+        next_event = loop.time() + self.interval
+        while True:
+            await asyncio.sleep(max(0.0, next_event - loop.time()))
+            now = next_event
+            next_event += self.interval
+
+            for future in self._responses:
+                if not future.done():
+                    future.set_result(None)
+            self._responses = []
+
+            packets = 0
+            while self._air and packets < self.packets_per_event:
+                data, future = self._air.popleft()
+                self.device.receive(data, now)
+                packets += 1
+                if future:
+                    self._responses.append(future)
+                    break
+            async with self._space:
+                self._space.notify_all()
+
+            self.device.advance(now)
+            frames = []
+            while self.device.outbox and packets + len(frames) < self.packets_per_event:
+                frames.append(self.device.outbox.popleft())
+            frames += self._frames(now, self.packets_per_event - packets - len(frames))
+            for frame in frames:
+                if self._notify:
+                    self._notify(frame)
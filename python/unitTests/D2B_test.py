@@ -1,5 +1,6 @@
 import unittest
 import math
+import numpy as np
 import sys
 import os
 
@@ -129,6 +130,63 @@ class TestD2B(unittest.TestCase):
         self.assertEqual(result, 0x0000, 
                         f"Negative overcurrent {overcurrent_neg} μA should be clamped to 0x0000, got 0x{result:04X}")
 
+class TestD2BArray(unittest.TestCase):
+
+    def setUp(self):
+        self.MAX_CURRENT = D2B.MAX_CURRENT
+
+    def assertMatchesScalar(self, values):
+        codes = D2B.decimal_to_binary_array(values)
+        for value, code in zip(values, codes):
+            self.assertEqual(int(code), int(D2B.decimal_to_binary(value)),
+                             f"{value!r} μA: batch 0x{int(code):04X}, "
+                             f"scalar 0x{int(D2B.decimal_to_binary(value)):04X}")
+
+    def test_sweep_matches_scalar(self):
+        """Every point of a sweep past both rails matches decimal_to_binary"""
+        self.assertMatchesScalar(np.linspace(-2 * self.MAX_CURRENT, 2 * self.MAX_CURRENT, 20001))
+
+    def test_random_values_match_scalar(self):
+        rng = np.random.default_rng(18)
+        self.assertMatchesScalar(rng.uniform(-1.5 * self.MAX_CURRENT, 1.5 * self.MAX_CURRENT, 5000))
+        # Fractions of a μA around zero, where truncation decides the code
+        self.assertMatchesScalar(rng.uniform(-50.0, 50.0, 5000))
+
+    def test_lsb_edges_match_scalar(self):
+        """Values right at and next to a code step"""
+        lsb = 10 * D2B.V_REF / 32768.0 / D2B.R_SENSE * 1000000
+        steps = np.arange(-40, 40) * lsb
+        values = np.concatenate([steps, np.nextafter(steps, np.inf), np.nextafter(steps, -np.inf)])
+        self.assertMatchesScalar(values)
+
+    def test_boundaries_match_scalar(self):
+        values = [0, 1, -1, self.MAX_CURRENT, -self.MAX_CURRENT, self.MAX_CURRENT + 1,
+                  -self.MAX_CURRENT - 1, 10 ** 9, -10 ** 9, np.inf, -np.inf, -0.0]
+        self.assertMatchesScalar(values)
+
+    def test_integer_input(self):
+        values = list(range(-3000, 3001, 7))
+        self.assertMatchesScalar(values)
+        self.assertMatchesScalar(np.array(values, dtype=np.int32))
+
+    def test_dtype_and_shape(self):
+        """Little-endian uint16 in the shape of the input"""
+        codes = D2B.decimal_to_binary_array(np.zeros((4, 8)))
+        self.assertEqual(codes.dtype, np.dtype('<u2'))
+        self.assertEqual(codes.shape, (4, 8))
+        self.assertTrue((codes == 0x8000).all())
+        self.assertEqual(D2B.decimal_to_binary_array([]).shape, (0,))
+
+    def test_bytes_layout(self):
+        """Codes pack low byte first, like the firmware's u16 fields"""
+        data = D2B.decimal_to_bytes([0, 2 * self.MAX_CURRENT, -2 * self.MAX_CURRENT])
+        self.assertEqual(data, bytes([0x00, 0x80, 0xFF, 0xFF, 0x00, 0x00]))
+        self.assertEqual(D2B.decimal_to_bytes([]), b"")
+
+    def test_nan_rejected(self):
+        with self.assertRaises(ValueError):
+            D2B.decimal_to_binary_array([0.0, float('nan')])
+
 if __name__ == '__main__':
     # Run with verbose output to see print statements from D2B
     unittest.main(verbosity=2)
\ No newline at end of file
@@ -0,0 +1,75 @@
+import unittest
+import binascii
+import struct
+import sys
+import os
+
+# Add the src directory to the path so we can import the decoder
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'src'))
+import blackbox_decode as bb
+
+
+def record(timestamp, rtype, index=0, value0=0, value1=0):
+    return struct.pack('<IBBHII', timestamp, rtype, index, 0, value0, value1)
+
+
+def block(seq, records):
+    body = b"".join(records)
+    header = struct.pack('<IIHHI', bb.BLACKBOX_BLOCK_MAGIC, seq, len(records),
+                         bb.block_crc(seq, len(records), body), 0xFFFFFFFF)
+    return (header + body).ljust(bb.BLACKBOX_BLOCK_LEN, b"\xFF")
+
+
+ERASED = b"\xFF" * bb.BLACKBOX_BLOCK_LEN
+
+
+class TestBlackboxDecode(unittest.TestCase):
+
+    def test_crc_matches_the_firmware(self):
+        """crc16_itu_t with seed 0xFFFF is CRC-16/CCITT-FALSE"""
+        self.assertEqual(binascii.crc_hqx(b"123456789", 0xFFFF), 0x29B1)
+
+    def test_decode_block(self):
+        data = block(42, [record(100, bb.BLACKBOX_BOOT, value0=42),
+                          record(250, bb.BLACKBOX_SETTING, value0=(100 << 16) | 200,
+                                 value1=0x9000)])
+        seq, records = bb.decode_block(data)
+        self.assertEqual(seq, 42)
+        self.assertEqual(records[1], bb.BlackboxRecord(42, 250, bb.BLACKBOX_SETTING, 0,
+                                                       (100 << 16) | 200, 0x9000))
+        self.assertIn("100 Hz, 200 us, DAC 0x9000", bb.format_record(records[1]))
+
+    def test_erased_and_damaged_blocks(self):
+        data = bytearray(block(1, [record(1, bb.BLACKBOX_CONNECTED)]))
+        self.assertIsNone(bb.decode_block(ERASED))
+        self.assertIsNone(bb.decode_block(bytes(data[:-1])))
+        data[bb.BLACKBOX_HEADER_LEN + 3] ^= 0x01
+        self.assertIsNone(bb.decode_block(bytes(data)))
+
+    def test_decode_frame(self):
+        data = block(3, [record(1, bb.BLACKBOX_CONNECTED)])
+        frame = struct.pack('<BBH', bb.BLACKBOX_FRAME_MAGIC, 0, 9) + data
+        self.assertEqual(bb.decode_frame(frame), (9, False, data))
+        last = struct.pack('<BBH', bb.BLACKBOX_FRAME_MAGIC, bb.BLACKBOX_FRAME_LAST, 10)
+        self.assertEqual(bb.decode_frame(last), (10, True, None))
+        self.assertIsNone(bb.decode_frame(frame[:-1]))
+        self.assertIsNone(bb.decode_frame(b"Hello\n"))
+
+    def test_partition_dump_in_seq_order(self):
+        """Blocks stay within 4 KiB pages; the order follows seq across the
+        wrap of the ring and of seq itself"""
+        page_size = 4096
+        per_page = page_size // bb.BLACKBOX_BLOCK_LEN
+        seqs = {0: 0xFFFFFFFF, 1: 0, 2: 1, per_page: 0xFFFFFFFE}
+        image = bytearray(b"\xFF" * (2 * page_size))
+        for position, seq in seqs.items():
+            offset = (position // per_page) * page_size + (position % per_page) * bb.BLACKBOX_BLOCK_LEN
+            image[offset:offset + bb.BLACKBOX_BLOCK_LEN] = block(seq, [record(seq & 0xFF, bb.BLACKBOX_PULSES)])
+        records = bb.decode_image(bytes(image), page_size)
+        self.assertEqual([r.seq for r in records], [0xFFFFFFFE, 0xFFFFFFFF, 0, 1])
+        # Read as back-to-back blocks the page padding is not a block
+        self.assertEqual(len(bb.split_image(bytes(image))), 2 * page_size // bb.BLACKBOX_BLOCK_LEN)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
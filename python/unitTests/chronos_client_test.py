@@ -0,0 +1,164 @@
+import unittest
+import asyncio
+import struct
+import sys
+import os
+
+# Add the src directory to the path so we can import the client
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'src'))
+import blackbox_decode as bb
+import chronos_client as cc
+import chronos_mock
+
+
+class TestWireFormat(unittest.TestCase):
+
+    def test_settings_round_trip(self):
+        """Settings writes are three little-endian u16, like stim_setting"""
+        data = cc.encode_settings(0x9000, 500, 100)
+        self.assertEqual(data, bytes([0x00, 0x90, 0xF4, 0x01, 0x64, 0x00]))
+        self.assertEqual(cc.decode_settings(data), (0x9000, 500, 100))
+
+    def test_command_header(self):
+        """Commands start with magic, opcode and a 16-bit sequence number"""
+        data = cc.encode_command(cc.CMD_TELEMETRY, b"\x01", seq=0x10203)
+        self.assertEqual(data, bytes([cc.CMD_MAGIC, cc.CMD_TELEMETRY, 0x03, 0x02, 0x01]))
+
+    def test_program_begin_is_not_a_setting(self):
+        """BEGIN carries a reserved u16 so it is never 6 bytes long"""
+        data = cc.encode_command(cc.CMD_PROGRAM_BEGIN, cc.encode_program_begin(3), seq=1)
+        self.assertEqual(data, bytes([cc.CMD_MAGIC, cc.CMD_PROGRAM_BEGIN, 0x01, 0x00,
+                                      0x03, 0x00, 0x00, 0x00]))
+        self.assertNotEqual(len(data), cc.SETTINGS_LEN)
+
+    def test_decode_telemetry(self):
+        """Frames decode into records; anything else is not telemetry"""
+        records = [struct.pack('<IBBHII', 1000 * i, cc.TELEMETRY_PULSE, 0, 0, i, 0x80008000)
+                   for i in range(3)]
+        frame = struct.pack('<BBH', cc.TELEMETRY_MAGIC, 3, 7) + b"".join(records)
+        frame_seq, decoded = cc.decode_telemetry(frame)
+        self.assertEqual(frame_seq, 7)
+        self.assertEqual(len(decoded), 3)
+        self.assertEqual(decoded[2], cc.TelemetryRecord(2000, cc.TELEMETRY_PULSE, 0, 2, 0x80008000))
+        self.assertIsNone(cc.decode_telemetry(b"Hello\n"))
+        self.assertIsNone(cc.decode_telemetry(frame[:-1]))
+
+
+class TestClient(unittest.IsolatedAsyncioTestCase):
+
+    async def asyncSetUp(self):
+        # A fast link keeps the tests short
+        self.transport = chronos_mock.MockTransport(interval_ms=1.0, flush_ms=2, frequency=500)
+        self.client = cc.ChronosClient(self.transport)
+        await self.client.connect()
+
+    async def asyncTearDown(self):
+        await self.client.disconnect()
+
+    async def test_pipelined_commands_keep_order(self):
+        """Commands submitted back to back arrive in order, unacknowledged"""
+        futures = [self.client.submit_command(cc.CMD_BURST_SET, struct.pack('<HHHH', i, 200, 0, 0))
+                   for i in range(20)]
+        await asyncio.gather(*futures)
+        await asyncio.sleep(0.02)
+        commands = self.transport.device.commands
+        self.assertEqual([seq for _, seq, _ in commands], list(range(1, 21)))
+        self.assertEqual([struct.unpack('<H', payload[:2])[0] for _, _, payload in commands],
+                         list(range(20)))
+
+    async def test_settings_coalesce(self):
+        """Settings still in the queue are replaced, not sent one by one"""
+        futures = [self.client.submit_settings(0x8000 + i, 200, 500) for i in range(1, 6)]
+        self.assertTrue(all(future is futures[0] for future in futures))
+        await futures[0]
+        await asyncio.sleep(0.02)
+        self.assertEqual(self.transport.device.writes, [cc.encode_settings(0x8005, 200, 500)])
+        self.assertEqual(self.transport.device.dac_code, 0x8005)
+
+    async def test_settings_without_coalescing(self):
+        for i in range(1, 4):
+            self.client.submit_settings(0x8000 + i, 200, 500, coalesce=False)
+        await self.client.drain()
+        await asyncio.sleep(0.02)
+        self.assertEqual(len(self.transport.device.writes), 3)
+
+    async def test_telemetry_subscription(self):
+        """A setting shows up in the pulse records once it is applied"""
+        applied = asyncio.get_running_loop().create_future()
+
+        def on_telemetry(frame_seq, records):
+            for record in records:
+                if record.type == cc.TELEMETRY_PULSE and (record.value1 >> 16) == 0x9000:
+                    if not applied.done():
+                        applied.set_result(record)
+
+        unsubscribe = self.client.subscribe_telemetry(on_telemetry)
+        await self.client.set_telemetry(True)
+        await self.client.send_settings(0x9000, 200, 500)
+        record = await asyncio.wait_for(applied, 1.0)
+        self.assertEqual(record.value1 & 0xFFFF, chronos_mock.dac_opposite_code(0x9000))
+        unsubscribe()
+        self.assertEqual(self.client._telemetry_callbacks, [])
+
+    async def test_program_upload(self):
+        """BEGIN, the entries in MTU-sized writes, then COMMIT; nothing of it
+        is applied as a setting"""
+        entries = [struct.pack('<IIIHBB', 100 * i, 1 << i, 0, 0x8000 + i, 1, 0)
+                   for i in range(20)]
+        await self.client.upload_program(entries)
+        await asyncio.sleep(0.02)
+        device = self.transport.device
+        opcodes = [opcode for opcode, _, _ in device.commands]
+        self.assertEqual(opcodes[0], cc.CMD_PROGRAM_BEGIN)
+        self.assertEqual(device.commands[0][2], struct.pack('<HH', 20, 0))
+        self.assertEqual(opcodes[-1], cc.CMD_PROGRAM_COMMIT)
+        data = [payload for opcode, _, payload in device.commands if opcode == cc.CMD_PROGRAM_DATA]
+        self.assertEqual(len(data), 2)     # 14 entries fit a 247-byte MTU
+        self.assertEqual(b"".join(payload[2:] for payload in data), b"".join(entries))
+        self.assertEqual(struct.unpack('<H', data[1][:2])[0], 14)
+        self.assertIsNone(device.staged)
+        self.assertEqual(device.applied, [])
+        self.assertEqual(device.dac_code, 0x8000)
+
+    async def test_profile_commands(self):
+        """Names are NUL-padded to a fixed field and cut to leave the NUL"""
+        await self.client.save_profile(2, "theta burst")
+        await self.client.save_profile(3, "x" * 40)
+        await self.client.select_profile(2)
+        await asyncio.sleep(0.02)
+        commands = self.transport.device.commands
+        self.assertEqual(commands[0][0], cc.CMD_PROFILE_SAVE)
+        self.assertEqual(commands[0][2], b"\x02theta burst" + bytes(5))
+        self.assertEqual(commands[1][2], b"\x03" + b"x" * 15 + b"\0")
+        self.assertEqual(commands[2][:1] + commands[2][2:], (cc.CMD_PROFILE_SELECT, b"\x02"))
+
+    async def test_blackbox_readout(self):
+        """Every block arrives in order, then the readout ends"""
+        records = struct.pack('<IBBHII', 5000, bb.BLACKBOX_CONNECTED, 0, 0, 0, 0)
+        blocks = []
+        for seq in range(10, 20):
+            header = struct.pack('<IIHHI', bb.BLACKBOX_BLOCK_MAGIC, seq, 1,
+                                 bb.block_crc(seq, 1, records), 0xFFFFFFFF)
+            blocks.append((header + records).ljust(bb.BLACKBOX_BLOCK_LEN, b"\xFF"))
+        self.transport.device.blackbox_blocks = blocks
+        unsubscribe = self.client.subscribe_telemetry(lambda *frame: self.fail("telemetry"))
+        read = await self.client.read_blackbox(timeout=1.0)
+        unsubscribe()
+        self.assertEqual(read, blocks)
+        self.assertEqual([r.seq for r in bb.decode_blocks(read)], list(range(10, 20)))
+        self.assertEqual(self.transport.device.commands[-1][0], cc.CMD_BLACKBOX_READ)
+
+    async def test_write_with_response(self):
+        self.client.response = True
+        await self.client.send_settings(0x8100, 200, 500)
+        self.assertEqual(self.transport.device.writes, [cc.encode_settings(0x8100, 200, 500)])
+
+    async def test_oversized_write_fails_its_future(self):
+        with self.assertRaises(ValueError):
+            await self.client.send(bytes(300))
+        # The queue keeps going after a failed write
+        await self.client.send_settings(0x8200, 200, 500)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,84 @@
+import unittest
+import sys
+import os
+
+# Add the src directory to the path so we can import the tool
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'src'))
+import chronos_client as cc
+import chronos_latency
+import chronos_mock
+
+HZ = cc.TELEMETRY_CLOCK_HZ
+
+
+def latency(timestamp, stage, seq, value1=0):
+    return cc.TelemetryRecord(round(timestamp) & 0xFFFFFFFF, cc.TELEMETRY_LATENCY, stage, seq,
+                              value1)
+
+
+class TestLatencySplit(unittest.TestCase):
+
+    def test_split_with_known_offset(self):
+        """Device clock 10 s ahead; the bounds meet, so transit is exact"""
+        tracker = chronos_latency.LatencyTracker()
+        # Sent at host 5.000 s, received 3 ms later, applied 0.1 ms after,
+        # first pulse 0.9 ms after that, reported immediately
+        tracker.on_telemetry([latency(15.003 * HZ, cc.LATENCY_RX, 7, 5000000),
+                              latency(15.0031 * HZ, cc.LATENCY_APPLY, 7),
+                              latency(15.004 * HZ, cc.LATENCY_PULSE, 7, 42)], 5.004)
+        self.assertAlmostEqual(tracker.offset_max, 10.003)
+        self.assertAlmostEqual(tracker.offset_min, 10.0)
+        # A faster write tightens the upper bound
+        tracker.on_telemetry([latency(15.2 * HZ, cc.LATENCY_RX, 8, 5200000)], 5.2)
+        self.assertAlmostEqual(tracker.offset, 10.0)
+        (sample,) = tracker.samples()
+        self.assertEqual(sample.seq, 7)
+        self.assertAlmostEqual(sample.transit, 0.003)
+        self.assertAlmostEqual(sample.queueing, 0.0001)
+        self.assertAlmostEqual(sample.pulse_wait, 0.0009)
+        self.assertAlmostEqual(sample.total, 0.004)
+
+    def test_wrapped_clocks(self):
+        """CYCCNT and the host microseconds both wrap between the stages"""
+        tracker = chronos_latency.LatencyTracker()
+        rx = (1 << 32) - HZ // 1000
+        arrival = 5000.0
+        host_us = int((arrival - 0.004) * 1e6) & 0xFFFFFFFF
+        tracker.on_telemetry([latency(rx, cc.LATENCY_RX, 1, host_us),
+                              latency(rx + HZ // 2000, cc.LATENCY_APPLY, 1),
+                              latency(rx + 2 * HZ // 1000, cc.LATENCY_PULSE, 1)], arrival)
+        (sample,) = tracker.samples()
+        self.assertAlmostEqual(sample.queueing, 0.0005)
+        self.assertAlmostEqual(sample.pulse_wait, 0.0015)
+        self.assertAlmostEqual(tracker.host_times[1], arrival - 0.004, places=5)
+
+    def test_incomplete_updates_are_left_out(self):
+        tracker = chronos_latency.LatencyTracker()
+        tracker.on_telemetry([latency(HZ, cc.LATENCY_RX, 3, 0),
+                              latency(HZ + 100, cc.LATENCY_APPLY, 3)], 1.0)
+        self.assertEqual(tracker.samples(), [])
+
+
+class TestLatencyAgainstMock(unittest.IsolatedAsyncioTestCase):
+
+    async def test_run(self):
+        """Every update is measured, and the split adds up to what the mock
+        link and pulse train allow"""
+        transport = chronos_mock.MockTransport(interval_ms=2.0, flush_ms=2, frequency=1000)
+        async with cc.ChronosClient(transport) as client:
+            tracker = await chronos_latency.run(client, 10, 1000, 100, 5.0)
+        samples = tracker.samples()
+        self.assertEqual(len(samples), 10)
+        self.assertEqual(transport.device.commands[1][0], cc.CMD_SETTINGS_TIMED)
+        for sample in samples:
+            self.assertAlmostEqual(sample.queueing, transport.device.work_delay, places=6)
+            self.assertLessEqual(sample.pulse_wait, 0.001 + 1e-6)
+            # Within a connection interval plus the offset uncertainty
+            self.assertLess(sample.transit, 0.004)
+            self.assertGreater(sample.transit, -0.001)
+            self.assertAlmostEqual(sample.total,
+                                   sample.transit + sample.queueing + sample.pulse_wait)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,99 @@
+# Post-build check for CONFIG_CHRONOS_STIM_IRQ_ZLI. Walks the static call
+# graph of the zero-latency ISR in the linked image and fails if anything it
+# can reach calls into the kernel or takes an interrupt lock. A zero-latency
+# interrupt preempts the kernel at any point and is not masked by
+# irq_lock(), so either would corrupt kernel state or protect nothing.
+#
+# usage: zli_check.py --objdump <objdump> --root timer_zli_isr zephyr.elf
+################################################################################
+import argparse
+import re
+import subprocess
+import sys
+
+# Kernel, logging and console entry points
+FORBIDDEN_CALLS = re.compile(
+    r"^(k_|z_|arch_|sys_clock_|sys_trace_|pm_|log_|printk|printf|vprintf|puts|putchar|"
+    r"fputc|malloc|free|irq_lock|irq_unlock)")
+# Failed assertions end in a fatal error anyway
+ALLOWED_CALLS = re.compile(r"^(assert_post_action|assert_print|__assert)")
+# Inline irq_lock()/irq_unlock() and PRIMASK sections
+LOCK_INSTRUCTIONS = re.compile(r"\b(msr\s+BASEPRI|cpsid|cpsie)", re.IGNORECASE)
+
+FUNCTION_LINE = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+# Calls, tail calls and conditional branches to a symbol
+BRANCH_LINE = re.compile(
+    r"\b(?:bl|blx|b|b\w\w|cbn?z)(?:\.[nw])?\s+(?:r\d+,\s*)?[0-9a-f]+ <([^>+]+)(?:\+0x[0-9a-f]+)?>")
+INDIRECT_LINE = re.compile(r"\b(blx|bx)\s+(r\d+|ip)\b")
+
+def disassemble(objdump, elf):
+    output = subprocess.run([objdump, "-d", "--no-show-raw-insn", elf], check=True,
+                            capture_output=True, text=True).stdout
+    functions = {}
+    current = None
+    for line in output.splitlines():
+        match = FUNCTION_LINE.match(line)
+        if match:
+            current = match.group(1)
+            functions[current] = []
+        elif current is not None and line.strip():
+            functions[current].append(line.strip())
+    return functions
+
+def check(functions, root):
+    if root not in functions:
+        return [f"{root} not found in the image"], []
+    errors = []
+    warnings = []
+    parents = {root: None}
+    pending = [root]
+
+    def path(name):
+        chain = []
+        while name is not None:
+            chain.append(name)
+            name = parents[name]
+        return " <- ".join(chain)
+
+    while pending:
+        name = pending.pop()
+        for line in functions.get(name, []):
+            if LOCK_INSTRUCTIONS.search(line):
+                instruction = " ".join(line.split()[1:])
+                errors.append(f"interrupt lock '{instruction}' in {path(name)}")
+            if INDIRECT_LINE.search(line):
+                warnings.append(f"indirect call not followed in {path(name)}")
+            match = BRANCH_LINE.search(line)
+            if not match:
+                continue
+            target = match.group(1)
+            if (target == name) or (target in parents):
+                continue
+            parents[target] = name
+            if ALLOWED_CALLS.match(target):
+                continue
+            if FORBIDDEN_CALLS.match(target):
+                errors.append(f"kernel call {path(target)}")
+                continue
+            pending.append(target)
+    return errors, warnings
+
+def main():
+    parser = argparse.ArgumentParser(description="Check the zero-latency ISR call graph")
+    parser.add_argument("--objdump", required=True)
+    parser.add_argument("--root", required=True)
+    parser.add_argument("elf")
+    args = parser.parse_args()
+
+    errors, warnings = check(disassemble(args.objdump, args.elf), args.root)
+    for warning in sorted(set(warnings)):
+        print(f"zli_check: warning: {warning}")
+    for error in errors:
+        print(f"zli_check: error: {error}")
+    if errors:
+        return 1
+    print(f"zli_check: {args.root} makes no kernel calls")
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
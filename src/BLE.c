@@ -26,6 +26,14 @@
 #include <zephyr/logging/log.h>
 #include "BLE.h"
 #include "data.h"
+#include "cmd_queue.h"
+#include "boot_stages.h"
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+#include "telemetry.h"
+#endif
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+#include "blackbox.h"
+#endif
 
 LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 K_SEM_DEFINE(ble_init_ok, 0, 1);
@@ -45,13 +53,55 @@ struct bt_conn *current_conn;
 struct bt_conn *auth_conn;
 static K_FIFO_DEFINE(fifo_uart_tx_data);
 static K_FIFO_DEFINE(fifo_uart_rx_data);
-bool ble_data_ready = false;
+
+/* Every UART buffer comes from this slab: constant-time allocation from any
+ * context and no heap fragmentation. A filled RX block is handed to the BLE
+ * thread by reference and sent from where the UART wrote it.
+ */
+K_MEM_SLAB_DEFINE_STATIC(uart_slab, sizeof(struct uart_data_t),
+			 CONFIG_CHRONOS_UART_SLAB_COUNT, 4);
+static atomic_t uart_slab_high_water;
+static atomic_t uart_alloc_failures;
+static atomic_t uart_send_failures;
+
+static struct uart_data_t *uart_buf_alloc(void)
+{
+	struct uart_data_t *buf;
+	atomic_val_t high_water;
+	uint32_t used;
+
+	if (k_mem_slab_alloc(&uart_slab, (void **)&buf, K_NO_WAIT)) {
+		atomic_inc(&uart_alloc_failures);
+		return NULL;
+	}
+
+	used = k_mem_slab_num_used_get(&uart_slab);
+	do {
+		high_water = atomic_get(&uart_slab_high_water);
+	} while ((used > high_water) &&
+		 !atomic_cas(&uart_slab_high_water, high_water, used));
+
+	return buf;
+}
+
+static void uart_buf_free(struct uart_data_t *buf)
+{
+	k_mem_slab_free(&uart_slab, buf);
+}
+
+void get_uart_pool_stats(struct uart_pool_stats *stats)
+{
+	stats->used = k_mem_slab_num_used_get(&uart_slab);
+	stats->high_water = atomic_get(&uart_slab_high_water);
+	stats->alloc_failures = atomic_get(&uart_alloc_failures);
+	stats->send_failures = atomic_get(&uart_send_failures);
+}
 
 void uart_work_handler(struct k_work *item)
 {
 	struct uart_data_t *buf;
 
-	buf = k_malloc(sizeof(*buf));
+	buf = uart_buf_alloc();
 	if (buf) {
 		buf->len = 0;
 	} else {
@@ -80,6 +130,7 @@ void adv_work_handler(struct k_work *work)
 		return;
 	}
 
+	boot_stage_mark(BOOT_ADVERTISING);
 	LOG_INF("Advertising successfully started");
 }
 
@@ -101,6 +152,12 @@ void connected(struct bt_conn *conn, uint8_t err)
 	LOG_INF("Connected %s", addr);
 
 	current_conn = bt_conn_ref(conn);
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+	telemetry_connected(conn);
+#endif
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+	blackbox_write(BLACKBOX_CONNECTED, 0, 0, 0);
+#endif
 
 	dk_set_led_on(CON_STATUS_LED);
 }
@@ -118,6 +175,12 @@ void disconnected(struct bt_conn *conn, uint8_t reason)
 		auth_conn = NULL;
 	}
 
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+	telemetry_disconnected();
+#endif
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+	blackbox_write(BLACKBOX_DISCONNECTED, reason, 0, 0);
+#endif
 	if (current_conn) {
 		bt_conn_unref(current_conn);
 		current_conn = NULL;
@@ -282,20 +345,19 @@ void error(void)
 void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data,
 			  uint16_t len)
 {
-    // Store the data
-    if (len <= BLE_DATA_BUFFER_SIZE) {
-        memcpy(ble_received_data, data, len);
-        ble_data_length = len;
-        ble_data_ready = true;
-    }
-
-    process_received_data(&settings, ble_received_data, ble_data_length);
 	int err;
 	char addr[BT_ADDR_LE_STR_LEN] = {0};
 
+    // Processed by the command work queue, not in the BT RX context. The
+    // push stamps the receipt for timed settings.
+    err = cmd_queue_push(data, len);
+    if (err) {
+        LOG_WRN("Command dropped (err: %d)", err);
+    }
+
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, ARRAY_SIZE(addr));
 
-	LOG_INF("Received data from: %s: %X", addr, ble_received_data);
+	LOG_INF("Received data from: %s: %u bytes", addr, len);
 }
 
 void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
@@ -325,7 +387,7 @@ void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
 					   data[0]);
 		}
 
-		k_free(buf);
+		uart_buf_free(buf);
 
 		buf = k_fifo_get(&fifo_uart_tx_data, K_NO_WAIT);
 		if (!buf) {
@@ -359,7 +421,7 @@ void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
 		LOG_DBG("UART_RX_DISABLED");
 		disable_req = false;
 
-		buf = k_malloc(sizeof(*buf));
+		buf = uart_buf_alloc();
 		if (buf) {
 			buf->len = 0;
 		} else {
@@ -375,7 +437,7 @@ void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
 
 	case UART_RX_BUF_REQUEST:
 		LOG_DBG("UART_RX_BUF_REQUEST");
-		buf = k_malloc(sizeof(*buf));
+		buf = uart_buf_alloc();
 		if (buf) {
 			buf->len = 0;
 			uart_rx_buf_rsp(uart, buf->data, sizeof(buf->data));
@@ -393,7 +455,7 @@ void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
 		if (buf->len > 0) {
 			k_fifo_put(&fifo_uart_rx_data, buf);
 		} else {
-			k_free(buf);
+			uart_buf_free(buf);
 		}
 
 		break;
@@ -437,7 +499,7 @@ int uart_init(void)
 		}
 	}
 
-	rx = k_malloc(sizeof(*rx));
+	rx = uart_buf_alloc();
 	if (rx) {
 		rx->len = 0;
 	} else {
@@ -455,7 +517,7 @@ int uart_init(void)
 
 	err = uart_callback_set(uart, uart_cb, NULL);
 	if (err) {
-		k_free(rx);
+		uart_buf_free(rx);
 		LOG_ERR("Cannot initialize UART callback");
 		return err;
 	}
@@ -483,29 +545,29 @@ int uart_init(void)
 		}
 	}
 
-	tx = k_malloc(sizeof(*tx));
+	tx = uart_buf_alloc();
 
 	if (tx) {
 		pos = snprintf(tx->data, sizeof(tx->data),
 			       "Starting Nordic UART service sample\r\n");
 
 		if ((pos < 0) || (pos >= sizeof(tx->data))) {
-			k_free(rx);
-			k_free(tx);
+			uart_buf_free(rx);
+			uart_buf_free(tx);
 			LOG_ERR("snprintf returned %d", pos);
 			return -ENOMEM;
 		}
 
 		tx->len = pos;
 	} else {
-		k_free(rx);
+		uart_buf_free(rx);
 		return -ENOMEM;
 	}
 
 	err = uart_tx(uart, tx->data, tx->len, SYS_FOREVER_MS);
 	if (err) {
-		k_free(rx);
-		k_free(tx);
+		uart_buf_free(rx);
+		uart_buf_free(tx);
 		LOG_ERR("Cannot display welcome message (err: %d)", err);
 		return err;
 	}
@@ -514,7 +576,7 @@ int uart_init(void)
 	if (err) {
 		LOG_ERR("Cannot enable uart reception (err: %d)", err);
 		/* Free the rx buffer only because the tx buffer will be handled in the callback */
-		k_free(rx);
+		uart_buf_free(rx);
 	}
 
 	return err;
@@ -524,35 +586,20 @@ void ble_write_thread(void)
 {
 	/* Don't go any further until BLE is initialized */
 	k_sem_take(&ble_init_ok, K_FOREVER);
-	struct uart_data_t nus_data = {
-		.len = 0,
-	};
 
 	for (;;) {
 		/* Wait indefinitely for data to be sent over bluetooth */
 		struct uart_data_t *buf = k_fifo_get(&fifo_uart_rx_data,
 						     K_FOREVER);
 
-		int plen = MIN(sizeof(nus_data.data) - nus_data.len, buf->len);
-		int loc = 0;
-
-		while (plen > 0) {
-			memcpy(&nus_data.data[nus_data.len], &buf->data[loc], plen);
-			nus_data.len += plen;
-			loc += plen;
-
-			if (nus_data.len >= sizeof(nus_data.data) ||
-			   (nus_data.data[nus_data.len - 1] == '\n') ||
-			   (nus_data.data[nus_data.len - 1] == '\r')) {
-				if (bt_nus_send(NULL, nus_data.data, nus_data.len)) {
-					LOG_WRN("Failed to send data over BLE connection");
-				}
-				nus_data.len = 0;
-			}
-
-			plen = MIN(sizeof(nus_data.data), buf->len - loc);
+		/* One RX block is at most one notification, sent in place.
+		 * The stack copies it, so the block is free right after.
+		 */
+		if (bt_nus_send(NULL, buf->data, buf->len)) {
+			atomic_inc(&uart_send_failures);
+			LOG_WRN("Failed to send data over BLE connection");
 		}
 
-		k_free(buf);
+		uart_buf_free(buf);
 	}
-}
\ No newline at end of file
+}
@@ -40,13 +40,19 @@ extern const struct bt_data ad[];
 extern const struct bt_data sd[];
 extern const size_t ad_len;
 extern const size_t sd_len;
-extern bool ble_data_ready;
 struct uart_data_t {
     void *fifo_reserved;
     uint8_t data[UART_BUF_SIZE];
     uint16_t len;
 };
 
+struct uart_pool_stats {
+	uint32_t used;			/* slab blocks in use now */
+	uint32_t high_water;		/* most blocks ever in use at once */
+	uint32_t alloc_failures;	/* RX stalls for lack of a block */
+	uint32_t send_failures;		/* RX blocks not sent over BLE */
+};
+
 void uart_work_handler(struct k_work *item);
 bool uart_test_async_api(const struct device *dev);
 void adv_work_handler(struct k_work *work);
@@ -61,6 +67,7 @@ void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data,
 void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data);
 int uart_init(void);
 void ble_write_thread(void);
+void get_uart_pool_stats(struct uart_pool_stats *stats);
 
 #ifdef CONFIG_BT_NUS_SECURITY_ENABLED
 void security_changed(struct bt_conn *conn, bt_security_t level,
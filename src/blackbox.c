@@ -0,0 +1,296 @@
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <cmsis_core.h>
+#include <stdio.h>
+#include <string.h>
+#include "blackbox.h"
+#include "telemetry.h"
+#if defined(CONFIG_CHRONOS_PPR)
+#include "ppr_link.h"
+#else
+#include "timer.h"
+#endif
+
+#define BLACKBOX_DEPTH CONFIG_CHRONOS_BLACKBOX_DEPTH
+BUILD_ASSERT((BLACKBOX_DEPTH & (BLACKBOX_DEPTH - 1)) == 0,
+             "CONFIG_CHRONOS_BLACKBOX_DEPTH must be a power of two");
+
+typedef struct {
+    uint32_t seq;               // ring position + 1 once the record is complete
+    blackbox_record record;
+} blackbox_slot;
+
+// Same reservation scheme as the event log: writers claim ring_head by CAS,
+// only the black box thread moves ring_tail, once the records are in flash.
+// Staged records are stamped with DWT CYCCNT, like the event log, so that a
+// zero-latency timer interrupt can write them; the thread turns the stamp
+// into k_uptime ms on the way to flash. That holds while a record is staged
+// for less than one counter wrap (33 s at 128 MHz), hence the flush
+// interval limit.
+static blackbox_slot ring[BLACKBOX_DEPTH];
+static atomic_t ring_head;
+static atomic_t ring_tail;
+
+static atomic_t dropped;
+static atomic_t written_records;
+static atomic_t written_blocks;
+static atomic_t failures;
+static atomic_t readouts;
+static atomic_t readout_requested;
+static K_SEM_DEFINE(wake, 0, 1);
+
+// Black box thread only
+static const struct flash_area *area;
+static blackbox_index layout;
+static uint8_t block_buf[BLACKBOX_BLOCK_LEN];
+static uint8_t frame[BLACKBOX_FRAME_HEADER_LEN + BLACKBOX_BLOCK_LEN];
+
+void blackbox_write(blackbox_type type, uint8_t index, uint32_t value0, uint32_t value1) {
+    atomic_val_t head;
+
+    do {
+        head = atomic_get(&ring_head);
+        if ((head - atomic_get(&ring_tail)) >= BLACKBOX_DEPTH) {
+            atomic_inc(&dropped);
+            return;
+        }
+    } while (!atomic_cas(&ring_head, head, head + 1));
+
+    blackbox_slot *slot = &ring[head & (BLACKBOX_DEPTH - 1)];
+    slot->record.timestamp = DWT->CYCCNT;
+    slot->record.type = type;
+    slot->record.index = index;
+    slot->record.reserved = 0;
+    slot->record.value[0] = value0;
+    slot->record.value[1] = value1;
+    __DMB();
+    slot->seq = (uint32_t)head + 1;
+}
+
+void blackbox_read(void) {
+    atomic_set(&readout_requested, true);
+    k_sem_give(&wake);
+}
+
+void get_blackbox_stats(blackbox_stats *stats) {
+    stats->records = atomic_get(&written_records);
+    stats->blocks = atomic_get(&written_blocks);
+    stats->dropped = atomic_get(&dropped);
+    stats->failures = atomic_get(&failures);
+    stats->readouts = atomic_get(&readouts);
+}
+
+// Copy up to max complete records from the tail without consuming them,
+// their timestamps in ms
+static size_t ring_peek(blackbox_record *records, size_t max) {
+    atomic_val_t tail = atomic_get(&ring_tail);
+    uint32_t now_ms = k_uptime_get_32();
+    uint32_t now_cycles = DWT->CYCCNT;
+    uint32_t cycles_per_ms = SystemCoreClock / 1000;
+    size_t count = 0;
+
+    while (count < max) {
+        const blackbox_slot *slot = &ring[(tail + count) & (BLACKBOX_DEPTH - 1)];
+        if (slot->seq != (uint32_t)(tail + count) + 1) {
+            break;
+        }
+        __DMB();
+        records[count] = slot->record;
+        records[count].timestamp = now_ms - (now_cycles - slot->record.timestamp) / cycles_per_ms;
+        count++;
+    }
+    return count;
+}
+
+// Finds the newest block, so appending resumes after it
+static int partition_open(void) {
+    struct flash_pages_info page;
+    uint32_t seq;
+    int err;
+
+    err = flash_area_open(FIXED_PARTITION_ID(blackbox_partition), &area);
+    if (!err) {
+        err = flash_get_page_info_by_offs(flash_area_get_device(area), area->fa_off, &page);
+    }
+    if (!err) {
+        err = blackbox_index_init(&layout, area->fa_size, page.size);
+    }
+    if (err) {
+        return err;
+    }
+    for (uint32_t block = 0; block < layout.block_count; block++) {
+        err = flash_area_read(area, blackbox_block_offset(&layout, block), block_buf,
+                              BLACKBOX_BLOCK_LEN);
+        if (err) {
+            return err;
+        }
+        if (blackbox_block_check(block_buf, &seq) > 0) {
+            blackbox_index_note(&layout, block, seq);
+        }
+    }
+    printf("Black box: %lu blocks of %d records, next block seq %lu\n", layout.block_count,
+           BLACKBOX_BLOCK_RECORDS, blackbox_index_next_seq(&layout));
+    return 0;
+}
+
+static int append_block(const blackbox_record *records, size_t count) {
+    uint32_t block = blackbox_index_next(&layout);
+    uint32_t seq = blackbox_index_next_seq(&layout);
+    uint32_t unused;
+    int err;
+
+    for (uint32_t tries = 0; tries < layout.blocks_per_page; tries++) {
+        uint32_t offset = blackbox_block_offset(&layout, block);
+
+        if (blackbox_block_starts_page(&layout, block)) {
+            // The oldest page makes way
+            err = flash_area_erase(area, offset, layout.page_size);
+            if (err) {
+                return err;
+            }
+        } else {
+            // A write cut short by a reset leaves the block unusable
+            err = flash_area_read(area, offset, block_buf, BLACKBOX_BLOCK_LEN);
+            if (err) {
+                return err;
+            }
+            if (blackbox_block_check(block_buf, &unused) != -ENOENT) {
+                block = (block + 1) % layout.block_count;
+                continue;
+            }
+        }
+        blackbox_block_pack(block_buf, seq, records, count);
+        err = flash_area_write(area, offset, block_buf, BLACKBOX_BLOCK_LEN);
+        if (err) {
+            return err;
+        }
+        blackbox_index_note(&layout, block, seq);
+        return 0;
+    }
+    return -ENOSPC;
+}
+
+// Everything staged so far, in as few blocks as it takes
+static void drain(void) {
+    blackbox_record records[BLACKBOX_BLOCK_RECORDS];
+
+    for (;;) {
+        size_t count = ring_peek(records, BLACKBOX_BLOCK_RECORDS);
+
+        if (count == 0) {
+            return;
+        }
+        int err = append_block(records, count);
+        if (err) {
+            // Consumed regardless: retrying would wear the same page
+            atomic_inc(&failures);
+            printf("Black box: block write failed with error: %d\n", err);
+        } else {
+            atomic_add(&written_records, count);
+            atomic_inc(&written_blocks);
+        }
+        atomic_add(&ring_tail, count);
+    }
+}
+
+static uint32_t pulses_delivered(void) {
+#if defined(CONFIG_CHRONOS_PPR)
+    ppr_stats stats;
+
+    get_ppr_stats(&stats);
+    return stats.pulses;
+#else
+    return get_pulse_count();
+#endif
+}
+
+// Counters sampled once per flush rather than a record per pulse
+static void write_summary(void) {
+    static uint32_t last_pulses, last_dropped;
+    uint32_t pulses = pulses_delivered();
+    uint32_t lost = atomic_get(&dropped);
+
+    if (pulses != last_pulses) {
+        blackbox_write(BLACKBOX_PULSES, 0, pulses, pulses - last_pulses);
+        last_pulses = pulses;
+    }
+    if (lost != last_dropped) {
+        blackbox_write(BLACKBOX_DROPPED, 0, lost, lost - last_dropped);
+        last_dropped = lost;
+    }
+}
+
+// Telemetry credits pace the frames; a busy link only slows the readout
+static int send_frame(size_t len) {
+    for (;;) {
+        int err = telemetry_send(frame, len, K_MSEC(CONFIG_CHRONOS_TELEMETRY_FLUSH_MS));
+        if (err == -ENOMEM) {
+            k_msleep(CONFIG_CHRONOS_TELEMETRY_FLUSH_MS);
+        } else if (err != -EAGAIN) {
+            return err;
+        }
+    }
+}
+
+static void readout(void) {
+    uint32_t start = blackbox_index_next(&layout);
+    uint16_t frame_seq = 0;
+    uint32_t seq;
+    int err;
+
+    frame[0] = BLACKBOX_FRAME_MAGIC;
+    frame[1] = 0;
+    for (uint32_t i = 0; i < layout.block_count; i++) {
+        uint32_t block = (start + i) % layout.block_count;
+
+        err = flash_area_read(area, blackbox_block_offset(&layout, block),
+                              &frame[BLACKBOX_FRAME_HEADER_LEN], BLACKBOX_BLOCK_LEN);
+        if (err) {
+            atomic_inc(&failures);
+            continue;
+        }
+        if (blackbox_block_check(&frame[BLACKBOX_FRAME_HEADER_LEN], &seq) <= 0) {
+            continue;
+        }
+        sys_put_le16(frame_seq++, &frame[2]);
+        err = send_frame(sizeof(frame));
+        if (err) {
+            printf("Black box readout stopped with error: %d\n", err);
+            return;
+        }
+    }
+    frame[1] = BLACKBOX_FRAME_LAST;
+    sys_put_le16(frame_seq, &frame[2]);
+    err = send_frame(BLACKBOX_FRAME_HEADER_LEN);
+    if (err) {
+        printf("Black box readout stopped with error: %d\n", err);
+        return;
+    }
+    atomic_inc(&readouts);
+}
+
+static void blackbox_thread(void) {
+    int err = partition_open();
+
+    if (err) {
+        // Nothing is consumed, so writers just count drops
+        printf("Black box: partition unusable (error: %d)\n", err);
+        return;
+    }
+    blackbox_write(BLACKBOX_BOOT, 0, blackbox_index_next_seq(&layout), 0);
+
+    // Batching a flush interval per write is what keeps flash wear down
+    for (;;) {
+        write_summary();
+        drain();
+        if (atomic_cas(&readout_requested, true, false)) {
+            readout();
+        }
+        k_sem_take(&wake, K_MSEC(CONFIG_CHRONOS_BLACKBOX_FLUSH_MS));
+    }
+}
+
+K_THREAD_DEFINE(blackbox_thread_id, CONFIG_CHRONOS_BLACKBOX_STACK_SIZE, blackbox_thread,
+                NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
@@ -0,0 +1,34 @@
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <zephyr/types.h>
+#include "blackbox_block.h"
+
+// Flash black box: what the device delivered, kept across resets. Records
+// are staged in a lock-free RAM ring from any context, including the timer
+// ISR, and the black box thread appends them to the blackbox_partition in
+// whole blocks at the lowest priority, so recording never waits on flash.
+// Once the partition is full the oldest page is erased for the next block.
+//
+// Readout frame on the telemetry link: u8 magic, u8 flags, u16 frame_seq,
+// then one block; a frame with BLACKBOX_FRAME_LAST and no block ends it.
+#define BLACKBOX_FRAME_MAGIC    0xC9
+#define BLACKBOX_FRAME_HEADER_LEN 4
+#define BLACKBOX_FRAME_LAST     0x01
+
+typedef struct {
+    uint32_t records;           // records written to flash
+    uint32_t blocks;            // blocks written
+    uint32_t dropped;           // records lost to a full staging ring
+    uint32_t failures;          // flash reads, writes or erases that failed
+    uint32_t readouts;          // readouts completed
+} blackbox_stats;
+
+// Any context, the zero-latency timer interrupt included; records before the
+// partition is scanned wait in the ring
+void blackbox_write(blackbox_type type, uint8_t index, uint32_t value0, uint32_t value1);
+// Flush and stream every block, oldest first, from the black box thread
+void blackbox_read(void);
+void get_blackbox_stats(blackbox_stats *stats);
+
+#endif // BLACKBOX_H
@@ -0,0 +1,97 @@
+#include <zephyr/types.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/toolchain.h>
+#include <errno.h>
+#include <string.h>
+#include "blackbox_block.h"
+
+BUILD_ASSERT(sizeof(blackbox_header) == BLACKBOX_HEADER_LEN, "blackbox_header layout");
+BUILD_ASSERT(sizeof(blackbox_record) == BLACKBOX_RECORD_LEN, "blackbox_record layout");
+
+#define ERASED_BYTE 0xFF
+
+static uint16_t block_crc(const blackbox_header *header, const uint8_t *records) {
+    uint16_t crc = crc16_itu_t(0xFFFF, (const uint8_t *)&header->seq, sizeof(header->seq));
+
+    crc = crc16_itu_t(crc, (const uint8_t *)&header->count, sizeof(header->count));
+    return crc16_itu_t(crc, records, header->count * BLACKBOX_RECORD_LEN);
+}
+
+int blackbox_block_pack(uint8_t *block, uint32_t seq, const blackbox_record *records,
+                        size_t count) {
+    blackbox_header header = {
+        .magic = BLACKBOX_BLOCK_MAGIC,
+        .seq = seq,
+        .count = count,
+        .reserved = 0xFFFFFFFF,
+    };
+
+    if ((count == 0) || (count > BLACKBOX_BLOCK_RECORDS)) {
+        return -EINVAL;
+    }
+    memset(block, ERASED_BYTE, BLACKBOX_BLOCK_LEN);
+    memcpy(block + BLACKBOX_HEADER_LEN, records, count * BLACKBOX_RECORD_LEN);
+    header.crc = block_crc(&header, block + BLACKBOX_HEADER_LEN);
+    memcpy(block, &header, sizeof(header));
+    return 0;
+}
+
+int blackbox_block_check(const uint8_t *block, uint32_t *seq) {
+    blackbox_header header;
+
+    memcpy(&header, block, sizeof(header));
+    if (header.magic != BLACKBOX_BLOCK_MAGIC) {
+        for (size_t i = 0; i < BLACKBOX_BLOCK_LEN; i++) {
+            if (block[i] != ERASED_BYTE) {
+                return -EBADMSG;
+            }
+        }
+        return -ENOENT;
+    }
+    if ((header.count == 0) || (header.count > BLACKBOX_BLOCK_RECORDS) ||
+        (header.crc != block_crc(&header, block + BLACKBOX_HEADER_LEN))) {
+        return -EBADMSG;
+    }
+    *seq = header.seq;
+    return header.count;
+}
+
+int blackbox_index_init(blackbox_index *index, uint32_t partition_size, uint32_t page_size) {
+    memset(index, 0, sizeof(*index));
+    if ((page_size < BLACKBOX_BLOCK_LEN) || ((partition_size / page_size) < 2)) {
+        return -EINVAL;
+    }
+    index->page_size = page_size;
+    index->blocks_per_page = page_size / BLACKBOX_BLOCK_LEN;
+    index->block_count = (partition_size / page_size) * index->blocks_per_page;
+    return 0;
+}
+
+uint32_t blackbox_block_offset(const blackbox_index *index, uint32_t block) {
+    return (block / index->blocks_per_page) * index->page_size +
+           (block % index->blocks_per_page) * BLACKBOX_BLOCK_LEN;
+}
+
+bool blackbox_block_starts_page(const blackbox_index *index, uint32_t block) {
+    return (block % index->blocks_per_page) == 0;
+}
+
+void blackbox_index_note(blackbox_index *index, uint32_t block, uint32_t seq) {
+    // seq may wrap around, so newer means a small positive distance
+    if (!index->found || ((int32_t)(seq - index->newest_seq) > 0)) {
+        index->found = true;
+        index->newest_block = block;
+        index->newest_seq = seq;
+    }
+}
+
+uint32_t blackbox_index_next(const blackbox_index *index) {
+    if (!index->found) {
+        return 0;
+    }
+    return (index->newest_block + 1) % index->block_count;
+}
+
+uint32_t blackbox_index_next_seq(const blackbox_index *index) {
+    return index->found ? index->newest_seq + 1 : 1;
+}
@@ -0,0 +1,76 @@
+#ifndef BLACKBOX_BLOCK_H
+#define BLACKBOX_BLOCK_H
+
+#include <zephyr/types.h>
+
+// On-flash format of the black box: the partition is an append-only ring
+// of fixed 240-byte blocks, written whole, never across a flash page and
+// never rewritten until their page is erased for reuse. All little endian.
+//
+//   header: u32 magic, u32 seq, u16 record_count, u16 crc, u32 reserved
+//   record: u32 timestamp (ms), u8 type, u8 index, u16 reserved, u32 value[2]
+//
+// seq increases by one per block across pages and reboots, so the newest
+// block, and with it the write position, is found again by a scan. crc is
+// CRC-16/ITU-T (seed 0xFFFF) over seq, record_count and the records; a
+// block cut short by a reset fails it and is skipped. A readout frame is the
+// block behind a 4-byte header, so it fits a 244-byte notification.
+#define BLACKBOX_BLOCK_MAGIC    0x31424243  // "CBB1"
+#define BLACKBOX_BLOCK_LEN      240
+#define BLACKBOX_HEADER_LEN     16
+#define BLACKBOX_RECORD_LEN     16
+#define BLACKBOX_BLOCK_RECORDS  ((BLACKBOX_BLOCK_LEN - BLACKBOX_HEADER_LEN) / BLACKBOX_RECORD_LEN)
+
+typedef enum {
+    BLACKBOX_BOOT = 1,          // value: seq of the first block of this boot
+    BLACKBOX_SETTING = 2,       // value: frequency << 16 | pulse width, DAC amplitude
+    BLACKBOX_PULSES = 3,        // value: pulses delivered since boot
+    BLACKBOX_SPI_ERROR = 4,     // value: nrfx error, chip select pin
+    BLACKBOX_CONNECTED = 5,
+    BLACKBOX_DISCONNECTED = 6,  // index: HCI reason
+    BLACKBOX_DROPPED = 7,       // value: records lost to a full staging ring
+} blackbox_type;
+
+typedef struct {
+    uint32_t timestamp;         // k_uptime ms
+    uint8_t type;               // blackbox_type
+    uint8_t index;
+    uint16_t reserved;
+    uint32_t value[2];
+} blackbox_record;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t count;
+    uint16_t crc;
+    uint32_t reserved;
+} blackbox_header;
+
+// Fills block, padded with the erased value; -EINVAL for 0 or too many records
+int blackbox_block_pack(uint8_t *block, uint32_t seq, const blackbox_record *records,
+                        size_t count);
+// Record count of a written block, -ENOENT for an erased one, -EBADMSG otherwise
+int blackbox_block_check(const uint8_t *block, uint32_t *seq);
+
+// Block positions in the partition and the newest block written
+typedef struct {
+    uint32_t page_size;
+    uint32_t blocks_per_page;
+    uint32_t block_count;
+    bool found;                 // any block written
+    uint32_t newest_block;
+    uint32_t newest_seq;
+} blackbox_index;
+
+// -EINVAL unless the partition holds at least two whole pages of blocks
+int blackbox_index_init(blackbox_index *index, uint32_t partition_size, uint32_t page_size);
+uint32_t blackbox_block_offset(const blackbox_index *index, uint32_t block);
+bool blackbox_block_starts_page(const blackbox_index *index, uint32_t block);
+// A valid block found by the scan, or just written
+void blackbox_index_note(blackbox_index *index, uint32_t block, uint32_t seq);
+// Where the next block goes and its seq; also where the oldest block may be
+uint32_t blackbox_index_next(const blackbox_index *index);
+uint32_t blackbox_index_next_seq(const blackbox_index *index);
+
+#endif // BLACKBOX_BLOCK_H
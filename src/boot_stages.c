@@ -0,0 +1,77 @@
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <cmsis_core.h>
+#include <stdio.h>
+#include "boot_stages.h"
+
+#define BOOT_STAGE_NAME(id, name) [id] = name,
+static const char *const stage_names[BOOT_STAGE_COUNT] = {
+    BOOT_STAGES(BOOT_STAGE_NAME)
+};
+#undef BOOT_STAGE_NAME
+
+// 0 until reached. A stamp is never 0 once set, at the cost of one cycle.
+static atomic_t stamps[BOOT_STAGE_COUNT];
+
+static int boot_stages_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    boot_stage_mark(BOOT_KERNEL);
+    return 0;
+}
+
+SYS_INIT(boot_stages_init, PRE_KERNEL_1, 0);
+
+void boot_stage_mark(boot_stage stage) {
+    uint32_t cycles = DWT->CYCCNT;
+
+    if (stage < BOOT_STAGE_COUNT) {
+        atomic_cas(&stamps[stage], 0, MAX(cycles, 1));
+    }
+}
+
+uint32_t boot_stage_cycles(boot_stage stage) {
+    return (stage < BOOT_STAGE_COUNT) ? atomic_get(&stamps[stage]) : 0;
+}
+
+bool boot_stages_done(void) {
+    return boot_stage_cycles(BOOT_ADVERTISING) != 0;
+}
+
+// Stages in the order they were reached, as time since the counter started
+// and since the stage before
+void boot_stages_print(void) {
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t printed = 0;
+    uint32_t previous = 0;
+
+    printf("Boot stages (us):\n");
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        int next = -1;
+
+        for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+            uint32_t cycles = boot_stage_cycles(stage);
+
+            if ((cycles == 0) || (printed & BIT(stage))) {
+                continue;
+            }
+            if ((next < 0) || (cycles < boot_stage_cycles(next))) {
+                next = stage;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        uint32_t cycles = boot_stage_cycles(next);
+        printf("  %10lu (+%lu) %s\n", cycles / cycles_per_us,
+               (cycles - previous) / cycles_per_us, stage_names[next]);
+        printed |= BIT(next);
+        previous = cycles;
+    }
+    for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+        if (!(printed & BIT(stage))) {
+            printf("  %10s        %s\n", "pending", stage_names[stage]);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef BOOT_STAGES_H
+#define BOOT_STAGES_H
+
+#include <zephyr/types.h>
+
+// Cycle-counter timestamps of the boot sequence. The DWT cycle counter is
+// started in PRE_KERNEL_1, so every stage is measured from the first init
+// level on; the reset handler and the RAM init before it are not counted.
+// main brings the stimulation engine up first and hands the slow stages
+// (UART line control, bt_enable, settings, advertising) to work queues, so
+// BOOT_FIRST_PULSE does not wait for any of them.
+#define BOOT_STAGES(X) \
+    X(BOOT_KERNEL,       "kernel init") \
+    X(BOOT_MAIN,         "main") \
+    X(BOOT_CLOCK,        "HFCLK running") \
+    X(BOOT_PROFILE,      "profile loaded") \
+    X(BOOT_STIM_READY,   "stimulation timer started") \
+    X(BOOT_FIRST_PULSE,  "first pulse") \
+    X(BOOT_UART,         "UART bridge up") \
+    X(BOOT_BT_ENABLED,   "bt_enable done") \
+    X(BOOT_SETTINGS,     "settings loaded") \
+    X(BOOT_ADVERTISING,  "advertising")
+
+#define BOOT_STAGE_ENUM(id, name) id,
+typedef enum {
+    BOOT_STAGES(BOOT_STAGE_ENUM)
+    BOOT_STAGE_COUNT
+} boot_stage;
+#undef BOOT_STAGE_ENUM
+
+// First call per stage wins; safe from any context, including the
+// zero-latency timer ISR
+void boot_stage_mark(boot_stage stage);
+// Cycles since the counter started, 0 if the stage has not been reached
+uint32_t boot_stage_cycles(boot_stage stage);
+bool boot_stages_done(void);
+void boot_stages_print(void);
+
+#endif // BOOT_STAGES_H
@@ -0,0 +1,210 @@
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+#include <zephyr/kernel.h>
+#include <stdio.h>
+#include "burst_gate.h"
+#include "timer.h"
+#include "config.h"
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+#include "telemetry.h"
+#endif
+
+// Across a gap between bursts the period-to-period EVENT0 measurement would
+// only record the gap
+BUILD_ASSERT(MEASURE_TIMER == 0, "MEASURE_TIMER does not support burst gating");
+
+static const nrfx_timer_t gate_timer = NRFX_TIMER_INSTANCE(BURST_TIMER_INST_IDX);
+static const nrfx_timer_t stim_timer = NRFX_TIMER_INSTANCE(TIMER_INST_IDX);
+static uint8_t start_channel;       // gate COMPARE2 -> TIMER0 START
+static uint8_t stop_channel;        // gate COMPARE1 -> TIMER0 STOP
+static bool gate_ready;
+
+typedef struct {
+    burst_setting setting;
+    burst_plan plan;
+} gate_request;
+
+// Command thread to the re-arm, same handoff as the stimulation parameters:
+// request is only written with request_ready cleared
+static gate_request request;
+static atomic_t request_ready;
+static burst_setting requested;     // command thread only
+
+// Written by gate_rearm, which runs either from the gate interrupt or from
+// TIMER0 EVENT3 with the gate stopped, never both at once
+static burst_setting active_setting;
+static burst_plan plan;
+static bool gate_running;
+static uint32_t burst_index;
+static uint32_t burst_start_pulses;
+
+static atomic_t bursts;
+static atomic_t last_pulses;
+static atomic_t short_bursts;
+
+static void gate_stop(void) {
+    nrfx_timer_disable(&gate_timer);
+    nrfx_gppi_channels_disable(BIT(start_channel) | BIT(stop_channel));
+    nrf_timer_event_clear(gate_timer.p_reg, NRF_TIMER_EVENT_COMPARE1);
+    nrf_timer_event_clear(gate_timer.p_reg, NRF_TIMER_EVENT_COMPARE2);
+}
+
+// Takes the queued request with the pulse train parked: TIMER0 stopped by
+// the gate, or past the last edge of a pulse in a continuous train. No
+// pulse is cut short, and both timers start together; from then on the gate
+// alone restarts TIMER0.
+static void gate_rearm(void) {
+    gate_stop();
+    active_setting = request.setting;
+    plan = request.plan;
+    if (active_setting.pulses == 0) {
+        gate_running = false;
+        nrfx_timer_resume(&stim_timer);
+        return;
+    }
+
+    burst_index = 0;
+    atomic_clear(&bursts);
+    atomic_clear(&last_pulses);
+    atomic_clear(&short_bursts);
+    timer_gate_prepare(plan.lead_ticks);
+    nrfx_timer_clear(&gate_timer);
+    nrfx_timer_compare(&gate_timer, NRF_TIMER_CC_CHANNEL1, plan.stop_ticks, true);
+    nrfx_timer_extended_compare(&gate_timer, NRF_TIMER_CC_CHANNEL2, plan.period_ticks,
+                                NRF_TIMER_SHORT_COMPARE2_CLEAR_MASK, false);
+    nrfx_gppi_channels_enable(BIT(start_channel) | BIT(stop_channel));
+    burst_start_pulses = get_pulse_count();
+    gate_running = true;
+    nrfx_timer_enable(&gate_timer);
+    nrfx_timer_resume(&stim_timer);
+}
+
+// COMPARE1, right after TIMER0 was stopped: the pulses of the burst that
+// ended, and the start path for the next boundary or a queued re-arm. The
+// next COMPARE2 is at least BURST_GUARD_US away.
+static void gate_handler(nrf_timer_event_t event_type, void *p_context) {
+    ARG_UNUSED(p_context);
+
+    if (event_type != NRF_TIMER_EVENT_COMPARE1) {
+        return;
+    }
+    uint32_t pulse_count = get_pulse_count();
+    uint32_t pulses = pulse_count - burst_start_pulses;
+
+    burst_start_pulses = pulse_count;
+    if (burst_plan_is_on(&plan, burst_index)) {
+        atomic_inc(&bursts);
+        atomic_set(&last_pulses, pulses);
+        if (pulses != active_setting.pulses) {
+            atomic_inc(&short_bursts);
+        }
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+        telemetry_write(TELEMETRY_BURST, 0, burst_index, pulses);
+#endif
+    }
+
+    if (atomic_clear(&request_ready)) {
+        gate_rearm();
+        return;
+    }
+    burst_index++;
+    if (burst_plan_is_on(&plan, burst_index)) {
+        nrfx_gppi_channels_enable(BIT(start_channel));
+    } else {
+        nrfx_gppi_channels_disable(BIT(start_channel));
+    }
+}
+
+int burst_gate_init(void) {
+    uint32_t base_frequency = NRF_TIMER_BASE_FREQUENCY_GET(gate_timer.p_reg);
+    nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG(base_frequency);
+
+    // Burst lengths are counted in TIMER0 periods on the gate timer
+    if (base_frequency != NRF_TIMER_BASE_FREQUENCY_GET(stim_timer.p_reg)) {
+        printf("Burst gate: timer base frequencies differ\n");
+        return -ENOTSUP;
+    }
+    config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    if (nrfx_timer_init(&gate_timer, &config, gate_handler) != NRFX_SUCCESS) {
+        printf("Burst gate timer initialization failed\n");
+        return -EIO;
+    }
+    IRQ_CONNECT(NRFX_IRQ_NUMBER_GET(NRF_TIMER_INST_GET(BURST_TIMER_INST_IDX)), IRQ_PRIO_LOWEST,
+                NRFX_TIMER_INST_HANDLER_GET(BURST_TIMER_INST_IDX), 0, 0);
+
+    if ((nrfx_gppi_channel_alloc(&start_channel) != NRFX_SUCCESS) ||
+        (nrfx_gppi_channel_alloc(&stop_channel) != NRFX_SUCCESS)) {
+        printf("Burst gate: no free (D)PPI channel\n");
+        return -ENOMEM;
+    }
+    nrfx_gppi_channel_endpoints_setup(start_channel,
+        nrfx_timer_compare_event_address_get(&gate_timer, NRF_TIMER_CC_CHANNEL2),
+        nrfx_timer_task_address_get(&stim_timer, NRF_TIMER_TASK_START));
+    nrfx_gppi_channel_endpoints_setup(stop_channel,
+        nrfx_timer_compare_event_address_get(&gate_timer, NRF_TIMER_CC_CHANNEL1),
+        nrfx_timer_task_address_get(&stim_timer, NRF_TIMER_TASK_STOP));
+    gate_ready = true;
+    return 0;
+}
+
+void burst_gate_pulse_end(void) {
+    // While the gate runs, its own interrupt takes the request
+    if (!gate_running && atomic_clear(&request_ready)) {
+        gate_rearm();
+    }
+}
+
+// Computed here so a setting that does not fit is refused right away; the
+// request is taken at the next park point
+static int gate_queue(const burst_setting *setting) {
+    burst_plan next = {0};
+    uint32_t last_edge_us = 2 * get_pulse_width_us() + SWITCH_PERIOD;
+
+    if (setting->pulses > 0) {
+        int err = burst_plan_compute(setting,
+                                     nrfx_timer_us_to_ticks(&stim_timer, get_stim_period_us()),
+                                     nrfx_timer_us_to_ticks(&stim_timer, last_edge_us),
+                                     nrfx_timer_us_to_ticks(&gate_timer, 1000), &next);
+        if (err) {
+            // The train keeps running as it was
+            return err;
+        }
+    }
+    atomic_clear(&request_ready);
+    request.setting = *setting;
+    request.plan = next;
+    atomic_set(&request_ready, 1);
+    requested = *setting;
+    return 0;
+}
+
+int burst_gate_set(const burst_setting *setting) {
+    if (!gate_ready) {
+        return -ENODEV;
+    }
+    int err = gate_queue(setting);
+    if (err) {
+        return err;
+    }
+    printf("Burst: %u pulses every %u ms, on %u s off %u s\n", setting->pulses,
+           setting->burst_period_ms, setting->train_on_s, setting->train_off_s);
+    return 0;
+}
+
+void burst_gate_refresh(void) {
+    if (!gate_ready || (requested.pulses == 0)) {
+        return;
+    }
+    if (gate_queue(&requested)) {
+        const burst_setting continuous = {0};
+
+        printf("Burst no longer fits the new pulse setting, continuous train\n");
+        gate_queue(&continuous);
+    }
+}
+
+void get_burst_stats(burst_stats *stats) {
+    stats->bursts = atomic_get(&bursts);
+    stats->last_pulses = atomic_get(&last_pulses);
+    stats->short_bursts = atomic_get(&short_bursts);
+}
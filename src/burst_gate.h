@@ -0,0 +1,31 @@
+#ifndef BURST_GATE_H
+#define BURST_GATE_H
+
+#include <zephyr/types.h>
+#include "burst_plan.h"
+
+// Hardware burst gate on TIMER2. COMPARE2 (burst period, self-clearing)
+// starts TIMER0 and COMPARE1 stops it through DPPI, so burst boundaries are
+// exact and the pulses inside a burst run on TIMER0 as in a continuous
+// train. The gate interrupt at COMPARE1 only counts the pulses of the burst
+// that just ended and opens or closes the start path for the next one,
+// which is how the train on/off windows are kept.
+#define BURST_TIMER_INST_IDX 2
+
+typedef struct {
+    uint32_t bursts;            // bursts delivered since the last setting
+    uint32_t last_pulses;       // pulses in the last delivered burst
+    uint32_t short_bursts;      // bursts with fewer or more pulses than set
+} burst_stats;
+
+int burst_gate_init(void);
+// Queues the setting for the end of the current burst, or of the current
+// pulse in a continuous train; pulses == 0 goes back to the continuous train
+int burst_gate_set(const burst_setting *setting);
+// After a new pulse setting: the gate times bursts in stimulation periods
+void burst_gate_refresh(void);
+// TIMER0 EVENT3 interrupt, after the pulse edges
+void burst_gate_pulse_end(void);
+void get_burst_stats(burst_stats *stats);
+
+#endif // BURST_GATE_H
@@ -0,0 +1,48 @@
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include "burst_plan.h"
+
+// Nearest whole number of bursts, at least one
+static uint32_t window_bursts(uint16_t window_s, uint16_t burst_period_ms) {
+    uint32_t bursts = ((uint32_t)window_s * 1000 + burst_period_ms / 2) / burst_period_ms;
+    return MAX(bursts, 1);
+}
+
+int burst_plan_compute(const burst_setting *setting, uint32_t stim_period_ticks,
+                       uint32_t last_edge_ticks, uint32_t ticks_per_ms, burst_plan *plan) {
+    uint32_t lead_ticks = MAX(ticks_per_ms * BURST_LEAD_US / 1000, 1);
+    uint64_t stop_ticks = (uint64_t)setting->pulses * stim_period_ticks;
+    uint64_t period_ticks = (uint64_t)setting->burst_period_ms * ticks_per_ms;
+    uint64_t guard_ticks = (uint64_t)BURST_GUARD_US * ticks_per_ms / 1000;
+
+    if ((setting->pulses == 0) || (setting->burst_period_ms == 0) || (ticks_per_ms == 0)) {
+        return -EINVAL;
+    }
+    // The timer is stopped between the last edge and the next EVENT0
+    if (stim_period_ticks <= last_edge_ticks + lead_ticks) {
+        return -EINVAL;
+    }
+    if ((period_ticks > UINT32_MAX) || (stop_ticks + guard_ticks > period_ticks)) {
+        return -ERANGE;
+    }
+    if ((setting->train_off_s > 0) && (setting->train_on_s == 0)) {
+        return -EINVAL;
+    }
+
+    plan->lead_ticks = lead_ticks;
+    plan->stop_ticks = (uint32_t)stop_ticks;
+    plan->period_ticks = (uint32_t)period_ticks;
+    plan->on_bursts = 0;
+    plan->cycle_bursts = 1;
+    if (setting->train_off_s > 0) {
+        plan->on_bursts = window_bursts(setting->train_on_s, setting->burst_period_ms);
+        plan->cycle_bursts = plan->on_bursts +
+                             window_bursts(setting->train_off_s, setting->burst_period_ms);
+    }
+    return 0;
+}
+
+bool burst_plan_is_on(const burst_plan *plan, uint32_t burst) {
+    return (plan->on_bursts == 0) || ((burst % plan->cycle_bursts) < plan->on_bursts);
+}
@@ -0,0 +1,36 @@
+#ifndef BURST_PLAN_H
+#define BURST_PLAN_H
+
+#include <zephyr/types.h>
+
+// Burst gating of the pulse train. A gate timer, ticking at the rate of the
+// stimulation timer, starts the stimulation timer at every burst boundary and
+// stops it again after a whole number of periods, so each burst holds exactly
+// `pulses` pulses. The stimulation timer is left stopped lead_ticks short of
+// its next EVENT0, which makes every burst open with a full pulse.
+#define BURST_LEAD_US 1         // burst boundary to the first pulse edge
+#define BURST_GUARD_US 1000     // gate interrupt slack between two bursts
+
+typedef struct {
+    uint16_t pulses;            // per burst, 0 turns gating off
+    uint16_t burst_period_ms;   // burst start to burst start
+    uint16_t train_on_s;        // on/off duty cycling, off with train_off_s 0
+    uint16_t train_off_s;
+} burst_setting;
+
+typedef struct {
+    uint32_t lead_ticks;        // first EVENT0 after a burst boundary
+    uint32_t stop_ticks;        // gate tick that stops the stimulation timer
+    uint32_t period_ticks;      // gate timer period
+    uint32_t on_bursts;         // bursts per duty cycle with pulses, 0: all
+    uint32_t cycle_bursts;      // bursts per duty cycle
+} burst_plan;
+
+// stim_period_ticks and last_edge_ticks are the committed pulse period and
+// EVENT3, both in gate ticks. Train windows are rounded to whole bursts.
+int burst_plan_compute(const burst_setting *setting, uint32_t stim_period_ticks,
+                       uint32_t last_edge_ticks, uint32_t ticks_per_ms, burst_plan *plan);
+// Whether burst number `burst` since the gate started is delivered
+bool burst_plan_is_on(const burst_plan *plan, uint32_t burst);
+
+#endif // BURST_PLAN_H
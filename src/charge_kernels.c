@@ -0,0 +1,85 @@
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+#include "charge_kernels.h"
+#if defined(__ARM_FEATURE_DSP)
+#include <cmsis_core.h>
+#endif
+
+#if defined(__ARM_FEATURE_DSP)
+int32_t charge_sum_q15(const int16_t *samples, size_t count) {
+    uint32_t sum = 0;
+    size_t i = 0;
+
+    // SMLAD with 1, 1 adds both halfwords of a word; four samples per pass.
+    // memcpy keeps the loads legal for a 2-byte aligned buffer and compiles
+    // to plain LDRs.
+    for (; i + 4 <= count; i += 4) {
+        uint32_t pair0, pair1;
+        memcpy(&pair0, &samples[i], sizeof(pair0));
+        memcpy(&pair1, &samples[i + 2], sizeof(pair1));
+        sum = __SMLAD(pair0, 0x00010001, sum);
+        sum = __SMLAD(pair1, 0x00010001, sum);
+    }
+    for (; i < count; i++) {
+        sum += (uint32_t)(int32_t)samples[i];
+    }
+    return (int32_t)sum;
+}
+#else
+int32_t charge_sum_q15(const int16_t *samples, size_t count) {
+    int32_t sum = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    return sum;
+}
+#endif
+
+int32_t charge_expected_mean(uint16_t dac_code, int32_t lsb_per_1k_codes) {
+    return ((int32_t)dac_code - 0x8000) * lsb_per_1k_codes / 1024;
+}
+
+static int64_t abs64(int64_t value) {
+    return (value < 0) ? -value : value;
+}
+
+// Below (100 - pct)% of the expected magnitude, or the wrong polarity
+static bool compliance_short(int32_t mean, int32_t expected, uint8_t pct) {
+    if (expected == 0) {
+        return false;
+    }
+    if ((int64_t)mean * expected < 0) {
+        return true;
+    }
+    return (abs64(mean) * 100) < (abs64(expected) * (100 - pct));
+}
+
+void charge_pulse_evaluate(const int16_t *const samples[CHARGE_PHASE_COUNT],
+                           const size_t count[CHARGE_PHASE_COUNT],
+                           const charge_limits *limits, charge_pulse *pulse) {
+    static const uint32_t compliance_alerts[CHARGE_PHASE_COUNT] = {
+        CHARGE_ALERT_COMPLIANCE_CATHODIC, CHARGE_ALERT_COMPLIANCE_ANODIC,
+    };
+
+    pulse->alerts = 0;
+    for (size_t phase = 0; phase < CHARGE_PHASE_COUNT; phase++) {
+        size_t n = MIN(count[phase], UINT16_MAX);
+
+        pulse->samples[phase] = n;
+        pulse->charge[phase] = charge_sum_q15(samples[phase], n) -
+                               (int32_t)limits->baseline * (int32_t)n;
+        pulse->mean[phase] = (n > 0) ? pulse->charge[phase] / (int32_t)n : 0;
+        if ((n > 0) && compliance_short(pulse->mean[phase], limits->expected[phase],
+                                         limits->compliance_pct)) {
+            pulse->alerts |= compliance_alerts[phase];
+        }
+    }
+
+    pulse->residual = pulse->charge[CHARGE_PHASE_CATHODIC] + pulse->charge[CHARGE_PHASE_ANODIC];
+    if ((abs64(pulse->residual) * 100) >
+        (abs64(pulse->charge[CHARGE_PHASE_CATHODIC]) * limits->residual_pct)) {
+        pulse->alerts |= CHARGE_ALERT_RESIDUAL;
+    }
+}
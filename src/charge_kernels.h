@@ -0,0 +1,46 @@
+#ifndef CHARGE_KERNELS_H
+#define CHARGE_KERNELS_H
+
+#include <zephyr/types.h>
+
+// Charge balance of one biphasic pulse from the current-sense samples of its
+// two phases. Charges are sums of SAADC codes relative to the zero-current
+// baseline, i.e. LSB x samples; the sample interval and the sense gain turn
+// them into coulombs. Phases are limited to 65535 samples.
+typedef enum {
+    CHARGE_PHASE_CATHODIC,      // EVENT0..EVENT1, DAC1 code
+    CHARGE_PHASE_ANODIC,        // EVENT2..EVENT3, DAC2 code
+    CHARGE_PHASE_COUNT
+} charge_phase;
+
+#define CHARGE_ALERT_RESIDUAL (1 << 0)
+#define CHARGE_ALERT_COMPLIANCE_CATHODIC (1 << 1)
+#define CHARGE_ALERT_COMPLIANCE_ANODIC (1 << 2)
+
+typedef struct {
+    int16_t baseline;                       // SAADC code at zero current
+    int32_t expected[CHARGE_PHASE_COUNT];   // expected mean, LSB from baseline
+    uint8_t residual_pct;                   // allowed residual, % of cathodic charge
+    uint8_t compliance_pct;                 // allowed shortfall of a phase mean, %
+} charge_limits;
+
+typedef struct {
+    int32_t charge[CHARGE_PHASE_COUNT];
+    int32_t mean[CHARGE_PHASE_COUNT];
+    uint16_t samples[CHARGE_PHASE_COUNT];
+    int32_t residual;                       // cathodic + anodic charge
+    uint32_t alerts;                        // CHARGE_ALERT_*
+} charge_pulse;
+
+// Sum of count samples. With the DSP extension two samples are added per
+// SMLAD instruction.
+int32_t charge_sum_q15(const int16_t *samples, size_t count);
+// Expected phase mean for a DAC8832 bipolar code (0x8000 is 0 V), given the
+// sense path gain in SAADC LSB per 1024 DAC codes
+int32_t charge_expected_mean(uint16_t dac_code, int32_t lsb_per_1k_codes);
+// A phase without samples is reported but never raises a compliance alert
+void charge_pulse_evaluate(const int16_t *const samples[CHARGE_PHASE_COUNT],
+                           const size_t count[CHARGE_PHASE_COUNT],
+                           const charge_limits *limits, charge_pulse *pulse);
+
+#endif // CHARGE_KERNELS_H
@@ -0,0 +1,268 @@
+#include <nrfx_timer.h>
+#include <hal/nrf_saadc.h>
+#include <helpers/nrfx_gppi.h>
+#include <zephyr/kernel.h>
+#include <stdio.h>
+#include "charge_monitor.h"
+#include "timer.h"
+#include "spi.h"
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+#include "telemetry.h"
+#endif
+
+#define CHARGE_BUFFERS 4            // two pulses in flight
+#define CHARGE_MAX_SAMPLES CONFIG_CHRONOS_CHARGE_MAX_SAMPLES
+#define CHARGE_RESULT_DEPTH 8
+#define SAADC_TIMER_CC (CONFIG_CHRONOS_CHARGE_SAMPLE_US * 16)    // 16 MHz SAADC clock
+
+BUILD_ASSERT((SAADC_TIMER_CC >= 80) && (SAADC_TIMER_CC <= 2047),
+             "CONFIG_CHRONOS_CHARGE_SAMPLE_US is outside the SAADC timer range");
+
+typedef struct {
+    uint32_t ordinal;           // phase number since init, selects the buffer
+    uint16_t samples;
+    uint8_t phase;              // charge_phase
+} phase_result;
+
+static const nrfx_timer_t stim_timer = NRFX_TIMER_INSTANCE(TIMER_INST_IDX);
+static int16_t buffers[CHARGE_BUFFERS][CHARGE_MAX_SAMPLES] __aligned(4);
+
+// SAADC interrupt only
+static uint32_t started;            // STARTED events so far
+static uint32_t stopped;            // STOPPED events so far
+
+// DPPI channels that start and stop a conversion, enabled together at the
+// first pulse end after init
+static uint8_t start_channel;
+static uint8_t stop_channel;
+static atomic_t links_pending;
+
+// Finished phases, SAADC interrupt to thread, same scheme as the command
+// queue
+static phase_result results[CHARGE_RESULT_DEPTH];
+static atomic_t result_head;
+static atomic_t result_tail;
+static atomic_t started_ordinal;    // copy of started for the thread
+static K_SEM_DEFINE(results_ready, 0, 1);
+
+static atomic_t pulses;
+static atomic_t residual_alerts;
+static atomic_t compliance_alerts;
+static atomic_t overruns;
+static struct k_spinlock last_lock;
+static charge_pulse last_pulse;
+
+static void result_push(uint32_t ordinal, uint16_t samples, uint8_t phase) {
+    atomic_val_t head = atomic_get(&result_head);
+
+    if ((head - atomic_get(&result_tail)) >= CHARGE_RESULT_DEPTH) {
+        atomic_inc(&overruns);
+        return;
+    }
+    results[head & (CHARGE_RESULT_DEPTH - 1)] = (phase_result){
+        .ordinal = ordinal,
+        .samples = samples,
+        .phase = phase,
+    };
+    atomic_set(&result_head, head + 1);
+    k_sem_give(&results_ready);
+}
+
+// Lowest priority: only moves the EasyDMA pointer on and reports finished
+// phases. RESULT.PTR is double buffered, so the next buffer is set as soon
+// as a phase has started. Both events are often pending together; the stop
+// belongs to the conversion before the start, so it goes first.
+static void saadc_isr(const void *arg) {
+    ARG_UNUSED(arg);
+
+    if (nrf_saadc_event_check(NRF_SAADC, NRF_SAADC_EVENT_STOPPED)) {
+        nrf_saadc_event_clear(NRF_SAADC, NRF_SAADC_EVENT_STOPPED);
+        uint32_t ordinal = stopped++;
+        if (ordinal != started - 1) {
+            // Events merged behind a late interrupt; the buffers of those
+            // phases were overwritten anyway
+            atomic_inc(&overruns);
+        }
+        // The links went live after COMPARE3, so conversion 0 was started
+        // by COMPARE0 and the starts alternate from there
+        result_push(ordinal, nrf_saadc_amount_get(NRF_SAADC),
+                    (ordinal & 1) ? CHARGE_PHASE_ANODIC : CHARGE_PHASE_CATHODIC);
+    }
+    if (nrf_saadc_event_check(NRF_SAADC, NRF_SAADC_EVENT_STARTED)) {
+        nrf_saadc_event_clear(NRF_SAADC, NRF_SAADC_EVENT_STARTED);
+        started++;
+        atomic_set(&started_ordinal, started);
+        nrf_saadc_buffer_init(NRF_SAADC, buffers[started % CHARGE_BUFFERS], CHARGE_MAX_SAMPLES);
+    }
+}
+
+void charge_monitor_pulse_end(void) {
+    // The rest of the period is left before COMPARE0, ample time for the
+    // first start to find the links enabled
+    if (atomic_cas(&links_pending, 1, 0)) {
+        nrfx_gppi_channels_enable(BIT(start_channel) | BIT(stop_channel));
+    }
+}
+
+static int ppi_connect(const uint32_t *events, size_t event_count, uint32_t task,
+                       uint8_t *channel) {
+    if (nrfx_gppi_channel_alloc(channel) != NRFX_SUCCESS) {
+        return -ENOMEM;
+    }
+    // Several publishers on one channel: a SAADC task subscribes to one only
+    for (size_t i = 0; i < event_count; i++) {
+        nrfx_gppi_event_endpoint_setup(*channel, events[i]);
+    }
+    nrfx_gppi_task_endpoint_setup(*channel, task);
+    return 0;
+}
+
+int charge_monitor_init(void) {
+    const nrf_saadc_channel_config_t config = {
+        .resistor_p = NRF_SAADC_RESISTOR_DISABLED,
+        .resistor_n = NRF_SAADC_RESISTOR_DISABLED,
+        .gain = NRF_SAADC_GAIN1_6,
+        .reference = NRF_SAADC_REFERENCE_INTERNAL,
+        .acq_time = NRF_SAADC_ACQTIME_3US,
+        .mode = NRF_SAADC_MODE_SINGLE_ENDED,
+        .burst = NRF_SAADC_BURST_DISABLED,
+    };
+    const uint32_t phase_starts[] = {
+        nrfx_timer_compare_event_address_get(&stim_timer, NRF_TIMER_CC_CHANNEL0),
+        nrfx_timer_compare_event_address_get(&stim_timer, NRF_TIMER_CC_CHANNEL2),
+    };
+    const uint32_t phase_ends[] = {
+        nrfx_timer_compare_event_address_get(&stim_timer, NRF_TIMER_CC_CHANNEL1),
+        nrfx_timer_compare_event_address_get(&stim_timer, NRF_TIMER_CC_CHANNEL3),
+    };
+    const uint32_t started_event = nrf_saadc_event_address_get(NRF_SAADC, NRF_SAADC_EVENT_STARTED);
+    uint8_t sample_channel;
+    int err;
+
+    nrf_saadc_resolution_set(NRF_SAADC, NRF_SAADC_RESOLUTION_12BIT);
+    nrf_saadc_oversample_set(NRF_SAADC, NRF_SAADC_OVERSAMPLE_DISABLED);
+    nrf_saadc_channel_init(NRF_SAADC, 0, &config);
+    nrf_saadc_channel_input_set(NRF_SAADC, 0,
+                                NRF_SAADC_INPUT_AIN0 + CONFIG_CHRONOS_CHARGE_AIN,
+                                NRF_SAADC_INPUT_DISABLED);
+    nrf_saadc_continuous_mode_enable(NRF_SAADC, SAADC_TIMER_CC);
+    nrf_saadc_buffer_init(NRF_SAADC, buffers[0], CHARGE_MAX_SAMPLES);
+    nrf_saadc_int_enable(NRF_SAADC, NRF_SAADC_INT_STARTED | NRF_SAADC_INT_STOPPED);
+    IRQ_CONNECT(SAADC_IRQn, IRQ_PRIO_LOWEST, saadc_isr, NULL, 0);
+    irq_enable(SAADC_IRQn);
+    nrf_saadc_enable(NRF_SAADC);
+
+    err = ppi_connect(phase_starts, ARRAY_SIZE(phase_starts),
+                      nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_START), &start_channel);
+    if (!err) {
+        // The internal timer keeps sampling from the first SAMPLE on
+        err = ppi_connect(&started_event, 1,
+                          nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_SAMPLE),
+                          &sample_channel);
+    }
+    if (!err) {
+        err = ppi_connect(phase_ends, ARRAY_SIZE(phase_ends),
+                          nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_STOP), &stop_channel);
+    }
+    if (!err) {
+        nrfx_gppi_channels_enable(BIT(sample_channel));
+        // The train is already running; the next pulse end enables the
+        // start and stop links so that conversions pair up from a cathodic one
+        atomic_set(&links_pending, 1);
+    }
+    if (err) {
+        printf("Charge monitor setup failed with error: %d\n", err);
+        return err;
+    }
+    printf("Charge monitor on AIN%d, one sample every %d us\n",
+           CONFIG_CHRONOS_CHARGE_AIN, CONFIG_CHRONOS_CHARGE_SAMPLE_US);
+    return 0;
+}
+
+void get_charge_stats(charge_stats *stats) {
+    stats->pulses = atomic_get(&pulses);
+    stats->residual_alerts = atomic_get(&residual_alerts);
+    stats->compliance_alerts = atomic_get(&compliance_alerts);
+    stats->overruns = atomic_get(&overruns);
+    k_spinlock_key_t key = k_spin_lock(&last_lock);
+    stats->last = last_pulse;
+    k_spin_unlock(&last_lock, key);
+}
+
+// A buffer is reused once CHARGE_BUFFERS phases later; keep one phase of
+// margin for the pointer set ahead of time.
+static bool buffer_valid(uint32_t ordinal) {
+    return (uint32_t)(atomic_get(&started_ordinal) - ordinal) < (CHARGE_BUFFERS - 1);
+}
+
+static void evaluate(const phase_result *cathodic, const phase_result *anodic) {
+    const int16_t *const samples[CHARGE_PHASE_COUNT] = {
+        buffers[cathodic->ordinal % CHARGE_BUFFERS], buffers[anodic->ordinal % CHARGE_BUFFERS],
+    };
+    const size_t count[CHARGE_PHASE_COUNT] = {cathodic->samples, anodic->samples};
+    // The codes the DAC transfers of this period sent, give or take a
+    // setting that landed in between
+    charge_limits limits = {
+        .baseline = CONFIG_CHRONOS_CHARGE_BASELINE,
+        .expected = {
+            charge_expected_mean((dac1_buf_tx[0] << 8) | dac1_buf_tx[1],
+                                 CONFIG_CHRONOS_CHARGE_LSB_PER_1K_CODES),
+            charge_expected_mean((dac2_buf_tx[0] << 8) | dac2_buf_tx[1],
+                                 CONFIG_CHRONOS_CHARGE_LSB_PER_1K_CODES),
+        },
+        .residual_pct = CONFIG_CHRONOS_CHARGE_RESIDUAL_PCT,
+        .compliance_pct = CONFIG_CHRONOS_CHARGE_COMPLIANCE_PCT,
+    };
+    charge_pulse pulse;
+
+    charge_pulse_evaluate(samples, count, &limits, &pulse);
+    if (!buffer_valid(cathodic->ordinal)) {
+        atomic_inc(&overruns);
+        return;
+    }
+
+    atomic_inc(&pulses);
+    if (pulse.alerts & CHARGE_ALERT_RESIDUAL) {
+        atomic_inc(&residual_alerts);
+    }
+    if (pulse.alerts & (CHARGE_ALERT_COMPLIANCE_CATHODIC | CHARGE_ALERT_COMPLIANCE_ANODIC)) {
+        atomic_inc(&compliance_alerts);
+    }
+    k_spinlock_key_t key = k_spin_lock(&last_lock);
+    last_pulse = pulse;
+    k_spin_unlock(&last_lock, key);
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+    telemetry_write(TELEMETRY_CHARGE, pulse.alerts, pulse.charge[CHARGE_PHASE_CATHODIC],
+                    pulse.charge[CHARGE_PHASE_ANODIC]);
+#endif
+}
+
+static void charge_monitor_thread(void) {
+    phase_result cathodic = {0};
+    bool have_cathodic = false;
+
+    for (;;) {
+        k_sem_take(&results_ready, K_FOREVER);
+
+        atomic_val_t tail = atomic_get(&result_tail);
+        while (tail != atomic_get(&result_head)) {
+            phase_result result = results[tail & (CHARGE_RESULT_DEPTH - 1)];
+            atomic_set(&result_tail, ++tail);
+
+            if (!buffer_valid(result.ordinal)) {
+                atomic_inc(&overruns);
+                have_cathodic = false;
+            } else if (result.phase == CHARGE_PHASE_CATHODIC) {
+                cathodic = result;
+                have_cathodic = true;
+            } else if (have_cathodic && (result.ordinal == cathodic.ordinal + 1)) {
+                evaluate(&cathodic, &result);
+                have_cathodic = false;
+            }
+        }
+    }
+}
+
+K_THREAD_DEFINE(charge_monitor_thread_id, CONFIG_CHRONOS_CHARGE_STACK_SIZE,
+                charge_monitor_thread, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO - 1,
+                0, 0);
@@ -0,0 +1,27 @@
+#ifndef CHARGE_MONITOR_H
+#define CHARGE_MONITOR_H
+
+#include <zephyr/types.h>
+#include "charge_kernels.h"
+
+// Delivered-charge feedback. The SAADC samples the current-sense input
+// during both phases of every pulse: TIMER0 COMPARE0/COMPARE2 start it and
+// COMPARE1/COMPARE3 stop it through DPPI, the internal SAADC timer paces the
+// samples and EasyDMA writes each phase into the next of a set of buffers.
+// The SAADC interrupt only hands finished buffers over; a low-priority
+// thread integrates them with the charge kernels. The pulse ISR only calls
+// charge_monitor_pulse_end, which enables the DPPI links once after init.
+typedef struct {
+    uint32_t pulses;            // pulses evaluated
+    uint32_t residual_alerts;
+    uint32_t compliance_alerts; // pulses with either phase short
+    uint32_t overruns;          // phases lost to a thread that fell behind
+    charge_pulse last;
+} charge_stats;
+
+int charge_monitor_init(void);
+void get_charge_stats(charge_stats *stats);
+// TIMER0 EVENT3 interrupt, after the pulse edges
+void charge_monitor_pulse_end(void);
+
+#endif // CHARGE_MONITOR_H
@@ -0,0 +1,96 @@
+#include <zephyr/kernel.h>
+#include <cmsis_core.h>
+#include <string.h>
+#include "cmd_queue.h"
+#include "data.h"
+
+BUILD_ASSERT((CMD_QUEUE_DEPTH & (CMD_QUEUE_DEPTH - 1)) == 0,
+             "CONFIG_CHRONOS_CMD_QUEUE_DEPTH must be a power of two");
+
+typedef struct {
+    uint32_t enqueue_cycles;
+    uint32_t rx_timestamp;      // DWT CYCCNT, the telemetry time base
+    uint16_t len;
+    uint8_t data[BLE_DATA_BUFFER_SIZE];
+} cmd_slot;
+
+// cmd_head is only written by the producer (BT RX) and cmd_tail only by the
+// consumer (work queue). Both count up freely; head - tail is the fill level.
+static cmd_slot slots[CMD_QUEUE_DEPTH];
+static atomic_t cmd_head;
+static atomic_t cmd_tail;
+
+static atomic_t processed;
+static atomic_t overflows;
+static atomic_t latency_total_us;
+static atomic_t latency_max_us;
+static uint32_t current_rx_timestamp;  // work queue only
+
+static K_THREAD_STACK_DEFINE(cmd_wq_stack, CONFIG_CHRONOS_CMD_WQ_STACK_SIZE);
+static struct k_work_q cmd_wq;
+static struct k_work cmd_work;
+
+static void cmd_work_handler(struct k_work *work) {
+    ARG_UNUSED(work);
+    atomic_val_t tail;
+
+    while ((tail = atomic_get(&cmd_tail)) != atomic_get(&cmd_head)) {
+        cmd_slot *slot = &slots[tail & (CMD_QUEUE_DEPTH - 1)];
+
+        current_rx_timestamp = slot->rx_timestamp;
+        process_received_data(&settings, slot->data, slot->len);
+
+        uint32_t latency = k_cyc_to_us_floor32(k_cycle_get_32() - slot->enqueue_cycles);
+        atomic_inc(&processed);
+        atomic_add(&latency_total_us, latency);
+        if (latency > (uint32_t)atomic_get(&latency_max_us)) {
+            atomic_set(&latency_max_us, latency);
+        }
+        // Slot is free for the producer again
+        atomic_set(&cmd_tail, tail + 1);
+    }
+}
+
+void cmd_queue_init(void) {
+    const struct k_work_queue_config config = {.name = "cmd_wq"};
+
+    k_work_queue_init(&cmd_wq);
+    k_work_queue_start(&cmd_wq, cmd_wq_stack, K_THREAD_STACK_SIZEOF(cmd_wq_stack),
+                       K_PRIO_PREEMPT(CONFIG_CHRONOS_CMD_WQ_PRIORITY), &config);
+    k_work_init(&cmd_work, cmd_work_handler);
+}
+
+// Bluetooth RX context: copy the write and leave. Never blocks.
+int cmd_queue_push(const uint8_t *data, uint16_t len) {
+    atomic_val_t head = atomic_get(&cmd_head);
+
+    if (len > BLE_DATA_BUFFER_SIZE) {
+        return -EMSGSIZE;
+    }
+    if ((head - atomic_get(&cmd_tail)) >= CMD_QUEUE_DEPTH) {
+        atomic_inc(&overflows);
+        return -ENOBUFS;
+    }
+
+    cmd_slot *slot = &slots[head & (CMD_QUEUE_DEPTH - 1)];
+    slot->rx_timestamp = DWT->CYCCNT;
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->enqueue_cycles = k_cycle_get_32();
+    // Publish the slot to the consumer
+    atomic_set(&cmd_head, head + 1);
+
+    k_work_submit_to_queue(&cmd_wq, &cmd_work);
+    return 0;
+}
+
+uint32_t cmd_queue_rx_timestamp(void) {
+    return current_rx_timestamp;
+}
+
+void get_cmd_stats(cmd_stats *stats) {
+    stats->processed = atomic_get(&processed);
+    stats->overflows = atomic_get(&overflows);
+    stats->latency_total_us = atomic_get(&latency_total_us);
+    stats->latency_max_us = atomic_get(&latency_max_us);
+}
@@ -0,0 +1,25 @@
+#ifndef CMD_QUEUE_H
+#define CMD_QUEUE_H
+
+#include <zephyr/types.h>
+
+// Received BLE writes are copied into a single-producer/single-consumer ring
+// by the Bluetooth RX callback and processed by a dedicated work queue, so
+// timer/SPI reconfiguration and printing never run in the BT host context.
+#define CMD_QUEUE_DEPTH CONFIG_CHRONOS_CMD_QUEUE_DEPTH
+
+typedef struct {
+    uint32_t processed;         // commands handed to process_received_data
+    uint32_t overflows;         // writes dropped because the ring was full
+    uint32_t latency_total_us;  // enqueue -> processed, summed
+    uint32_t latency_max_us;
+} cmd_stats;
+
+void cmd_queue_init(void);
+int cmd_queue_push(const uint8_t *data, uint16_t len);
+// DWT cycle count at which the command being processed was received, for
+// process_received_data on the command work queue only
+uint32_t cmd_queue_rx_timestamp(void);
+void get_cmd_stats(cmd_stats *stats);
+
+#endif // CMD_QUEUE_H
@@ -4,4 +4,30 @@
 #define MEASURE_TIMER 0 // 1: testing timer accuracy with built-in timer 
                         // 0: disable measurement timer
 #define SPI_VERBOSE 0   // 1: enable verbose SPI logging
+
+// Multi-channel mode wiring, in channel order: the DAC chip select and the
+// phase pin of each logical channel. Channel 0 is the single-channel output;
+// the others go to the expansion header.
+#define MULTICHANNEL_DAC_CS_PINS { \
+    NRF_GPIO_PIN_MAP(0, 16), NRF_GPIO_PIN_MAP(0, 26), NRF_GPIO_PIN_MAP(0, 4), NRF_GPIO_PIN_MAP(0, 5), \
+    NRF_GPIO_PIN_MAP(0, 6), NRF_GPIO_PIN_MAP(0, 10), NRF_GPIO_PIN_MAP(0, 11), NRF_GPIO_PIN_MAP(0, 12) }
+#define MULTICHANNEL_PHASE_PINS { \
+    NRF_GPIO_PIN_MAP(1, 3), NRF_GPIO_PIN_MAP(1, 4), NRF_GPIO_PIN_MAP(1, 5), NRF_GPIO_PIN_MAP(1, 6), \
+    NRF_GPIO_PIN_MAP(1, 7), NRF_GPIO_PIN_MAP(1, 8), NRF_GPIO_PIN_MAP(1, 9), NRF_GPIO_PIN_MAP(1, 10) }
+
+// Edge capture loopback inputs, jumpered to the P1.03, P1.00 and P1.01
+// stimulation outputs in that order.
+#define EDGE_CAPTURE_PINS { \
+    NRF_GPIO_PIN_MAP(1, 11), NRF_GPIO_PIN_MAP(1, 12), NRF_GPIO_PIN_MAP(1, 13) }
+
+// nRF54H20 DK wiring of the PPR sequencer: the biphasic outputs on P1 as on
+// the nRF5340 DK, the DAC bus on SPIM130 with the chip selects beside it.
+#define PPR_PHASE_PIN   NRF_GPIO_PIN_MAP(1, 3)
+#define PPR_SWITCH0_PIN NRF_GPIO_PIN_MAP(1, 0)
+#define PPR_SWITCH1_PIN NRF_GPIO_PIN_MAP(1, 1)
+#define PPR_SCK_PIN     NRF_GPIO_PIN_MAP(2, 1)
+#define PPR_MOSI_PIN    NRF_GPIO_PIN_MAP(2, 2)
+#define PPR_MISO_PIN    NRF_GPIO_PIN_MAP(2, 4)
+#define PPR_DAC1_CS_PIN NRF_GPIO_PIN_MAP(2, 5)
+#define PPR_DAC2_CS_PIN NRF_GPIO_PIN_MAP(2, 6)
 #endif // CONFIG_H
\ No newline at end of file
@@ -3,10 +3,282 @@
 #include "data.h"
 #include "timer.h"
 #include "spi.h"
+#if defined(CONFIG_CHRONOS_WAVEFORM) || defined(CONFIG_CHRONOS_MULTICHANNEL) || \
+    defined(CONFIG_CHRONOS_STIM_PROGRAM) || defined(CONFIG_CHRONOS_BURST) || \
+    defined(CONFIG_CHRONOS_TELEMETRY)
+#include <zephyr/sys/byteorder.h>
+#endif
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+#include "waveform.h"
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROGRAM)
+#include "program_engine.h"
+#endif
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+#include "telemetry.h"
+#include "cmd_queue.h"
+#endif
+#if defined(CONFIG_CHRONOS_BURST)
+#include "burst_gate.h"
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+#include "stim_profile.h"
+#endif
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+#include "low_power.h"
+#endif
+#if defined(CONFIG_CHRONOS_PPR)
+#include "ppr_link.h"
+#endif
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+#include "blackbox.h"
+#endif
 
 stim_setting settings;
-uint8_t ble_received_data[BLE_DATA_BUFFER_SIZE];
-uint16_t ble_data_length;
+
+// Shared by settings writes and profile selection. probe is a timed
+// setting's command seq + 1, 0 for none; only the TIMER0 pulse train reports
+// the first pulse on it.
+static void apply_settings(stim_setting *settings, uint32_t probe) {
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+    blackbox_write(BLACKBOX_SETTING, 0,
+                   ((uint32_t)settings->frequency << 16) | settings->pulse_width,
+                   settings->DAC_amplitude);
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+    // Becomes the setting the next boot starts with
+    stim_profile_note(settings);
+#endif
+#if defined(CONFIG_CHRONOS_MULTICHANNEL)
+    // The single-channel setting drives channel 0
+    int err = update_channel(0, settings->frequency, settings->pulse_width,
+                             SWITCH_PERIOD, settings->DAC_amplitude);
+    if (err) {
+        printf("Channel 0 update failed with error: %d\n", err);
+    }
+    return;
+#elif defined(CONFIG_CHRONOS_STIM_PROGRAM)
+    // Compiled into the biphasic program, played from the next loop
+    int err = program_load_setting(settings->frequency, settings->pulse_width,
+                                   settings->DAC_amplitude);
+    if (err) {
+        printf("Stimulation program update failed with error: %d\n", err);
+    }
+    return;
+#elif defined(CONFIG_CHRONOS_PPR)
+    // Compiled here, played by the PPR from the end of its current loop
+    int err = ppr_link_load_setting(settings->frequency, settings->pulse_width,
+                                    settings->DAC_amplitude);
+    if (err) {
+        printf("PPR program update failed with error: %d\n", err);
+    }
+#else
+    if (settings->frequency > 0) {
+        update_stim_frequency(settings->frequency);
+    } else {
+        printf("Warning: Received frequency is 0 Hz, timer not updated\n");
+    }
+    if (settings->pulse_width > 0) {
+        update_pulse_width(settings->pulse_width);
+    } else {
+        printf("Warning: Received pulse width is 0 us, pulse width not updated\n");
+    }
+    update_dac1_amplitude(settings->DAC_amplitude);
+    update_dac2_amplitude(settings->DAC_amplitude);
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+    // Costed for the new period and pulse width, switched with them
+    low_power_stage();
+#endif
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+    // Part of the block being committed, so it is only reported on it
+    if (probe) {
+        stim_params_probe(probe - 1);
+    }
+#endif
+    // Applied together at the start of the next period
+    stim_params_commit();
+#if defined(CONFIG_CHRONOS_BURST)
+    // Burst lengths are whole periods of the new setting
+    burst_gate_refresh();
+#endif
+#endif
+}
+
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+static int process_waveform_command(uint8_t opcode, const uint8_t *payload, uint16_t len) {
+    switch (opcode) {
+        case CMD_WAVEFORM_BEGIN:
+            if (len != 4) {
+                return -EINVAL;
+            }
+            return waveform_begin(sys_get_le16(&payload[0]), sys_get_le16(&payload[2]));
+        case CMD_WAVEFORM_DATA:
+            if ((len < 4) || (len % 2)) {
+                return -EINVAL;
+            }
+            return waveform_write(sys_get_le16(&payload[0]), &payload[2], (len - 2) / 2);
+        case CMD_WAVEFORM_COMMIT:
+            return waveform_commit();
+    }
+    return -ENOTSUP;
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_MULTICHANNEL)
+static int process_channel_command(const uint8_t *payload, uint16_t len) {
+    if (len != 9) {
+        return -EINVAL;
+    }
+    return update_channel(payload[0], sys_get_le16(&payload[1]), sys_get_le16(&payload[3]),
+                          sys_get_le16(&payload[5]), sys_get_le16(&payload[7]));
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_STIM_PROGRAM)
+static int process_program_command(uint8_t opcode, const uint8_t *payload, uint16_t len) {
+    switch (opcode) {
+        case CMD_PROGRAM_BEGIN:
+            // Padded so it is never taken for a settings write
+            if ((len != 4) || (sys_get_le16(&payload[2]) != 0)) {
+                return -EINVAL;
+            }
+            return program_begin(sys_get_le16(&payload[0]));
+        case CMD_PROGRAM_DATA:
+            if ((len < 2 + PROGRAM_WIRE_ENTRY_LEN) || ((len - 2) % PROGRAM_WIRE_ENTRY_LEN)) {
+                return -EINVAL;
+            }
+            return program_write(sys_get_le16(&payload[0]), &payload[2],
+                                 (len - 2) / PROGRAM_WIRE_ENTRY_LEN);
+        case CMD_PROGRAM_COMMIT:
+            return program_commit();
+    }
+    return -ENOTSUP;
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_BURST)
+static int process_burst_command(const uint8_t *payload, uint16_t len) {
+    if (len != 8) {
+        return -EINVAL;
+    }
+    burst_setting setting = {
+        .pulses = sys_get_le16(&payload[0]),
+        .burst_period_ms = sys_get_le16(&payload[2]),
+        .train_on_s = sys_get_le16(&payload[4]),
+        .train_off_s = sys_get_le16(&payload[6]),
+    };
+    return burst_gate_set(&setting);
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+static int process_profile_command(stim_setting *settings, uint8_t opcode,
+                                   const uint8_t *payload, uint16_t len) {
+    int err;
+
+    switch (opcode) {
+        case CMD_PROFILE_SAVE:
+            if (len != 1 + PROFILE_NAME_LEN) {
+                return -EINVAL;
+            }
+            return stim_profile_save(payload[0], (const char *)&payload[1], settings);
+        case CMD_PROFILE_SELECT:
+            if (len != 1) {
+                return -EINVAL;
+            }
+            err = stim_profile_select(payload[0], settings);
+            if (err == 0) {
+                apply_settings(settings, 0);
+            }
+            return err;
+        case CMD_PROFILE_DELETE:
+            if (len != 1) {
+                return -EINVAL;
+            }
+            return stim_profile_delete(payload[0]);
+    }
+    return -ENOTSUP;
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+// A settings write that reports when it was received, committed and first
+// delivered, so the host can split its latency into BLE transit, firmware
+// queueing and the wait for the pulse boundary
+static int process_timed_settings(stim_setting *settings, uint16_t seq,
+                                  const uint8_t *payload, uint16_t len) {
+    if (len != sizeof(uint32_t) + sizeof(stim_setting)) {
+        return -EINVAL;
+    }
+    telemetry_write_at(cmd_queue_rx_timestamp(), TELEMETRY_LATENCY, LATENCY_RX, seq,
+                       sys_get_le32(payload));
+    memcpy(settings, payload + sizeof(uint32_t), sizeof(stim_setting));
+    apply_settings(settings, (uint32_t)seq + 1);
+    telemetry_write(TELEMETRY_LATENCY, LATENCY_APPLY, seq, 0);
+    return 0;
+}
+#endif
+
+static void process_command(stim_setting *settings, const uint8_t *data, uint16_t len) {
+    const cmd_header *header = (const cmd_header *)data;
+    const uint8_t *payload = data + sizeof(cmd_header);
+    uint16_t payload_len = len - sizeof(cmd_header);
+    int err = -ENOTSUP;
+
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+    if ((header->opcode >= CMD_WAVEFORM_BEGIN) && (header->opcode <= CMD_WAVEFORM_COMMIT)) {
+        err = process_waveform_command(header->opcode, payload, payload_len);
+    }
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROGRAM)
+    if ((header->opcode >= CMD_PROGRAM_BEGIN) && (header->opcode <= CMD_PROGRAM_COMMIT)) {
+        err = process_program_command(header->opcode, payload, payload_len);
+    }
+#endif
+#if defined(CONFIG_CHRONOS_MULTICHANNEL)
+    if (header->opcode == CMD_CHANNEL_SET) {
+        err = process_channel_command(payload, payload_len);
+    }
+#endif
+#if defined(CONFIG_CHRONOS_BURST)
+    if (header->opcode == CMD_BURST_SET) {
+        err = process_burst_command(payload, payload_len);
+    }
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+    if ((header->opcode >= CMD_PROFILE_SAVE) && (header->opcode <= CMD_PROFILE_DELETE)) {
+        err = process_profile_command(settings, header->opcode, payload, payload_len);
+    }
+#endif
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+    if (header->opcode == CMD_TELEMETRY) {
+        err = -EINVAL;
+        if (payload_len == 1) {
+            telemetry_enable(payload[0] != 0);
+            err = 0;
+        }
+    }
+    if (header->opcode == CMD_SETTINGS_TIMED) {
+        err = process_timed_settings(settings, header->seq, payload, payload_len);
+    }
+#endif
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+    if (header->opcode == CMD_BLACKBOX_READ) {
+        err = -EINVAL;
+        if (payload_len == 0) {
+            blackbox_read();
+            err = 0;
+        }
+    }
+#endif
+    ARG_UNUSED(settings);
+    ARG_UNUSED(payload);
+    ARG_UNUSED(payload_len);
+    if (err) {
+        printf("Command 0x%02X (seq %u) failed with error: %d\n",
+               header->opcode, header->seq, err);
+    }
+}
 
 void process_received_data(stim_setting *settings, uint8_t *ble_received_data, uint16_t ble_data_length) {
     if (ble_data_length == sizeof(stim_setting)) {
@@ -18,20 +290,11 @@ void process_received_data(stim_setting *settings, uint8_t *ble_received_data, u
         printf("DAC Amplitude: %u\n", settings->DAC_amplitude);
         printf("Pulse Width: %u us\n", settings->pulse_width);
         printf("Frequency: %u Hz\n", settings->frequency);
-        if (settings->frequency > 0) {
-            update_stim_frequency(settings->frequency);
-        } else {
-            printf("Warning: Received frequency is 0 Hz, timer not updated\n");
-        }
-        if (settings->pulse_width > 0) {
-            update_pulse_width(settings->pulse_width);
-        } else {
-            printf("Warning: Received pulse width is 0 us, pulse width not updated\n");
-        }
-        update_dac1_amplitude(settings->DAC_amplitude);
-        update_dac2_amplitude(settings->DAC_amplitude);
+        apply_settings(settings, 0);
+    } else if ((ble_data_length >= sizeof(cmd_header)) && (ble_received_data[0] == CMD_MAGIC)) {
+        process_command(settings, ble_received_data, ble_data_length);
     } else {
         printf("Received data length mismatch: expected %zu, got %u\n",
                sizeof(stim_setting), ble_data_length);
     }
-}
\ No newline at end of file
+}
@@ -8,9 +8,38 @@ typedef struct{
     uint16_t frequency;         // Hz
 } stim_setting;
 
-#define BLE_DATA_BUFFER_SIZE (sizeof(stim_setting)) 
-extern uint8_t ble_received_data[];
-extern uint16_t ble_data_length;
+// Writes of exactly sizeof(stim_setting) bytes are a stim_setting. Anything
+// else starts with a cmd_header; commands are never sizeof(stim_setting) long,
+// so no opcode takes a 2-byte payload.
+#define CMD_MAGIC 0xC7
+
+typedef struct __attribute__((packed)) {
+    uint8_t magic;              // CMD_MAGIC
+    uint8_t opcode;             // cmd_opcode
+    uint16_t seq;               // host sequence number
+} cmd_header;
+
+typedef enum {
+    CMD_WAVEFORM_BEGIN = 0x10,  // u16 sample_period_us, u16 sample_count
+    CMD_WAVEFORM_DATA = 0x11,   // u16 offset, u16 codes[] (at least one)
+    CMD_WAVEFORM_COMMIT = 0x12, // no payload
+    CMD_CHANNEL_SET = 0x20,     // u8 channel, u16 frequency, u16 pulse_width,
+                                // u16 interphase_us, u16 DAC_amplitude
+    CMD_PROGRAM_BEGIN = 0x30,   // u16 entry_count, u16 reserved (0)
+    CMD_PROGRAM_DATA = 0x31,    // u16 offset, 16-byte entries[] (at least one)
+    CMD_PROGRAM_COMMIT = 0x32,  // no payload
+    CMD_TELEMETRY = 0x40,       // u8 enable
+    CMD_SETTINGS_TIMED = 0x41,  // u32 host_time_us, stim_setting: a settings write
+                                // reported in TELEMETRY_LATENCY records
+    CMD_BURST_SET = 0x50,       // u16 pulses (0: continuous), u16 burst_period_ms,
+                                // u16 train_on_s, u16 train_off_s (0: no off time)
+    CMD_PROFILE_SAVE = 0x60,    // u8 slot, char name[16] (NUL-padded): the current setting
+    CMD_PROFILE_SELECT = 0x61,  // u8 slot: apply the profile as a settings write would
+    CMD_PROFILE_DELETE = 0x62,  // u8 slot
+    CMD_BLACKBOX_READ = 0x70,   // no payload: stream the black box, oldest block first
+} cmd_opcode;
+
+#define BLE_DATA_BUFFER_SIZE 244    // largest NUS write with DLE
 extern stim_setting settings;
 
 void process_received_data(stim_setting *settings, uint8_t *ble_received_data, uint16_t ble_data_length);
@@ -0,0 +1,151 @@
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_gpio.h>
+#include <zephyr/kernel.h>
+#include <stdio.h>
+#include "edge_capture.h"
+#include "stim_hal.h"
+#include "config.h"
+
+#define EDGE_CAPTURE_DEPTH CONFIG_CHRONOS_EDGE_CAPTURE_DEPTH
+BUILD_ASSERT((EDGE_CAPTURE_DEPTH & (EDGE_CAPTURE_DEPTH - 1)) == 0,
+             "CONFIG_CHRONOS_EDGE_CAPTURE_DEPTH must be a power of two");
+
+static const uint32_t capture_pins[EDGE_CAPTURE_LINES] = EDGE_CAPTURE_PINS;
+// CC0 stays with the software captures of MEASURE_TIMER
+static const nrf_timer_cc_channel_t capture_channels[EDGE_CAPTURE_LINES] = {
+    NRF_TIMER_CC_CHANNEL1, NRF_TIMER_CC_CHANNEL2, NRF_TIMER_CC_CHANNEL3,
+};
+
+static const nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(STIM_GPIOTE_INST_IDX);
+static const nrfx_timer_t *capture_timer;
+static uint8_t line_level[EDGE_CAPTURE_LINES];     // GPIOTE ISR only
+
+// ring_head is only written by the GPIOTE ISR and ring_tail only by the
+// reader, like the command queue.
+static edge_record ring[EDGE_CAPTURE_DEPTH];
+static atomic_t ring_head;
+static atomic_t ring_tail;
+static atomic_t dropped;
+
+static void ring_push(uint8_t line, uint32_t ticks, uint8_t level) {
+    atomic_val_t head = atomic_get(&ring_head);
+
+    if ((head - atomic_get(&ring_tail)) >= EDGE_CAPTURE_DEPTH) {
+        atomic_inc(&dropped);
+        return;
+    }
+    edge_record *record = &ring[head & (EDGE_CAPTURE_DEPTH - 1)];
+    record->ticks = ticks;
+    record->line = line;
+    record->level = level;
+    // Publish the record to the reader
+    atomic_set(&ring_head, head + 1);
+}
+
+// GPIOTE IN event of a line. The same event already latched the timer into
+// the line's CC through DPPI, so the timestamp is the edge's own however
+// late this runs; it only has to run before the next edge on the line.
+static void edge_handler(nrfx_gpiote_pin_t pin, nrfx_gpiote_trigger_t trigger, void *context) {
+    uint8_t line = (uint8_t)(uintptr_t)context;
+    uint8_t level = line_level[line] ^ 1;
+
+    ARG_UNUSED(trigger);
+    // Every edge toggles the line, starting from the level seen at setup.
+    // The IN event is a single latch: edges that merged behind a late
+    // interrupt leave the pin off the toggled level. The CC holds the
+    // last of them, so record that one at the pin level and count the
+    // rest as lost.
+    if (nrf_gpio_pin_read(pin) != level) {
+        atomic_inc(&dropped);
+        level ^= 1;
+    }
+    line_level[line] = level;
+    ring_push(line, nrfx_timer_capture_get(capture_timer, capture_channels[line]), level);
+}
+
+static int line_setup(uint8_t line) {
+    uint32_t pin = capture_pins[line];
+    uint8_t gpiote_channel;
+    uint8_t ppi_channel;
+
+    if (nrfx_gpiote_channel_alloc(&gpiote, &gpiote_channel) != NRFX_SUCCESS) {
+        return -ENOMEM;
+    }
+
+    static const nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_NOPULL;
+    nrfx_gpiote_trigger_config_t trigger_config = {
+        .trigger = NRFX_GPIOTE_TRIGGER_TOGGLE,
+        .p_in_channel = &gpiote_channel,
+    };
+    nrfx_gpiote_handler_config_t handler_config = {
+        .handler = edge_handler,
+        .p_context = (void *)(uintptr_t)line,
+    };
+    nrfx_gpiote_input_pin_config_t input_config = {
+        .p_pull_config = &pull,
+        .p_trigger_config = &trigger_config,
+        .p_handler_config = &handler_config,
+    };
+    if (nrfx_gpiote_input_configure(&gpiote, pin, &input_config) != NRFX_SUCCESS) {
+        nrfx_gpiote_channel_free(&gpiote, gpiote_channel);
+        return -EIO;
+    }
+
+    if (nrfx_gppi_channel_alloc(&ppi_channel) != NRFX_SUCCESS) {
+        nrfx_gpiote_pin_uninit(&gpiote, pin);
+        nrfx_gpiote_channel_free(&gpiote, gpiote_channel);
+        return -ENOMEM;
+    }
+    nrfx_gppi_channel_endpoints_setup(ppi_channel,
+        nrfx_gpiote_in_event_address_get(&gpiote, pin),
+        nrfx_timer_capture_task_address_get(capture_timer, capture_channels[line]));
+    nrfx_gppi_channels_enable(BIT(ppi_channel));
+
+    line_level[line] = nrf_gpio_pin_read(pin);
+    // The event captures through DPPI, the interrupt collects the capture
+    nrfx_gpiote_trigger_enable(&gpiote, pin, true);
+    return 0;
+}
+
+int edge_capture_init(const nrfx_timer_t *timer) {
+    capture_timer = timer;
+
+    if (!nrfx_gpiote_init_check(&gpiote)) {
+        if (nrfx_gpiote_init(&gpiote, 0) != NRFX_SUCCESS) {
+            return -EIO;
+        }
+    }
+#if !defined(CONFIG_GPIO_NRFX)
+    // Otherwise the GPIO driver has connected it and dispatches to us
+    IRQ_CONNECT(NRFX_IRQ_NUMBER_GET(NRF_GPIOTE_INST_GET(STIM_GPIOTE_INST_IDX)),
+                CONFIG_CHRONOS_EDGE_CAPTURE_IRQ_PRIO,
+                NRFX_GPIOTE_INST_HANDLER_GET(STIM_GPIOTE_INST_IDX), 0, 0);
+    irq_enable(NRFX_IRQ_NUMBER_GET(NRF_GPIOTE_INST_GET(STIM_GPIOTE_INST_IDX)));
+#endif
+    for (uint8_t line = 0; line < EDGE_CAPTURE_LINES; line++) {
+        int err = line_setup(line);
+        if (err) {
+            printf("Edge capture setup failed on line %u with error: %d\n", line, err);
+            return err;
+        }
+    }
+    return 0;
+}
+
+size_t edge_capture_read(edge_record *records, size_t max) {
+    atomic_val_t tail = atomic_get(&ring_tail);
+    size_t count = 0;
+
+    while ((count < max) && (tail != atomic_get(&ring_head))) {
+        records[count++] = ring[tail & (EDGE_CAPTURE_DEPTH - 1)];
+        tail++;
+    }
+    atomic_set(&ring_tail, tail);
+    return count;
+}
+
+uint32_t edge_capture_dropped(void) {
+    return atomic_get(&dropped);
+}
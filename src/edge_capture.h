@@ -0,0 +1,31 @@
+#ifndef EDGE_CAPTURE_H
+#define EDGE_CAPTURE_H
+
+#include <nrfx_timer.h>
+#include <zephyr/types.h>
+
+// Pin-level edge timestamps. The stimulation outputs are looped back to the
+// EDGE_CAPTURE_PINS inputs; every edge on them fires a GPIOTE IN event that
+// triggers a CAPTURE task of the measurement timer through (D)PPI, so the
+// timestamp is taken by hardware when the pin changes. The same event
+// interrupts, and the GPIOTE ISR moves the capture into a ring for
+// edge_capture_read. Two edges on one line closer than the interrupt latency
+// show up as one, the later; the ISR resyncs the level from the pin and
+// counts the merged edge as dropped.
+#define EDGE_CAPTURE_LINES 3
+
+typedef struct {
+    uint32_t ticks;     // measurement timer count at the edge
+    uint8_t line;       // index into EDGE_CAPTURE_PINS
+    uint8_t level;      // pin level after the edge
+    uint16_t reserved;
+} edge_record;
+
+// Called from measurement_timer_init once the timer is running
+int edge_capture_init(const nrfx_timer_t *timer);
+// Single reader; returns the number of records copied
+size_t edge_capture_read(edge_record *records, size_t max);
+// Edges lost to a full ring or merged behind a late interrupt
+uint32_t edge_capture_dropped(void);
+
+#endif // EDGE_CAPTURE_H
@@ -0,0 +1,125 @@
+#include <zephyr/kernel.h>
+#include <cmsis_core.h>
+#include <stdio.h>
+#include "evlog.h"
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+#include "blackbox.h"
+#endif
+
+#define EVLOG_FORMAT(id, format) [id] = format,
+static const char *const evlog_formats[EVLOG_EVENT_COUNT] = {
+    EVLOG_EVENTS(EVLOG_FORMAT)
+};
+#undef EVLOG_FORMAT
+
+void evlog_init(void) {
+    // Free-running cycle counter for the record timestamps. Already running
+    // since PRE_KERNEL_1 for the boot stages, and not restarted, so both
+    // share one time base.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static void evlog_print(const evlog_record *record) {
+    if (record->id >= EVLOG_EVENT_COUNT) {
+        return;
+    }
+    printf("[%10lu us] ", record->timestamp / (SystemCoreClock / 1000000));
+    printf(evlog_formats[record->id], record->args[0], record->args[1]);
+    printf("\n");
+}
+
+// Faults worth keeping past a reset also go to the black box
+static inline void evlog_persist(evlog_event id, uint32_t arg0, uint32_t arg1) {
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+    if (id == EVLOG_SPI_ERROR) {
+        blackbox_write(BLACKBOX_SPI_ERROR, 0, arg0, arg1);
+    }
+#else
+    ARG_UNUSED(id);
+    ARG_UNUSED(arg0);
+    ARG_UNUSED(arg1);
+#endif
+}
+
+#if defined(CONFIG_CHRONOS_EVLOG)
+#define EVLOG_DEPTH CONFIG_CHRONOS_EVLOG_DEPTH
+BUILD_ASSERT((EVLOG_DEPTH & (EVLOG_DEPTH - 1)) == 0,
+             "CONFIG_CHRONOS_EVLOG_DEPTH must be a power of two");
+
+// ring_head counts reserved slots and is shared by every writer, ring_tail
+// counts consumed ones and is only written by the evlog thread. A record is
+// only read once its seq says it is complete, and its slot is only reused
+// once the reader has moved past it.
+static evlog_record ring[EVLOG_DEPTH];
+static atomic_t ring_head;
+static atomic_t ring_tail;
+static atomic_t dropped;
+
+// Any context, including the timer ISR: no locks, no kernel calls. A full
+// ring drops the new record and counts it.
+void evlog_write(evlog_event id, uint32_t arg0, uint32_t arg1) {
+    atomic_val_t head;
+
+    evlog_persist(id, arg0, arg1);
+    do {
+        head = atomic_get(&ring_head);
+        if ((head - atomic_get(&ring_tail)) >= EVLOG_DEPTH) {
+            atomic_inc(&dropped);
+            return;
+        }
+    } while (!atomic_cas(&ring_head, head, head + 1));
+
+    evlog_record *record = &ring[head & (EVLOG_DEPTH - 1)];
+    record->timestamp = DWT->CYCCNT;
+    record->id = id;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    __DMB();
+    record->seq = (uint32_t)head + 1;
+}
+
+uint32_t evlog_dropped(void) {
+    return atomic_get(&dropped);
+}
+
+static void evlog_thread(void) {
+    uint32_t reported_drops = 0;
+
+    for (;;) {
+        atomic_val_t tail = atomic_get(&ring_tail);
+        const evlog_record *slot = &ring[tail & (EVLOG_DEPTH - 1)];
+
+        if (slot->seq != (uint32_t)tail + 1) {
+            uint32_t drops = atomic_get(&dropped);
+            if (drops != reported_drops) {
+                printf("evlog: %lu records dropped\n", drops - reported_drops);
+                reported_drops = drops;
+            }
+            k_msleep(CONFIG_CHRONOS_EVLOG_POLL_MS);
+            continue;
+        }
+        __DMB();
+        evlog_record record = *slot;
+        atomic_set(&ring_tail, tail + 1);
+        evlog_print(&record);
+    }
+}
+
+K_THREAD_DEFINE(evlog_thread_id, CONFIG_CHRONOS_EVLOG_STACK_SIZE, evlog_thread, NULL, NULL,
+                NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+#else
+void evlog_write(evlog_event id, uint32_t arg0, uint32_t arg1) {
+    evlog_record record = {
+        .timestamp = DWT->CYCCNT,
+        .id = id,
+        .args = {arg0, arg1},
+    };
+    evlog_persist(id, arg0, arg1);
+    evlog_print(&record);
+}
+
+uint32_t evlog_dropped(void) {
+    return 0;
+}
+#endif
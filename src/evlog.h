@@ -0,0 +1,37 @@
+#ifndef EVLOG_H
+#define EVLOG_H
+
+#include <zephyr/types.h>
+
+// Deferred binary log for the stimulation hot path. A call site stores a
+// fixed-size record (event id, two arguments, cycle timestamp) in a
+// lock-free ring; the evlog thread formats it later at the lowest priority.
+// Without CONFIG_CHRONOS_EVLOG the records are printed on the spot.
+#define EVLOG_EVENTS(X) \
+    X(EVLOG_SPI_ERROR,      "SPI ERROR (err 0x%08lX, CS pin %lu)") \
+    X(EVLOG_SPI_DONE,       "Message received: %02lX (len %lu)") \
+    X(EVLOG_FREQUENCY,      "Timer frequency updated to %lu Hz (period: %lu us)") \
+    X(EVLOG_PULSE_WIDTH,    "Pulse width updated to %lu us (ticks: %lu)") \
+    X(EVLOG_DAC1_AMPLITUDE, "DAC1 amplitude updated to %lu (code 0x%04lX)") \
+    X(EVLOG_DAC2_AMPLITUDE, "DAC2 amplitude updated to opposite of %lu (code 0x%04lX)")
+
+#define EVLOG_ENUM(id, format) id,
+typedef enum {
+    EVLOG_EVENTS(EVLOG_ENUM)
+    EVLOG_EVENT_COUNT
+} evlog_event;
+#undef EVLOG_ENUM
+
+typedef struct {
+    uint32_t seq;               // ring position + 1 once the record is complete
+    uint32_t timestamp;         // CPU cycles (DWT CYCCNT)
+    uint16_t id;                // evlog_event
+    uint16_t reserved;
+    uint32_t args[2];
+} evlog_record;
+
+void evlog_init(void);
+void evlog_write(evlog_event id, uint32_t arg0, uint32_t arg1);
+uint32_t evlog_dropped(void);
+
+#endif // EVLOG_H
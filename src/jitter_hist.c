@@ -0,0 +1,68 @@
+#include <zephyr/types.h>
+#include <zephyr/toolchain.h>
+#include <zephyr/sys/atomic.h>
+#include <string.h>
+#include "jitter_hist.h"
+
+BUILD_ASSERT(sizeof(jitter_hist_snapshot) == (6 + JITTER_HIST_BUCKETS) * sizeof(uint32_t),
+             "jitter_hist_snapshot must stay a flat array of 32-bit words");
+
+static uint8_t bucket_of(uint32_t value) {
+    return (value == 0) ? 0 : (uint8_t)(32 - __builtin_clz(value));
+}
+
+static uint32_t bucket_upper(uint8_t bucket) {
+    return (bucket == 0) ? 0 : (uint32_t)((1ULL << bucket) - 1);
+}
+
+// Samples recorded while a reset is in progress may land on either side of
+// it; the timer never has to stop.
+void jitter_hist_reset(jitter_hist *hist) {
+    for (size_t i = 0; i < JITTER_HIST_BUCKETS; i++) {
+        atomic_set(&hist->buckets[i], 0);
+    }
+    atomic_set(&hist->min, (atomic_val_t)UINT32_MAX);
+    atomic_set(&hist->max, 0);
+}
+
+void jitter_hist_record(jitter_hist *hist, uint32_t value) {
+    atomic_val_t seen;
+
+    atomic_inc(&hist->buckets[bucket_of(value)]);
+    do {
+        seen = atomic_get(&hist->min);
+    } while ((value < (uint32_t)seen) && !atomic_cas(&hist->min, seen, value));
+    do {
+        seen = atomic_get(&hist->max);
+    } while ((value > (uint32_t)seen) && !atomic_cas(&hist->max, seen, value));
+}
+
+// Upper bound of the bucket holding the permille-th sample.
+static uint32_t percentile(const jitter_hist_snapshot *snapshot, uint32_t permille) {
+    uint64_t target = ((uint64_t)snapshot->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+
+    for (uint8_t i = 0; i < JITTER_HIST_BUCKETS; i++) {
+        seen += snapshot->buckets[i];
+        if ((seen > 0) && (seen >= target)) {
+            return bucket_upper(i);
+        }
+    }
+    return 0;
+}
+
+void jitter_hist_snapshot_get(const jitter_hist *hist, jitter_hist_snapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    for (size_t i = 0; i < JITTER_HIST_BUCKETS; i++) {
+        snapshot->buckets[i] = atomic_get(&hist->buckets[i]);
+        snapshot->count += snapshot->buckets[i];
+    }
+    if (snapshot->count == 0) {
+        return;
+    }
+    snapshot->min = atomic_get(&hist->min);
+    snapshot->max = atomic_get(&hist->max);
+    snapshot->p50 = percentile(snapshot, 500);
+    snapshot->p99 = percentile(snapshot, 990);
+    snapshot->p999 = percentile(snapshot, 999);
+}
@@ -0,0 +1,35 @@
+#ifndef JITTER_HIST_H
+#define JITTER_HIST_H
+
+#include <zephyr/types.h>
+#include <zephyr/sys/atomic.h>
+
+// Log2-bucketed timing error histogram. Bucket 0 counts exact hits and
+// bucket n counts errors in [2^(n-1), 2^n) ticks. Recording is one atomic
+// increment plus lock-free min/max updates, so the timer ISR can feed it
+// while any thread reads or resets it.
+#define JITTER_HIST_BUCKETS 33
+
+typedef struct {
+    atomic_t buckets[JITTER_HIST_BUCKETS];
+    atomic_t min;
+    atomic_t max;
+} jitter_hist;
+
+// Compact binary snapshot, 32-bit fields only so there is no padding.
+// Percentiles are bucket upper bounds in ticks.
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t p999;
+    uint32_t buckets[JITTER_HIST_BUCKETS];
+} jitter_hist_snapshot;
+
+void jitter_hist_reset(jitter_hist *hist);
+void jitter_hist_record(jitter_hist *hist, uint32_t value);
+void jitter_hist_snapshot_get(const jitter_hist *hist, jitter_hist_snapshot *snapshot);
+
+#endif // JITTER_HIST_H
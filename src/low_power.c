@@ -0,0 +1,126 @@
+#include <nrfx_timer.h>
+#include <hal/nrf_rtc.h>
+#include <hal/nrf_clock.h>
+#include <helpers/nrfx_gppi.h>
+#include <zephyr/kernel.h>
+#include <stdio.h>
+#include "low_power.h"
+#include "lp_plan.h"
+#include "timer.h"
+#include "config.h"
+
+// The period measurement runs on TIMER1, which would keep HFCLK on
+BUILD_ASSERT(MEASURE_TIMER == 0, "MEASURE_TIMER does not support the low-power train");
+
+// RTC1 is the kernel clock; RTC0 is free on the application core
+#define LOW_POWER_RTC NRF_RTC0
+#define LOW_POWER_RTC_HZ 32768      // prescaler 0
+
+static const nrfx_timer_t stim_timer = NRFX_TIMER_INSTANCE(TIMER_INST_IDX);
+static const lp_model model = {
+    .hfclk_ua = CONFIG_CHRONOS_LOW_POWER_HFCLK_UA,
+    .wake_pc = CONFIG_CHRONOS_LOW_POWER_WAKE_PC,
+    .max_hz = CONFIG_CHRONOS_LOW_POWER_MAX_HZ,
+};
+static uint8_t wake_channel;        // RTC COMPARE0 -> TIMER0 START, HFCLKSTART
+static uint8_t sleep_channel;       // TIMER0 COMPARE5 -> HFCLKSTOP
+static uint8_t sync_channel;        // TIMER0 COMPARE0 -> RTC CLEAR
+static bool lp_ready;
+static bool rtc_running;            // timer ISR only
+
+static atomic_t low_power;
+static atomic_t pulse_pc;
+static atomic_t break_even_us;
+static atomic_t average_na;
+static atomic_t switches;
+
+// EVENT0 has already cleared the RTC through sync_channel when the RTC was
+// running, so only the first low-power period is late, by the timer
+// interrupt latency. Register writes only, safe from the zero-latency ISR.
+void low_power_apply(NRF_TIMER_Type *timer, uint32_t stop_ticks, uint32_t rtc_ticks) {
+    if (rtc_ticks > 0) {
+        nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL5, stop_ticks);
+        nrf_timer_shorts_enable(timer, NRF_TIMER_SHORT_COMPARE5_STOP_MASK);
+        nrf_rtc_cc_set(LOW_POWER_RTC, 0, rtc_ticks);
+        if (!rtc_running) {
+            nrf_rtc_task_trigger(LOW_POWER_RTC, NRF_RTC_TASK_CLEAR);
+            nrf_rtc_task_trigger(LOW_POWER_RTC, NRF_RTC_TASK_START);
+            rtc_running = true;
+        }
+        return;
+    }
+    // Continuous: TIMER0 never reaches CC5 before CC0 clears it
+    nrf_timer_shorts_disable(timer, NRF_TIMER_SHORT_COMPARE5_STOP_MASK);
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL5, UINT32_MAX);
+    if (rtc_running) {
+        nrf_rtc_task_trigger(LOW_POWER_RTC, NRF_RTC_TASK_STOP);
+        rtc_running = false;
+    }
+    nrf_clock_task_trigger(NRF_CLOCK, NRF_CLOCK_TASK_HFCLKSTART);
+}
+
+void low_power_stage(void) {
+    uint32_t period_us = get_stim_period_us();
+    lp_plan plan = {0};
+
+    if (lp_ready) {
+        int err = lp_plan_compute(&model, period_us, stim_params_last_edge_ticks(),
+                                  nrfx_timer_us_to_ticks(&stim_timer, 1), LOW_POWER_RTC_HZ,
+                                  CONFIG_CHRONOS_LOW_POWER_LEAD_US, &plan);
+        if (err) {
+            printf("Low-power plan failed with error: %d, continuous train\n", err);
+            plan.rtc_ticks = 0;
+        }
+    }
+    stim_params_set_low_power(plan.frame_ticks, plan.stop_ticks, plan.rtc_ticks);
+
+    bool now_low_power = (plan.rtc_ticks > 0);
+    if (now_low_power != (bool)atomic_get(&low_power)) {
+        atomic_inc(&switches);
+    }
+    atomic_set(&low_power, now_low_power);
+    atomic_set(&pulse_pc, plan.pulse_pc);
+    atomic_set(&break_even_us, plan.break_even_us);
+    atomic_set(&average_na, lp_plan_average_na(&model, &plan, period_us));
+}
+
+int low_power_init(void) {
+    NRF_TIMER_Type *timer = stim_timer.p_reg;
+
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL5, UINT32_MAX);
+    nrf_rtc_prescaler_set(LOW_POWER_RTC, 0);
+    nrf_rtc_event_enable(LOW_POWER_RTC, NRF_RTC_INT_COMPARE0_MASK);
+
+    if ((nrfx_gppi_channel_alloc(&wake_channel) != NRFX_SUCCESS) ||
+        (nrfx_gppi_channel_alloc(&sleep_channel) != NRFX_SUCCESS) ||
+        (nrfx_gppi_channel_alloc(&sync_channel) != NRFX_SUCCESS)) {
+        printf("Low power: no free (D)PPI channel\n");
+        return -ENOMEM;
+    }
+    nrfx_gppi_channel_endpoints_setup(wake_channel,
+        nrf_rtc_event_address_get(LOW_POWER_RTC, NRF_RTC_EVENT_COMPARE_0),
+        nrfx_timer_task_address_get(&stim_timer, NRF_TIMER_TASK_START));
+    nrfx_gppi_fork_endpoint_setup(wake_channel,
+        nrf_clock_task_address_get(NRF_CLOCK, NRF_CLOCK_TASK_HFCLKSTART));
+    nrfx_gppi_channel_endpoints_setup(sleep_channel,
+        nrfx_timer_compare_event_address_get(&stim_timer, NRF_TIMER_CC_CHANNEL5),
+        nrf_clock_task_address_get(NRF_CLOCK, NRF_CLOCK_TASK_HFCLKSTOP));
+    nrfx_gppi_channel_endpoints_setup(sync_channel,
+        nrfx_timer_compare_event_address_get(&stim_timer, NRF_TIMER_CC_CHANNEL0),
+        nrf_rtc_task_address_get(LOW_POWER_RTC, NRF_RTC_TASK_CLEAR));
+    nrfx_gppi_channels_enable(BIT(wake_channel) | BIT(sleep_channel) | BIT(sync_channel));
+    lp_ready = true;
+
+    // The boot setting was staged before the channels existed
+    low_power_stage();
+    stim_params_commit();
+    return 0;
+}
+
+void get_low_power_stats(low_power_stats *stats) {
+    stats->low_power = atomic_get(&low_power);
+    stats->pulse_pc = atomic_get(&pulse_pc);
+    stats->break_even_us = atomic_get(&break_even_us);
+    stats->average_na = atomic_get(&average_na);
+    stats->switches = atomic_get(&switches);
+}
@@ -0,0 +1,28 @@
+#ifndef LOW_POWER_H
+#define LOW_POWER_H
+
+#include <zephyr/types.h>
+#include <nrfx_timer.h>
+
+// Low-power pulse train: RTC0 times the inter-pulse period with HFCLK off,
+// TIMER0 only runs from LEAD_US ahead of a pulse to its last edge. See
+// lp_plan.h for the schedule. The mode is picked per setting in
+// low_power_stage and switched by the timer ISR at the start of a period.
+typedef struct {
+    bool low_power;             // mode of the last staged setting
+    uint32_t pulse_pc;          // charge of one low-power pulse over idle
+    uint32_t break_even_us;     // shortest period where low-power mode pays
+    uint32_t average_na;        // estimated current over idle, either mode
+    uint32_t switches;          // mode changes staged since boot
+} low_power_stats;
+
+// After timer_init: wires RTC0, TIMER0 and the clock through DPPI, then
+// stages and commits the current setting
+int low_power_init(void);
+// Picks the mode for the staged setting; call before stim_params_commit
+void low_power_stage(void);
+// Timer ISR at EVENT0, with the parameters that were just applied
+void low_power_apply(NRF_TIMER_Type *timer, uint32_t stop_ticks, uint32_t rtc_ticks);
+void get_low_power_stats(low_power_stats *stats);
+
+#endif // LOW_POWER_H
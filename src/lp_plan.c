@@ -0,0 +1,58 @@
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include "lp_plan.h"
+
+#define RTC_MAX_TICKS 0xFFFFFF  // 24-bit counter
+#define RTC_MARGIN_TICKS 2      // compare writes and the clear on the 32 kHz side
+
+int lp_plan_compute(const lp_model *model, uint32_t period_us, uint32_t last_edge_ticks,
+                    uint32_t ticks_per_us, uint32_t rtc_hz, uint32_t lead_us, lp_plan *plan) {
+    if ((ticks_per_us == 0) || (rtc_hz == 0) || (period_us == 0)) {
+        return -EINVAL;
+    }
+    uint64_t stop_ticks = (uint64_t)last_edge_ticks + (uint64_t)LP_GUARD_US * ticks_per_us;
+    uint64_t frame_ticks = stop_ticks + (uint64_t)lead_us * ticks_per_us;
+    if (frame_ticks > UINT32_MAX) {
+        return -ERANGE;
+    }
+    uint64_t on_us = DIV_ROUND_UP(frame_ticks, ticks_per_us);
+    uint64_t pulse_pc = (uint64_t)model->hfclk_ua * on_us + model->wake_pc;
+
+    plan->rtc_ticks = 0;
+    plan->frame_ticks = frame_ticks;
+    plan->stop_ticks = stop_ticks;
+    plan->pulse_pc = MIN(pulse_pc, UINT32_MAX);
+    plan->break_even_us = (model->hfclk_ua > 0) ?
+                          MIN(DIV_ROUND_UP(pulse_pc, model->hfclk_ua), UINT32_MAX) : UINT32_MAX;
+
+    // HFCLK off saves hfclk_ua for the rest of the period, one wake-up costs
+    // pulse_pc: only worth it where the saving is larger
+    if ((model->hfclk_ua == 0) || (pulse_pc >= (uint64_t)model->hfclk_ua * period_us)) {
+        return 0;
+    }
+    if ((model->max_hz > 0) && ((uint64_t)period_us * model->max_hz < 1000000)) {
+        return 0;
+    }
+    if (period_us <= lead_us) {
+        return 0;
+    }
+    // Nearest whole RTC tick; the compare must come after the timer stopped
+    // or the start would be lost on a running timer
+    uint64_t rtc_ticks = ((uint64_t)(period_us - lead_us) * rtc_hz + 500000) / 1000000;
+    uint64_t stop_rtc_ticks = DIV_ROUND_UP(DIV_ROUND_UP(stop_ticks, ticks_per_us) * rtc_hz,
+                                           1000000);
+    if ((rtc_ticks < stop_rtc_ticks + RTC_MARGIN_TICKS) || (rtc_ticks > RTC_MAX_TICKS)) {
+        return 0;
+    }
+    plan->rtc_ticks = rtc_ticks;
+    return 0;
+}
+
+uint32_t lp_plan_average_na(const lp_model *model, const lp_plan *plan, uint32_t period_us) {
+    if ((plan->rtc_ticks == 0) || (period_us == 0)) {
+        return model->hfclk_ua * 1000;
+    }
+    // pC per pulse x pulses per second = pA
+    return (uint64_t)plan->pulse_pc * 1000 / period_us;
+}
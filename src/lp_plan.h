@@ -0,0 +1,37 @@
+#ifndef LP_PLAN_H
+#define LP_PLAN_H
+
+#include <zephyr/types.h>
+
+// Low-power scheduling of a pulse train. Between pulses HFCLK is off and
+// only the 32 kHz RTC runs. The RTC, cleared at every pulse start, restarts
+// HFCLK and the stimulation timer lead_ticks ahead of the next pulse; the
+// timer runs through the pulse edges and stops itself at stop_ticks, which
+// stops HFCLK again. The pulse phases keep the fast timer's resolution, the
+// period is rtc_ticks plus the lead.
+#define LP_GUARD_US 20          // last edge to the timer stop
+
+// Board figures for the mode decision, measured with a power profiler
+typedef struct {
+    uint32_t hfclk_ua;          // HFCLK and the timer running, over idle
+    uint32_t wake_pc;           // one HFCLK start and the wake-up around it
+    uint32_t max_hz;            // highest low-power rate, 0: where it breaks even
+} lp_model;
+
+typedef struct {
+    uint32_t rtc_ticks;         // RTC compare after a pulse start, 0: continuous
+    uint32_t frame_ticks;       // timer period in low-power mode: lead to EVENT0
+    uint32_t stop_ticks;        // timer stop after EVENT0
+    uint32_t pulse_pc;          // charge of one low-power pulse over idle
+    uint32_t break_even_us;     // shortest period at which low-power draws less
+} lp_plan;
+
+// last_edge_ticks is EVENT3 of the committed setting in timer ticks.
+// Fills plan with the continuous mode (rtc_ticks 0) when low-power mode
+// draws more or cannot keep the period.
+int lp_plan_compute(const lp_model *model, uint32_t period_us, uint32_t last_edge_ticks,
+                    uint32_t ticks_per_us, uint32_t rtc_hz, uint32_t lead_us, lp_plan *plan);
+// Average current over idle in nA, for either mode
+uint32_t lp_plan_average_na(const lp_model *model, const lp_plan *plan, uint32_t period_us);
+
+#endif // LP_PLAN_H
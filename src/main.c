@@ -42,9 +42,39 @@
 #include "spi.h"
 #include "timer.h"
 #include "config.h"
+#include "cmd_queue.h"
+#include "evlog.h"
+#include "boot_stages.h"
+#if defined(CONFIG_CHRONOS_EDGE_CAPTURE)
+#include "edge_capture.h"
+#endif
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+#include "telemetry.h"
+#endif
+#if defined(CONFIG_CHRONOS_CHARGE_MONITOR)
+#include "charge_monitor.h"
+#endif
+#if defined(CONFIG_CHRONOS_BURST)
+#include "burst_gate.h"
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+#include "stim_profile.h"
+#include "data.h"
+#endif
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+#include "low_power.h"
+#endif
+#if defined(CONFIG_CHRONOS_PPR)
+#include "ppr_link.h"
+#endif
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+#include "blackbox.h"
+#endif
 
 LOG_MODULE_REGISTER(mymain, LOG_LEVEL_DBG);
+#if !defined(CONFIG_CHRONOS_PPR)
 static void init_clock();
+#endif
 BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.connected        = connected,
 	.disconnected     = disconnected,
@@ -58,6 +88,195 @@ static struct bt_nus_cb nus_cb = {
 	.received = bt_receive_cb,
 };
 
+#if defined(CONFIG_CHRONOS_EDGE_CAPTURE)
+// Scope-style list of the captured edges with the time since the previous
+// edge on the same line
+static void print_edges(void) {
+    static uint32_t last_ticks[EDGE_CAPTURE_LINES];
+    edge_record records[16];
+    size_t count;
+
+    while ((count = edge_capture_read(records, ARRAY_SIZE(records))) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const edge_record *edge = &records[i];
+            printf("Edge line %u %s at %lu ticks (+%lu)\n", edge->line,
+                   edge->level ? "rise" : "fall", edge->ticks,
+                   edge->ticks - last_ticks[edge->line]);
+            last_ticks[edge->line] = edge->ticks;
+        }
+    }
+    if (edge_capture_dropped() > 0) {
+        printf("Edge capture: %lu edges dropped\n", edge_capture_dropped());
+    }
+}
+#endif
+
+// Only when something changed, to size CONFIG_CHRONOS_UART_SLAB_COUNT
+static void print_uart_pool(void) {
+    static struct uart_pool_stats last;
+    struct uart_pool_stats stats;
+
+    get_uart_pool_stats(&stats);
+    if ((stats.high_water != last.high_water) || (stats.alloc_failures != last.alloc_failures) ||
+        (stats.send_failures != last.send_failures)) {
+        printf("UART pool: %lu/%d in use, high water %lu, alloc failures %lu, send failures %lu\n",
+               stats.used, CONFIG_CHRONOS_UART_SLAB_COUNT, stats.high_water,
+               stats.alloc_failures, stats.send_failures);
+        last = stats;
+    }
+}
+
+#if defined(CONFIG_CHRONOS_CHARGE_MONITOR)
+// Only when an alert or overrun was added since the last call
+static void print_charge(void) {
+    static charge_stats last;
+    charge_stats stats;
+
+    get_charge_stats(&stats);
+    if ((stats.residual_alerts != last.residual_alerts) ||
+        (stats.compliance_alerts != last.compliance_alerts) || (stats.overruns != last.overruns)) {
+        printf("Charge: %lu pulses, residual alerts %lu, compliance alerts %lu, overruns %lu\n",
+               stats.pulses, stats.residual_alerts, stats.compliance_alerts, stats.overruns);
+        printf("Charge last pulse: cathodic %ld anodic %ld residual %ld (LSB x samples)\n",
+               stats.last.charge[CHARGE_PHASE_CATHODIC], stats.last.charge[CHARGE_PHASE_ANODIC],
+               stats.last.residual);
+        last = stats;
+    }
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_BURST)
+static void print_bursts(void) {
+    static burst_stats last;
+    burst_stats stats;
+
+    get_burst_stats(&stats);
+    if (stats.bursts != last.bursts) {
+        printf("Burst: %lu bursts, last %lu pulses, %lu with a wrong pulse count\n",
+               stats.bursts, stats.last_pulses, stats.short_bursts);
+        last = stats;
+    }
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+static void print_profiles(void) {
+    static profile_stats last;
+    profile_stats stats;
+
+    get_profile_stats(&stats);
+    if ((stats.writes != last.writes) || (stats.failures != last.failures)) {
+        printf("Profile: %lu updates, %lu flash writes, %lu failed\n",
+               stats.updates, stats.writes, stats.failures);
+        last = stats;
+    }
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+// Whenever a setting switched the mode
+static void print_low_power(void) {
+    static uint32_t last_switches;
+    low_power_stats stats;
+
+    get_low_power_stats(&stats);
+    if (stats.switches != last_switches) {
+        printf("Low power: %s train, %lu pC per pulse, break-even %lu us, ~%lu nA over idle\n",
+               stats.low_power ? "RTC-scheduled" : "continuous", stats.pulse_pc,
+               stats.break_even_us, stats.average_na);
+        last_switches = stats.switches;
+    }
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_PPR)
+// Whenever the PPR reported a loop, refused a program or lost an event
+static void print_ppr(void) {
+    static uint32_t last_pulses, last_rejected, last_dropped;
+    ppr_stats stats;
+
+    get_ppr_stats(&stats);
+    if ((stats.pulses != last_pulses) || (stats.rejected != last_rejected) ||
+        (stats.dropped != last_dropped)) {
+        printf("PPR: %lu pulses, worst lateness %lu ticks, %lu programs, %lu rejected, %lu events dropped\n",
+               stats.pulses, stats.late_max_ticks, stats.commits, stats.rejected, stats.dropped);
+        last_pulses = stats.pulses;
+        last_rejected = stats.rejected;
+        last_dropped = stats.dropped;
+    }
+}
+#endif
+
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+static void print_blackbox(void) {
+    static uint32_t last_dropped, last_failures, last_readouts;
+    blackbox_stats stats;
+
+    get_blackbox_stats(&stats);
+    if ((stats.dropped != last_dropped) || (stats.failures != last_failures) ||
+        (stats.readouts != last_readouts)) {
+        printf("Black box: %lu records in %lu blocks, %lu dropped, %lu flash failures, %lu readouts\n",
+               stats.records, stats.blocks, stats.dropped, stats.failures, stats.readouts);
+        last_dropped = stats.dropped;
+        last_failures = stats.failures;
+        last_readouts = stats.readouts;
+    }
+}
+#endif
+
+// UART line control can wait for DTR indefinitely, so the UART bridge comes
+// up on a queue of its own instead of holding up BLE or the main loop
+static K_THREAD_STACK_DEFINE(boot_wq_stack, CONFIG_CHRONOS_BOOT_WQ_STACK_SIZE);
+static struct k_work_q boot_wq;
+static struct k_work uart_init_work;
+
+static void uart_init_handler(struct k_work *work) {
+    ARG_UNUSED(work);
+    int err = uart_init();
+
+    if (err) {
+        error();
+    }
+    boot_stage_mark(BOOT_UART);
+}
+
+// bt_enable completion, on the system work queue
+static void bt_ready(int err) {
+    if (err) {
+        LOG_ERR("Bluetooth init failed (err: %d)", err);
+        return;
+    }
+    boot_stage_mark(BOOT_BT_ENABLED);
+	LOG_INF("Bluetooth initialized");
+
+	k_sem_give(&ble_init_ok);
+
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		settings_load();
+	}
+    boot_stage_mark(BOOT_SETTINGS);
+
+	cmd_queue_init();
+	err = bt_nus_init(&nus_cb);
+	if (err) {
+		LOG_ERR("Failed to initialize UART service (err: %d)", err);
+		return;
+	}
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+	telemetry_init();
+#endif
+
+	k_work_init(&adv_work, adv_work_handler);
+	advertising_start();
+}
+
+#if defined(CONFIG_CHRONOS_STIM_IRQ_HIGH)
+#define STIM_TIMER_IRQ_PRIO 0
+#else
+#define STIM_TIMER_IRQ_PRIO IRQ_PRIO_LOWEST
+#endif
+
+#if !defined(CONFIG_CHRONOS_PPR)
 static void init_misc_pins(void) {
     // Configure P0.16 as output (DAC1 CS)
     nrf_gpio_cfg_output(NRF_GPIO_PIN_MAP(0, 16));
@@ -76,31 +295,73 @@ static void init_misc_pins(void) {
     nrf_gpio_cfg_output(NRF_GPIO_PIN_MAP(1, 1));
     nrf_gpio_pin_clear(NRF_GPIO_PIN_MAP(1, 1)); // set low
 }
+#endif
 
 int main(void)
 {
-    #if defined(__ZEPHYR__)
-        IRQ_CONNECT(NRFX_IRQ_NUMBER_GET(NRF_TIMER_INST_GET(TIMER_INST_IDX)), IRQ_PRIO_LOWEST,
+    #if defined(__ZEPHYR__) && !defined(CONFIG_CHRONOS_PPR)
+    #if defined(CONFIG_CHRONOS_STIM_IRQ_ZLI)
+        IRQ_DIRECT_CONNECT(NRFX_IRQ_NUMBER_GET(NRF_TIMER_INST_GET(TIMER_INST_IDX)), 0,
+                           timer_zli_isr, IRQ_ZERO_LATENCY);
+    #else
+        IRQ_CONNECT(NRFX_IRQ_NUMBER_GET(NRF_TIMER_INST_GET(TIMER_INST_IDX)), STIM_TIMER_IRQ_PRIO,
                     NRFX_TIMER_INST_HANDLER_GET(TIMER_INST_IDX), 0, 0);
+    #endif
+        // Transfer completion only, below anything timing related
         IRQ_CONNECT(NRFX_IRQ_NUMBER_GET(NRF_SPIM_INST_GET(SPIM_INST_IDX)), IRQ_PRIO_LOWEST,
                     NRFX_SPIM_INST_HANDLER_GET(SPIM_INST_IDX), 0, 0);
     #endif
 
+    boot_stage_mark(BOOT_MAIN);
+#if !defined(CONFIG_CHRONOS_PPR)
     init_clock();
+#endif
+    boot_stage_mark(BOOT_CLOCK);
+    evlog_init();
+#if !defined(CONFIG_CHRONOS_PPR)
     init_misc_pins();
     spi_init();
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+    // Before timer_init, which starts from it, and long before BLE is up
+    const stim_setting *boot = stim_profile_load();
+    if (boot) {
+        settings = *boot;
+        printf("Resuming %u Hz, %u us, DAC 0x%04X from flash\n",
+               boot->frequency, boot->pulse_width, boot->DAC_amplitude);
+    }
+    boot_stage_mark(BOOT_PROFILE);
+#endif
+#if defined(CONFIG_CHRONOS_PPR)
+    // The PPR owns the pins, TIMER130 and the DAC bus
+    ppr_link_init();
+#else
     timer_init();
     measurement_timer_init();
+#endif
+#if defined(CONFIG_CHRONOS_CHARGE_MONITOR)
+    charge_monitor_init();
+#endif
+#if defined(CONFIG_CHRONOS_BURST)
+    burst_gate_init();
+#endif
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+    low_power_init();
+#endif
+    boot_stage_mark(BOOT_STIM_READY);
+
 	int blink_status = 0;
 	int err = 0;
     uint32_t experiment_counter = 0;
+    bool boot_printed = false;
     
 	configure_gpio();
 
-	err = uart_init();
-	if (err) {
-		error();
-	}
+	// Everything below comes up while the train is already running
+	k_work_queue_start(&boot_wq, boot_wq_stack, K_THREAD_STACK_SIZEOF(boot_wq_stack),
+			   K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+	k_work_init(&uart_init_work, uart_init_handler);
+	k_work_submit_to_queue(&boot_wq, &uart_init_work);
 
 	if (IS_ENABLED(CONFIG_BT_NUS_SECURITY_ENABLED)) {
 		err = bt_conn_auth_cb_register(&conn_auth_callbacks);
@@ -116,54 +377,60 @@ int main(void)
 		}
 	}
 
-	err = bt_enable(NULL);
+	// Returns right away; bt_ready finishes the BLE side
+	err = bt_enable(bt_ready);
 	if (err) {
-		error();
+		LOG_ERR("Bluetooth init failed (err: %d)", err);
 	}
 
-	LOG_INF("Bluetooth initialized");
-
-	k_sem_give(&ble_init_ok);
-
-	if (IS_ENABLED(CONFIG_SETTINGS)) {
-		settings_load();
-	}
-
-	err = bt_nus_init(&nus_cb);
-	if (err) {
-		LOG_ERR("Failed to initialize UART service (err: %d)", err);
-		return 0;
-	}
-
-	k_work_init(&adv_work, adv_work_handler);
-	advertising_start();
-
 	for (;;) {
 		dk_set_led(RUN_STATUS_LED, (++blink_status) % 2);
 		//k_sleep(K_MSEC(RUN_LED_BLINK_INTERVAL));
         k_msleep(10000);
+        if (!boot_printed && boot_stages_done()) {
+            boot_stages_print();
+            boot_printed = true;
+        }
         if(MEASURE_TIMER ==1){
             experiment_counter += 10;
-            error_data my_error_data;
-            get_error_data(&my_error_data);
-            printf("Counter: %i Elapsed: %is\nEvent0 running error: %lu avg error: %lu max error: %lu\nEvents1-3 running error: %lu avg error: %lu max error: %lu, %lu, %lu\n", 
-                my_error_data.mycounter, 
-                experiment_counter,
-                my_error_data.event0_error,
-                (my_error_data.event0_error/my_error_data.mycounter), 
-                my_error_data.event0_max,
-                my_error_data.myerror,
-                (my_error_data.myerror/my_error_data.mycounter),
-                my_error_data.event1_max,
-                my_error_data.event2_max,
-                my_error_data.event3_max);
+            jitter_snapshot jitter;
+            get_jitter_snapshot(&jitter);
+            printf("Counter: %lu Elapsed: %is\n", jitter.interrupts, experiment_counter);
+            for (int i = 0; i < JITTER_EVENT_COUNT; i++) {
+                const jitter_hist_snapshot *event = &jitter.events[i];
+                printf("Event%i error (ticks) n: %lu min: %lu p50: %lu p99: %lu p99.9: %lu max: %lu\n",
+                    i, event->count, event->min, event->p50, event->p99, event->p999, event->max);
+            }
         }
+#if defined(CONFIG_CHRONOS_EDGE_CAPTURE)
+        print_edges();
+#endif
+        print_uart_pool();
+#if defined(CONFIG_CHRONOS_CHARGE_MONITOR)
+        print_charge();
+#endif
+#if defined(CONFIG_CHRONOS_BURST)
+        print_bursts();
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+        print_profiles();
+#endif
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+        print_low_power();
+#endif
+#if defined(CONFIG_CHRONOS_PPR)
+        print_ppr();
+#endif
+#if defined(CONFIG_CHRONOS_BLACKBOX)
+        print_blackbox();
+#endif
 	}
 }
 
 K_THREAD_DEFINE(ble_write_thread_id, STACKSIZE, ble_write_thread, NULL, NULL,
 		NULL, PRIORITY, 0, 0);
 
+#if !defined(CONFIG_CHRONOS_PPR)
 static void init_clock() {
 	// select the clock source: HFINT (high frequency internal oscillator) or HFXO (external 32 MHz crystal)
 	NRF_CLOCK_S->HFCLKSRC = (CLOCK_HFCLKSRC_SRC_HFINT << CLOCK_HFCLKSRC_SRC_Pos);
@@ -173,3 +440,4 @@ static void init_clock() {
     while (NRF_CLOCK_S->EVENTS_HFCLKSTARTED == 0);
     NRF_CLOCK_S->EVENTS_HFCLKSTARTED = 0;
 }
+#endif
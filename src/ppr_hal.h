@@ -0,0 +1,18 @@
+#ifndef PPR_HAL_H
+#define PPR_HAL_H
+
+#include <zephyr/types.h>
+
+// What the PPR sequencer needs from the hardware. ppr/src/ppr_hal_nrfx.c
+// implements it on the PPR; tests link a fake with a virtual clock.
+
+// Timer, pins and the DAC bus, before the sequencer starts
+void ppr_hal_init(void);
+// Free-running timer at PPR_TICKS_PER_US
+uint32_t ppr_hal_now(void);
+// port and masks as in stim_program_entry
+void ppr_hal_pins(uint8_t port, uint32_t set_mask, uint32_t clr_mask);
+// Blocking write of one code, chip select included; dac is stim_program_dac
+void ppr_hal_dac_write(uint8_t dac, uint16_t code);
+
+#endif // PPR_HAL_H
@@ -0,0 +1,149 @@
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/cache.h>
+#include <zephyr/devicetree.h>
+#include <stdio.h>
+#include "ppr_link.h"
+#include "ppr_ring.h"
+#include "stim_program.h"
+#include "boot_stages.h"
+#include "timer.h"
+#include "spi.h"
+#include "config.h"
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+#include "stim_profile.h"
+#endif
+
+// TIMER0 and TIMER1 do not run on this core in PPR mode
+BUILD_ASSERT(MEASURE_TIMER == 0, "MEASURE_TIMER does not support the PPR sequencer");
+
+// Region shared with the PPR image, see ppr.overlay
+#define PPR_SHM_NODE DT_CHOSEN(chronos_ppr_shm)
+BUILD_ASSERT(DT_REG_SIZE(PPR_SHM_NODE) >= sizeof(ppr_shm), "chronos,ppr-shm is too small");
+static ppr_shm *const shm = (ppr_shm *)DT_REG_ADDR(PPR_SHM_NODE);
+
+// The command ring has a single producer; settings arrive from the command
+// work queue and, once, from main
+static K_MUTEX_DEFINE(cmd_lock);
+static stim_program program;        // under cmd_lock
+static uint32_t cmd_seq;            // under cmd_lock
+
+static atomic_t pulses;
+static atomic_t late_max_ticks;
+static atomic_t commits;
+static atomic_t rejected;
+
+static void poll_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(poll_work, poll_handler);
+
+// Before the VPR launcher starts the PPR, so a magic left in RAM by the
+// previous run is never taken for this one
+static int ppr_shm_reset(void) {
+    shm->magic = 0;
+    sys_cache_data_flush_range((void *)shm, PPR_SHM_LINE);
+    return 0;
+}
+
+SYS_INIT(ppr_shm_reset, PRE_KERNEL_1, 0);
+
+static void poll_handler(struct k_work *work) {
+    ARG_UNUSED(work);
+    ppr_msg msg;
+
+    while (ppr_ring_get(&shm->evt, &msg)) {
+        switch (msg.type) {
+            case PPR_MSG_LOOP:
+                if (atomic_set(&pulses, msg.seq) == 0) {
+                    boot_stage_mark(BOOT_FIRST_PULSE);
+                }
+                if (msg.value[0] > (uint32_t)atomic_get(&late_max_ticks)) {
+                    atomic_set(&late_max_ticks, msg.value[0]);
+                }
+                break;
+            case PPR_MSG_ACK:
+                if (msg.status) {
+                    atomic_inc(&rejected);
+                    printf("PPR rejected program %lu with error: %d\n", msg.seq, msg.status);
+                } else {
+                    atomic_inc(&commits);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    k_work_schedule(&poll_work, K_MSEC(CONFIG_CHRONOS_PPR_POLL_MS));
+}
+
+static int load_program(uint32_t period_us, uint32_t pulse_width_us,
+                        uint16_t dac1_code, uint16_t dac2_code) {
+    k_mutex_lock(&cmd_lock, K_FOREVER);
+    int err = stim_program_build_biphasic(&program, period_us * PPR_TICKS_PER_US,
+                                          pulse_width_us * PPR_TICKS_PER_US,
+                                          SWITCH_PERIOD * PPR_TICKS_PER_US, dac1_code, dac2_code,
+                                          PPR_PHASE_PIN, PPR_SWITCH0_PIN, PPR_SWITCH1_PIN);
+    if (!err) {
+        err = ppr_ring_put_program(&shm->cmd, &program, cmd_seq + 1);
+    }
+    if (!err) {
+        cmd_seq++;
+    }
+    k_mutex_unlock(&cmd_lock);
+    return err;
+}
+
+int ppr_link_load_setting(uint16_t frequency_hz, uint16_t pulse_width_us, uint16_t amplitude) {
+    if ((frequency_hz == 0) || (pulse_width_us == 0)) {
+        return -EINVAL;
+    }
+    return load_program(1000000 / frequency_hz, pulse_width_us, amplitude,
+                        dac_opposite_code(amplitude));
+}
+
+int ppr_link_init(void) {
+    int64_t deadline = k_uptime_get() + CONFIG_CHRONOS_PPR_BOOT_TIMEOUT_MS;
+    int err;
+
+    for (;;) {
+        sys_cache_data_invd_range((void *)shm, PPR_SHM_LINE);
+        if (shm->magic == PPR_SHM_MAGIC) {
+            break;
+        }
+        if (k_uptime_get() > deadline) {
+            printf("PPR sequencer did not start\n");
+            return -ETIMEDOUT;
+        }
+        k_msleep(1);
+    }
+    if (shm->version != PPR_SHM_VERSION) {
+        printf("PPR sequencer speaks version %lu, expected %d\n", shm->version, PPR_SHM_VERSION);
+        return -EPROTO;
+    }
+    k_work_schedule(&poll_work, K_NO_WAIT);
+
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+    const stim_setting *boot = stim_profile_boot();
+    if (boot) {
+        err = ppr_link_load_setting(boot->frequency, boot->pulse_width, boot->DAC_amplitude);
+        if (err) {
+            printf("Boot profile rejected with error: %d\n", err);
+        } else {
+            return 0;
+        }
+    }
+#endif
+    // The default timing at mid-scale, which drives no current
+    err = load_program(DEFAULT_STIM_PERIOD, DEFAULT_PULSE_WIDTH, 0x8000, dac_opposite_code(0x8000));
+    if (err) {
+        printf("Default stimulation program failed with error: %d\n", err);
+    }
+    return err;
+}
+
+void get_ppr_stats(ppr_stats *stats) {
+    stats->pulses = atomic_get(&pulses);
+    stats->late_max_ticks = atomic_get(&late_max_ticks);
+    stats->commits = atomic_get(&commits);
+    stats->rejected = atomic_get(&rejected);
+    stats->dropped = ppr_ring_dropped(&shm->evt);
+}
@@ -0,0 +1,24 @@
+#ifndef PPR_LINK_H
+#define PPR_LINK_H
+
+#include <zephyr/types.h>
+
+// Application core side of the PPR sequencer. Settings are compiled into
+// the biphasic stim_program here and sent over the command ring; the PPR
+// switches to them at the end of its current loop. The event ring is
+// drained from the system work queue, so nothing on this core runs at the
+// rate of the pulses.
+typedef struct {
+    uint32_t pulses;            // program loops reported by the PPR
+    uint32_t late_max_ticks;    // worst entry lateness of any loop
+    uint32_t commits;           // programs the PPR accepted
+    uint32_t rejected;          // programs the PPR refused
+    uint32_t dropped;           // PPR events lost to a full ring
+} ppr_stats;
+
+// Waits for the PPR to come up and starts the boot setting
+int ppr_link_init(void);
+int ppr_link_load_setting(uint16_t frequency_hz, uint16_t pulse_width_us, uint16_t amplitude);
+void get_ppr_stats(ppr_stats *stats);
+
+#endif // PPR_LINK_H
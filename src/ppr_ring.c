@@ -0,0 +1,97 @@
+#include <zephyr/types.h>
+#include <zephyr/cache.h>
+#include <zephyr/sys/barrier.h>
+#include <errno.h>
+#include <string.h>
+#include "ppr_ring.h"
+
+// No-ops on the PPR and on native_sim, which have no data cache
+static inline void shm_flush(const volatile void *addr, size_t len) {
+    sys_cache_data_flush_range((void *)addr, len);
+}
+
+static inline void shm_invalidate(const volatile void *addr, size_t len) {
+    sys_cache_data_invd_range((void *)addr, len);
+}
+
+void ppr_ring_init(ppr_ring *ring) {
+    memset((void *)ring, 0, sizeof(*ring));
+    shm_flush(ring, sizeof(*ring));
+}
+
+uint32_t ppr_ring_space(ppr_ring *ring) {
+    shm_invalidate(&ring->tail, PPR_SHM_LINE);
+    return PPR_RING_DEPTH - (ring->head - ring->tail);
+}
+
+bool ppr_ring_put(ppr_ring *ring, const ppr_msg *msg) {
+    uint32_t head = ring->head;
+
+    if (ppr_ring_space(ring) == 0) {
+        ring->dropped++;
+        shm_flush(&ring->head, PPR_SHM_LINE);
+        return false;
+    }
+    ppr_msg *slot = &ring->slots[head & (PPR_RING_DEPTH - 1)];
+    memcpy(slot, msg, sizeof(*slot));
+    shm_flush(slot, sizeof(*slot));
+    // The message is visible before the head that publishes it
+    barrier_dmem_fence_full();
+    ring->head = head + 1;
+    shm_flush(&ring->head, PPR_SHM_LINE);
+    return true;
+}
+
+int ppr_ring_put_program(ppr_ring *ring, const stim_program *program, uint32_t seq) {
+    ppr_msg msg;
+
+    if ((program->count == 0) || (program->count > STIM_PROGRAM_MAX_ENTRIES)) {
+        return -EINVAL;
+    }
+    // Single producer: the space found here cannot shrink before the puts
+    if (ppr_ring_space(ring) < program->count + 2U) {
+        return -EAGAIN;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.type = PPR_MSG_PROGRAM_BEGIN;
+    msg.index = program->count;
+    msg.seq = seq;
+    ppr_ring_put(ring, &msg);
+
+    msg.type = PPR_MSG_PROGRAM_ENTRY;
+    for (uint16_t i = 0; i < program->count; i++) {
+        msg.index = i;
+        msg.entry = program->entries[i];
+        ppr_ring_put(ring, &msg);
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = PPR_MSG_PROGRAM_COMMIT;
+    msg.seq = seq;
+    ppr_ring_put(ring, &msg);
+    return 0;
+}
+
+bool ppr_ring_get(ppr_ring *ring, ppr_msg *msg) {
+    uint32_t tail = ring->tail;
+
+    shm_invalidate(&ring->head, PPR_SHM_LINE);
+    if (ring->head == tail) {
+        return false;
+    }
+    // The head is read before the message it published
+    barrier_dmem_fence_full();
+    const ppr_msg *slot = &ring->slots[tail & (PPR_RING_DEPTH - 1)];
+    shm_invalidate(slot, sizeof(*slot));
+    memcpy(msg, slot, sizeof(*msg));
+    // ... and the message before its slot is handed back
+    barrier_dmem_fence_full();
+    ring->tail = tail + 1;
+    shm_flush(&ring->tail, PPR_SHM_LINE);
+    return true;
+}
+
+uint32_t ppr_ring_dropped(ppr_ring *ring) {
+    shm_invalidate(&ring->head, PPR_SHM_LINE);
+    return ring->dropped;
+}
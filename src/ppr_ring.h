@@ -0,0 +1,75 @@
+#ifndef PPR_RING_H
+#define PPR_RING_H
+
+#include <zephyr/types.h>
+#include <zephyr/toolchain.h>
+#include "stim_program.h"
+
+// Shared memory between the application core and the pulse sequencer on the
+// nRF54H20 PPR: one single-producer, single-consumer ring each way, of fixed
+// 32-byte messages. Neither side takes a lock or an interrupt; the producer
+// only writes head, the consumer only writes tail, and both indices run
+// free. Each index has a data cache line of its own, so the application
+// core can flush what it wrote and invalidate what the other side wrote
+// without touching a line the PPR writes.
+#define PPR_SHM_MAGIC       0x50505231  // "PPR1", set by the PPR once both rings are ready
+#define PPR_SHM_VERSION     1
+#define PPR_SHM_LINE        32          // data cache line of the application core
+#define PPR_RING_DEPTH      64          // power of two, holds a full program upload
+// Program deltas are in ticks of the PPR timer
+#define PPR_TICKS_PER_US    16
+
+typedef enum {
+    // Application core -> PPR
+    PPR_MSG_PROGRAM_BEGIN = 1,  // index: entry count
+    PPR_MSG_PROGRAM_ENTRY,      // index: entry offset, entry
+    PPR_MSG_PROGRAM_COMMIT,     // played from the end of the current loop
+    // PPR -> application core
+    PPR_MSG_READY = 0x80,       // seq: PPR_SHM_VERSION
+    PPR_MSG_ACK,                // seq: commit, status: 0 or a negative errno
+    PPR_MSG_LOOP,               // seq: loops played, value: worst entry lateness (ticks), program seq
+} ppr_msg_type;
+
+typedef struct {
+    uint8_t type;               // ppr_msg_type
+    int8_t status;
+    uint16_t index;
+    uint32_t seq;               // upload sequence number, or as per type
+    union {
+        stim_program_entry entry;
+        uint32_t value[6];
+    };
+} ppr_msg;
+
+typedef struct {
+    volatile uint32_t head;     // producer
+    volatile uint32_t dropped;  // producer: messages that found the ring full
+    uint8_t head_pad[PPR_SHM_LINE - 8];
+    volatile uint32_t tail;     // consumer
+    uint8_t tail_pad[PPR_SHM_LINE - 4];
+    ppr_msg slots[PPR_RING_DEPTH];
+} __aligned(PPR_SHM_LINE) ppr_ring;
+
+typedef struct {
+    volatile uint32_t magic;
+    volatile uint32_t version;
+    uint8_t pad[PPR_SHM_LINE - 8];
+    ppr_ring cmd;               // application core -> PPR
+    ppr_ring evt;               // PPR -> application core
+} __aligned(PPR_SHM_LINE) ppr_shm;
+
+BUILD_ASSERT(sizeof(ppr_msg) == PPR_SHM_LINE, "ppr_msg must fill one cache line");
+
+// Both rings, by the PPR before it sets magic
+void ppr_ring_init(ppr_ring *ring);
+// Producer side
+uint32_t ppr_ring_space(ppr_ring *ring);
+bool ppr_ring_put(ppr_ring *ring, const ppr_msg *msg);
+// Begin, entries and commit of one upload, all or nothing; -EAGAIN when the
+// ring cannot take the whole program yet
+int ppr_ring_put_program(ppr_ring *ring, const stim_program *program, uint32_t seq);
+// Consumer side
+bool ppr_ring_get(ppr_ring *ring, ppr_msg *msg);
+uint32_t ppr_ring_dropped(ppr_ring *ring);
+
+#endif // PPR_RING_H
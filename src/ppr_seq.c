@@ -0,0 +1,132 @@
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include <string.h>
+#include "ppr_seq.h"
+#include "ppr_hal.h"
+
+void ppr_seq_init(ppr_seq *seq, uint32_t min_delta_ticks,
+                  const uint32_t allowed_pins[STIM_PROGRAM_PORTS]) {
+    memset(seq, 0, sizeof(*seq));
+    seq->min_delta_ticks = min_delta_ticks;
+    memcpy(seq->allowed_pins, allowed_pins, sizeof(seq->allowed_pins));
+}
+
+static void reply(ppr_ring *evt, uint8_t type, uint32_t value_seq, int status) {
+    ppr_msg msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = type;
+    msg.status = status;
+    msg.seq = value_seq;
+    ppr_ring_put(evt, &msg);
+}
+
+static void commit(ppr_seq *seq, const ppr_msg *msg, ppr_ring *evt) {
+    stim_program *staging = &seq->banks[seq->active ^ 1];
+    int err = seq->load_err;
+
+    if (!err && (msg->seq != seq->seq)) {
+        err = -EINVAL;      // entries of another upload
+    }
+    if (!err) {
+        err = stim_program_validate(staging, seq->min_delta_ticks, seq->allowed_pins);
+    }
+    if (!err) {
+        if (seq->running) {
+            seq->pending = true;
+        } else {
+            // First program: starts one delta from now
+            seq->active ^= 1;
+            seq->playing_seq = seq->seq;
+            seq->step = 0;
+            seq->deadline = ppr_hal_now() + seq->banks[seq->active].entries[0].delta_ticks;
+            seq->running = true;
+        }
+    }
+    reply(evt, PPR_MSG_ACK, msg->seq, err);
+}
+
+void ppr_seq_command(ppr_seq *seq, const ppr_msg *msg, ppr_ring *evt) {
+    stim_program *staging = &seq->banks[seq->active ^ 1];
+
+    switch (msg->type) {
+        case PPR_MSG_PROGRAM_BEGIN:
+            // Withdraws a commit not taken yet, the bank is rewritten
+            seq->pending = false;
+            stim_program_reset(staging);
+            seq->seq = msg->seq;
+            seq->load_err = 0;
+            if ((msg->index == 0) || (msg->index > STIM_PROGRAM_MAX_ENTRIES)) {
+                seq->load_err = -EINVAL;
+                break;
+            }
+            staging->count = msg->index;
+            break;
+        case PPR_MSG_PROGRAM_ENTRY:
+            if ((msg->seq != seq->seq) || (msg->index >= staging->count)) {
+                seq->load_err = -EINVAL;
+                break;
+            }
+            staging->entries[msg->index] = msg->entry;
+            break;
+        case PPR_MSG_PROGRAM_COMMIT:
+            commit(seq, msg, evt);
+            break;
+        default:
+            reply(evt, PPR_MSG_ACK, msg->seq, -ENOTSUP);
+            break;
+    }
+}
+
+static void step(ppr_seq *seq, ppr_ring *evt, uint32_t now) {
+    const stim_program *program = &seq->banks[seq->active];
+    const stim_program_entry *entry = &program->entries[seq->step];
+
+    ppr_hal_pins(entry->port, entry->set_mask, entry->clr_mask);
+    if (entry->dac != STIM_PROGRAM_DAC_NONE) {
+        ppr_hal_dac_write(entry->dac, entry->dac_code);
+    }
+    seq->late_max = MAX(seq->late_max, now - seq->deadline);
+
+    if (++seq->step == program->count) {
+        ppr_msg msg;
+
+        seq->step = 0;
+        seq->loops++;
+        memset(&msg, 0, sizeof(msg));
+        msg.type = PPR_MSG_LOOP;
+        msg.seq = seq->loops;
+        msg.value[0] = seq->late_max;
+        msg.value[1] = seq->playing_seq;
+        ppr_ring_put(evt, &msg);
+        seq->late_max = 0;
+        if (seq->pending) {
+            seq->pending = false;
+            seq->active ^= 1;
+            seq->playing_seq = seq->seq;
+            program = &seq->banks[seq->active];
+        }
+    }
+    seq->deadline += program->entries[seq->step].delta_ticks;
+}
+
+void ppr_seq_poll(ppr_seq *seq, ppr_ring *cmd, ppr_ring *evt) {
+    ppr_msg msg;
+
+    if (seq->running) {
+        uint32_t now = ppr_hal_now();
+        int32_t until = (int32_t)(seq->deadline - now);
+
+        if (until <= 0) {
+            step(seq, evt, now);
+            return;
+        }
+        if ((uint32_t)until < seq->min_delta_ticks) {
+            return;
+        }
+    }
+    if (ppr_ring_get(cmd, &msg)) {
+        ppr_seq_command(seq, &msg, evt);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef PPR_SEQ_H
+#define PPR_SEQ_H
+
+#include <zephyr/types.h>
+#include "stim_program.h"
+#include "ppr_ring.h"
+
+// Pulse sequencer of the PPR: plays a stim_program against a free-running
+// timer by polling, with no interrupts at all. Programs arrive on the
+// command ring and are loaded into the bank that is not playing; a commit
+// switches banks at the end of the current loop, as in program_engine.c.
+// A command is only taken while the next entry is at least min_delta_ticks
+// away, so loading a program never delays an edge.
+#define PPR_MIN_DELTA_US    50  // a commit validating a full program, at 16 MHz
+
+typedef struct {
+    stim_program banks[2];
+    uint8_t active;
+    bool pending;               // staging bank committed, taken at the loop end
+    bool running;
+    int8_t load_err;            // of the upload in the staging bank
+    uint16_t step;
+    uint32_t deadline;          // timer tick of entries[step]
+    uint32_t seq;               // upload in the staging bank
+    uint32_t playing_seq;
+    uint32_t loops;
+    uint32_t late_max;          // this loop, ticks
+    uint32_t min_delta_ticks;
+    uint32_t allowed_pins[STIM_PROGRAM_PORTS];
+} ppr_seq;
+
+void ppr_seq_init(ppr_seq *seq, uint32_t min_delta_ticks,
+                  const uint32_t allowed_pins[STIM_PROGRAM_PORTS]);
+// Applies one message from the application core, replies on evt
+void ppr_seq_command(ppr_seq *seq, const ppr_msg *msg, ppr_ring *evt);
+// One pass of the PPR main loop: the due entry, or else one command
+void ppr_seq_poll(ppr_seq *seq, ppr_ring *cmd, ppr_ring *evt);
+
+#endif // PPR_SEQ_H
@@ -0,0 +1,163 @@
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include "profile_cache.h"
+
+#define LAST_KEY "last"
+
+static bool setting_usable(const stim_setting *setting) {
+    return (setting->frequency > 0) && (setting->pulse_width > 0);
+}
+
+// "p<n>" with n a slot number, -1 otherwise
+static int slot_from_key(const char *key) {
+    int slot = 0;
+
+    // One spelling per slot: no leading zeros
+    if ((key[0] != 'p') || (key[1] == '\0') || ((key[1] == '0') && (key[2] != '\0'))) {
+        return -1;
+    }
+    for (const char *c = &key[1]; *c != '\0'; c++) {
+        if ((*c < '0') || (*c > '9') || (slot >= PROFILE_SLOTS)) {
+            return -1;
+        }
+        slot = slot * 10 + (*c - '0');
+    }
+    return (slot < PROFILE_SLOTS) ? slot : -1;
+}
+
+static void copy_name(char *dst, const char *name) {
+    memset(dst, 0, PROFILE_NAME_LEN);
+    strncpy(dst, name, PROFILE_NAME_LEN - 1);
+}
+
+void profile_cache_init(profile_cache *cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+int profile_cache_load(profile_cache *cache, const char *key, const void *value, size_t len) {
+    if (strcmp(key, LAST_KEY) == 0) {
+        stim_setting setting;
+
+        if (len != sizeof(setting)) {
+            return -EINVAL;
+        }
+        memcpy(&setting, value, sizeof(setting));
+        if (!setting_usable(&setting)) {
+            return -EINVAL;
+        }
+        cache->last = cache->stored_last = setting;
+        cache->last_valid = cache->stored_last_valid = true;
+        return 0;
+    }
+
+    int slot = slot_from_key(key);
+    stim_profile profile;
+
+    if (slot < 0) {
+        return -ENOENT;
+    }
+    if (len != sizeof(profile)) {
+        return -EINVAL;
+    }
+    memcpy(&profile, value, sizeof(profile));
+    if (!setting_usable(&profile.setting)) {
+        return -EINVAL;
+    }
+    profile.name[PROFILE_NAME_LEN - 1] = '\0';
+    cache->slots[slot] = cache->stored_slots[slot] = profile;
+    cache->slots_valid |= BIT(slot);
+    cache->stored_slots_valid |= BIT(slot);
+    return 0;
+}
+
+void profile_cache_set_last(profile_cache *cache, const stim_setting *setting) {
+    cache->last = *setting;
+    cache->last_valid = true;
+}
+
+int profile_cache_save(profile_cache *cache, uint8_t slot, const char *name,
+                       const stim_setting *setting) {
+    if (slot >= PROFILE_SLOTS) {
+        return -EINVAL;
+    }
+    if (!setting_usable(setting)) {
+        return -EINVAL;
+    }
+    // Padded, so saving the same profile again compares equal
+    copy_name(cache->slots[slot].name, name);
+    cache->slots[slot].setting = *setting;
+    cache->slots_valid |= BIT(slot);
+    return 0;
+}
+
+int profile_cache_get(const profile_cache *cache, uint8_t slot, stim_profile *profile) {
+    if (slot >= PROFILE_SLOTS) {
+        return -EINVAL;
+    }
+    if (!(cache->slots_valid & BIT(slot))) {
+        return -ENOENT;
+    }
+    *profile = cache->slots[slot];
+    return 0;
+}
+
+int profile_cache_delete(profile_cache *cache, uint8_t slot) {
+    if (slot >= PROFILE_SLOTS) {
+        return -EINVAL;
+    }
+    if (!(cache->slots_valid & BIT(slot))) {
+        return -ENOENT;
+    }
+    cache->slots_valid &= ~BIT(slot);
+    return 0;
+}
+
+bool profile_cache_next_write(const profile_cache *cache, profile_write *write) {
+    if (cache->last_valid && (!cache->stored_last_valid ||
+        (memcmp(&cache->last, &cache->stored_last, sizeof(cache->last)) != 0))) {
+        strcpy(write->key, LAST_KEY);
+        write->value = &cache->last;
+        write->len = sizeof(cache->last);
+        return true;
+    }
+    for (int slot = 0; slot < PROFILE_SLOTS; slot++) {
+        bool valid = cache->slots_valid & BIT(slot);
+        bool stored = cache->stored_slots_valid & BIT(slot);
+
+        if (!valid && !stored) {
+            continue;
+        }
+        if (valid && stored && (memcmp(&cache->slots[slot], &cache->stored_slots[slot],
+                                       sizeof(stim_profile)) == 0)) {
+            continue;
+        }
+        snprintf(write->key, sizeof(write->key), "p%d", slot);
+        write->value = valid ? &cache->slots[slot] : NULL;
+        write->len = valid ? sizeof(stim_profile) : 0;
+        return true;
+    }
+    return false;
+}
+
+void profile_cache_written(profile_cache *cache, const profile_write *write) {
+    if (strcmp(write->key, LAST_KEY) == 0) {
+        memcpy(&cache->stored_last, write->value, sizeof(cache->stored_last));
+        cache->stored_last_valid = true;
+        return;
+    }
+
+    int slot = slot_from_key(write->key);
+
+    if (slot < 0) {
+        return;
+    }
+    if (write->len == 0) {
+        cache->stored_slots_valid &= ~BIT(slot);
+    } else {
+        memcpy(&cache->stored_slots[slot], write->value, sizeof(stim_profile));
+        cache->stored_slots_valid |= BIT(slot);
+    }
+}
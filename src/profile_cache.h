@@ -0,0 +1,60 @@
+#ifndef PROFILE_CACHE_H
+#define PROFILE_CACHE_H
+
+#include <zephyr/types.h>
+#include "data.h"
+
+// RAM image of the stimulation settings kept in flash under "chronos/":
+//   "last"   the last committed stim_setting, applied at boot
+//   "p<n>"   named profile n, saved and selected by the profile commands
+// Next to every value the cache keeps a copy of what flash holds, so only
+// values that really changed are written, and only their latest state.
+#if defined(CONFIG_CHRONOS_STIM_PROFILE_SLOTS)
+#define PROFILE_SLOTS CONFIG_CHRONOS_STIM_PROFILE_SLOTS
+#else
+#define PROFILE_SLOTS 4
+#endif
+#define PROFILE_NAME_LEN 16     // including the NUL
+#define PROFILE_KEY_LEN 8
+
+typedef struct {
+    char name[PROFILE_NAME_LEN];
+    stim_setting setting;
+} stim_profile;
+
+typedef struct {
+    stim_setting last;
+    stim_profile slots[PROFILE_SLOTS];
+    bool last_valid;
+    uint32_t slots_valid;           // bit n: slots[n] in use
+    // What flash holds
+    stim_setting stored_last;
+    stim_profile stored_slots[PROFILE_SLOTS];
+    bool stored_last_valid;
+    uint32_t stored_slots_valid;
+} profile_cache;
+
+// One value to bring flash in line with the cache; len 0 deletes the key
+typedef struct {
+    char key[PROFILE_KEY_LEN];
+    const void *value;
+    size_t len;
+} profile_write;
+
+void profile_cache_init(profile_cache *cache);
+// A value read back from flash, key relative to "chronos/". Values that do
+// not parse or hold an unusable setting are rejected.
+int profile_cache_load(profile_cache *cache, const char *key, const void *value, size_t len);
+void profile_cache_set_last(profile_cache *cache, const stim_setting *setting);
+// name is NUL-padded or NUL-terminated within PROFILE_NAME_LEN
+int profile_cache_save(profile_cache *cache, uint8_t slot, const char *name,
+                       const stim_setting *setting);
+int profile_cache_get(const profile_cache *cache, uint8_t slot, stim_profile *profile);
+int profile_cache_delete(profile_cache *cache, uint8_t slot);
+// The first value that differs from flash, false when flash is up to date.
+// write->value points into the cache and is only valid until the next change.
+bool profile_cache_next_write(const profile_cache *cache, profile_write *write);
+// write (with value pointing at what was actually written) is now in flash
+void profile_cache_written(profile_cache *cache, const profile_write *write);
+
+#endif // PROFILE_CACHE_H
@@ -0,0 +1,147 @@
+#include <nrfx_timer.h>
+#include <hal/nrf_gpio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include "program_engine.h"
+#include "stim_program.h"
+#include "timer.h"
+#include "spi.h"
+
+// One bank is played while the other is loaded, as with the waveform tables.
+// The ISR flips active_bank at the end of a loop while commit_pending is set;
+// the loading side withdraws a pending commit before touching the staging
+// bank, so the ISR never plays a half-loaded program.
+static stim_program banks[2];
+static uint8_t active_bank = 0;
+static atomic_t commit_pending;
+static const nrfx_timer_t *program_timer;
+
+static uint16_t step_index = 0;     // ISR only
+static uint32_t step_deadline = 0;  // ISR only
+static uint8_t step_buf_tx[DAC_TX_LEN];
+static uint8_t step_buf_rx[DAC_RX_LEN];
+
+static NRF_GPIO_Type *const ports[STIM_PROGRAM_PORTS] = {NRF_P0, NRF_P1};
+static const uint32_t dac_cs_pins[] = {0, DAC1_CS_PIN, DAC2_CS_PIN};
+// A program may only drive the phase and switch pins (P1.03, P1.00, P1.01);
+// the DAC chip selects belong to the SPI driver
+static const uint32_t allowed_pins[STIM_PROGRAM_PORTS] = {0, BIT(0) | BIT(1) | BIT(3)};
+
+static stim_program *staging_edit(void) {
+    atomic_clear(&commit_pending);
+    return &banks[active_bank ^ 1];
+}
+
+void program_init(const nrfx_timer_t *timer) {
+    program_timer = timer;
+    active_bank = 0;
+    step_index = 0;
+    atomic_clear(&commit_pending);
+
+    int err = stim_program_build_biphasic(&banks[0],
+        nrfx_timer_us_to_ticks(timer, DEFAULT_STIM_PERIOD),
+        nrfx_timer_us_to_ticks(timer, DEFAULT_PULSE_WIDTH),
+        nrfx_timer_us_to_ticks(timer, SWITCH_PERIOD),
+        (dac1_buf_tx[0] << 8) | dac1_buf_tx[1], (dac2_buf_tx[0] << 8) | dac2_buf_tx[1],
+        NRF_GPIO_PIN_MAP(1, 3), NRF_GPIO_PIN_MAP(1, 0), NRF_GPIO_PIN_MAP(1, 1));
+    if (err) {
+        printf("Default stimulation program failed with error: %d\n", err);
+    }
+}
+
+// TIMER0 tick of the first entry, for CC0 before the timer is started.
+uint32_t program_start(void) {
+    // A program committed before the start plays from the first loop
+    if (atomic_clear(&commit_pending)) {
+        active_bank ^= 1;
+    }
+    step_index = 0;
+    step_deadline = banks[active_bank].entries[0].delta_ticks;
+    return step_deadline;
+}
+
+// Timer ISR, COMPARE0: perform the due entry and move CC0 to the next one.
+void program_step(NRF_TIMER_Type *timer) {
+    const stim_program *program = &banks[active_bank];
+    const stim_program_entry *entry = &program->entries[step_index];
+
+    nrf_gpio_port_out_set(ports[entry->port], entry->set_mask);
+    nrf_gpio_port_out_clear(ports[entry->port], entry->clr_mask);
+    if (entry->dac != STIM_PROGRAM_DAC_NONE) {
+        step_buf_tx[0] = (entry->dac_code >> 8) & 0xFF;  // MSB
+        step_buf_tx[1] = entry->dac_code & 0xFF;         // LSB
+        spi_write_dac(dac_cs_pins[entry->dac], step_buf_tx, step_buf_rx);
+    }
+
+    if (++step_index == program->count) {
+        step_index = 0;
+        if (atomic_clear(&commit_pending)) {
+            active_bank ^= 1;
+            program = &banks[active_bank];
+        }
+    }
+    step_deadline += program->entries[step_index].delta_ticks;
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL0, step_deadline);
+}
+
+int program_load_setting(uint16_t frequency_hz, uint16_t pulse_width_us, uint16_t amplitude) {
+    if (frequency_hz == 0) {
+        return -EINVAL;
+    }
+
+    stim_program *staging = staging_edit();
+    int err = stim_program_build_biphasic(staging,
+        nrfx_timer_us_to_ticks(program_timer, 1000000 / frequency_hz),
+        nrfx_timer_us_to_ticks(program_timer, pulse_width_us),
+        nrfx_timer_us_to_ticks(program_timer, SWITCH_PERIOD),
+        amplitude, dac_opposite_code(amplitude),
+        NRF_GPIO_PIN_MAP(1, 3), NRF_GPIO_PIN_MAP(1, 0), NRF_GPIO_PIN_MAP(1, 1));
+    if (err) {
+        return err;
+    }
+    return program_commit();
+}
+
+int program_begin(uint16_t entry_count) {
+    if ((entry_count == 0) || (entry_count > STIM_PROGRAM_MAX_ENTRIES)) {
+        return -EINVAL;
+    }
+
+    stim_program *staging = staging_edit();
+    stim_program_reset(staging);
+    staging->count = entry_count;
+    return 0;
+}
+
+int program_write(uint16_t offset, const uint8_t *wire, uint16_t count) {
+    stim_program *staging = staging_edit();
+
+    if ((uint32_t)offset + count > staging->count) {
+        return -EINVAL;
+    }
+    for (uint16_t i = 0; i < count; i++, wire += PROGRAM_WIRE_ENTRY_LEN) {
+        stim_program_entry *entry = &staging->entries[offset + i];
+
+        entry->delta_ticks = nrfx_timer_us_to_ticks(program_timer, sys_get_le32(&wire[0]));
+        entry->set_mask = sys_get_le32(&wire[4]);
+        entry->clr_mask = sys_get_le32(&wire[8]);
+        entry->dac_code = sys_get_le16(&wire[12]);
+        entry->port = wire[14];
+        entry->dac = wire[15];
+    }
+    return 0;
+}
+
+// Hand the staging program to the ISR, which switches to it at the end of
+// the current loop.
+int program_commit(void) {
+    const stim_program *staging = &banks[active_bank ^ 1];
+    int err = stim_program_validate(staging,
+                                    nrfx_timer_us_to_ticks(program_timer, PROGRAM_MIN_DELTA_US),
+                                    allowed_pins);
+    if (err) {
+        return err;
+    }
+    atomic_set(&commit_pending, 1);
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef PROGRAM_ENGINE_H
+#define PROGRAM_ENGINE_H
+
+#include <nrfx_timer.h>
+#include <zephyr/types.h>
+
+// Plays a stim_program on TIMER0 CC0. The timer runs free and every entry
+// moves CC0 on by the next delta, so the pattern never drifts.
+#define PROGRAM_MIN_DELTA_US    20  // ISR entry plus one blocking DAC write
+#define PROGRAM_WIRE_ENTRY_LEN  16  // u32 delta_us, u32 set, u32 clr, u16 code, u8 port, u8 dac
+
+void program_init(const nrfx_timer_t *timer);
+uint32_t program_start(void);
+void program_step(NRF_TIMER_Type *timer);
+int program_load_setting(uint16_t frequency_hz, uint16_t pulse_width_us, uint16_t amplitude);
+int program_begin(uint16_t entry_count);
+int program_write(uint16_t offset, const uint8_t *wire, uint16_t count);
+int program_commit(void);
+
+#endif // PROGRAM_ENGINE_H
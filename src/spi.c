@@ -3,35 +3,70 @@
 #include <zephyr/device.h>
 #include <hal/nrf_gpio.h>
 #include "spi.h"
+#include "timer.h"
+#include "evlog.h"
 #include "config.h"
+#if defined(CONFIG_CHRONOS_DAC_PAIR)
+#include <zephyr/devicetree.h>
+#endif
 
 static nrfx_spim_t spim_inst = NRFX_SPIM_INSTANCE(SPIM_INST_IDX);
 static void spim_handler(nrfx_spim_evt_t const * p_event, void * p_context);
+// A zero-latency timer ISR writes the DACs above the SPIM1 interrupt, which
+// then never gets to clear the busy state between the EVENT0 and EVENT2
+// writes. Those builds drive SPIM1 blocking; the DPPI and waveform paths
+// hold their transfers for the PPI and keep the handler.
+#define SPIM_BLOCKING (IS_ENABLED(CONFIG_CHRONOS_STIM_IRQ_ZLI) && \
+                       !IS_ENABLED(CONFIG_CHRONOS_DAC_DPPI) &&    \
+                       !IS_ENABLED(CONFIG_CHRONOS_WAVEFORM))
 uint8_t dac1_buf_tx[DAC_TX_LEN] = {0x52, 0x53};
 uint8_t dac2_buf_tx[DAC_TX_LEN] = {0x54, 0x55};
 uint8_t dac1_buf_rx[DAC_RX_LEN];
 uint8_t dac2_buf_rx[DAC_RX_LEN];
+// DPPI mode: DAC1 and DAC2 codes back to back, walked by the SPIM in
+// ArrayList mode so each START sends the next entry
+static uint8_t dac_tx_list[2][DAC_TX_LEN];
+
+#if defined(CONFIG_CHRONOS_DAC_PAIR)
+// Pair mode: both DACs on SPIM4, each behind its own chip select as on
+// SPIM1; the DAC8832 has no serial output to chain through. Pins and bus
+// rate come from the spi4 node of the board overlay, read as
+// common-pinctrl.dtsi describes.
+#define DAC_PAIR_INST_IDX 4
+#define DAC_PAIR_NODE DT_NODELABEL(spi4)
+#define DAC_PAIR_PINCTRL_NODE DT_CHILD(DT_PINCTRL_0(DAC_PAIR_NODE, 0), group1)
+#define DAC_PAIR_SCK_PIN (DT_PROP_BY_IDX(DAC_PAIR_PINCTRL_NODE, psels, 0) & 0x3F)
+#define DAC_PAIR_MISO_PIN (DT_PROP_BY_IDX(DAC_PAIR_PINCTRL_NODE, psels, 1) & 0x3F)
+#define DAC_PAIR_MOSI_PIN (DT_PROP_BY_IDX(DAC_PAIR_PINCTRL_NODE, psels, 2) & 0x3F)
+#define DAC_PAIR_FREQUENCY DT_PROP(DAC_PAIR_NODE, max_frequency)
+
+static nrfx_spim_t dac_pair_inst = NRFX_SPIM_INSTANCE(DAC_PAIR_INST_IDX);
+// DAC1 and DAC2 codes back to back, one entry per chip select
+static uint8_t dac_pair_tx[2][DAC_TX_LEN] = {{0x52, 0x53}, {0x54, 0x55}};
+static const uint32_t dac_pair_cs_pins[] = {DAC1_CS_PIN, DAC2_CS_PIN};
+#endif
 void update_dac1_amplitude(uint16_t amplitude) {
-    dac1_buf_tx[0] = (amplitude >> 8) & 0xFF;  // MSB
-    dac1_buf_tx[1] = amplitude & 0xFF;         // LSB
-    
-    printf("DAC1 amplitude updated to %u (0x%02X 0x%02X)\n", 
-           amplitude, dac1_buf_tx[0], dac1_buf_tx[1]);
+    stim_params_set_dac1_code(amplitude);
+    evlog_write(EVLOG_DAC1_AMPLITUDE, amplitude, amplitude);
 }
 
 void update_dac2_amplitude(uint16_t amplitude) {
-    uint16_t opposite_amplitude;
-    if (amplitude == 0x0000) {
-        opposite_amplitude = 0xFFFF;  // Most negative → Most positive
-    } else {
-        opposite_amplitude = (uint16_t)(0x10000UL - amplitude);
-    }
+    uint16_t opposite_amplitude = dac_opposite_code(amplitude);
     
-    dac2_buf_tx[0] = (opposite_amplitude >> 8) & 0xFF;  // MSB
-    dac2_buf_tx[1] = opposite_amplitude & 0xFF;         // LSB
-    
-    printf("DAC2 amplitude updated to opposite of %u: %u (0x%02X 0x%02X)\n", 
-           amplitude, opposite_amplitude, dac2_buf_tx[0], dac2_buf_tx[1]);
+    stim_params_set_dac2_code(opposite_amplitude);
+    evlog_write(EVLOG_DAC2_AMPLITUDE, amplitude, opposite_amplitude);
+}
+
+// Timer ISR only: the codes sent by the following DAC transfers
+void spi_set_dac_codes(uint16_t dac1_code, uint16_t dac2_code) {
+    dac1_buf_tx[0] = (dac1_code >> 8) & 0xFF;  // MSB
+    dac1_buf_tx[1] = dac1_code & 0xFF;         // LSB
+    dac2_buf_tx[0] = (dac2_code >> 8) & 0xFF;  // MSB
+    dac2_buf_tx[1] = dac2_code & 0xFF;         // LSB
+#if defined(CONFIG_CHRONOS_DAC_PAIR)
+    memcpy(dac_pair_tx[0], dac1_buf_tx, DAC_TX_LEN);
+    memcpy(dac_pair_tx[1], dac2_buf_tx, DAC_TX_LEN);
+#endif
 }
 
 void cs_select(uint32_t pin_number) {
@@ -42,9 +77,8 @@ void cs_deselect(uint32_t pin_number) {
     nrf_gpio_pin_set(pin_number);     // Drive CS high (inactive)
 }
 
-void spi_write_dac1(uint8_t *tx_data, uint8_t *rx_data) {
-    // Select DAC1
-    cs_select(DAC1_CS_PIN);
+void spi_write_dac(uint32_t cs_pin, uint8_t *tx_data, uint8_t *rx_data) {
+    cs_select(cs_pin);
     memset(rx_data, 0, DAC_RX_LEN); // Clear RX buffer
     // Prepare transfer descriptor
     nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TRX(tx_data, DAC_TX_LEN, rx_data, DAC_RX_LEN);
@@ -52,33 +86,98 @@ void spi_write_dac1(uint8_t *tx_data, uint8_t *rx_data) {
     // Perform the transfer
     nrfx_err_t err = nrfx_spim_xfer(&spim_inst, &xfer_desc, 0);
     if(err != NRFX_SUCCESS){
-        printf("SPI ERROR\n");
+        evlog_write(EVLOG_SPI_ERROR, err, cs_pin);
     }
-    cs_deselect(DAC1_CS_PIN);
+    cs_deselect(cs_pin);
+}
+
+void spi_write_dac1(uint8_t *tx_data, uint8_t *rx_data) {
+    spi_write_dac(DAC1_CS_PIN, tx_data, rx_data);
 }
 
 void spi_write_dac2(uint8_t *tx_data, uint8_t *rx_data) {
-    // Select DAC1
-    cs_select(DAC2_CS_PIN);
-    memset(rx_data, 0, DAC_RX_LEN); // Clear RX buffer
-    // Prepare transfer descriptor
-    nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TRX(tx_data, DAC_TX_LEN, rx_data, DAC_RX_LEN);
-    
-    // Perform the transfer
-    nrfx_err_t err = nrfx_spim_xfer(&spim_inst, &xfer_desc, 0);
-    if(err != NRFX_SUCCESS){
-        printf("SPI ERROR\n");
+    spi_write_dac(DAC2_CS_PIN, tx_data, rx_data);
+}
+// Hold a DAC transfer in the SPIM in ArrayList mode: each START sends the
+// next DAC_TX_LEN entry of list. The transfer is started by (D)PPI, never by
+// the CPU, and re-holding it rewinds the list pointer.
+void spi_dac_list_arm(const uint8_t *list) {
+    nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TX(list, DAC_TX_LEN);
+    nrfx_err_t err = nrfx_spim_xfer(&spim_inst, &xfer_desc,
+                                    NRFX_SPIM_FLAG_TX_POSTINC |
+                                    NRFX_SPIM_FLAG_HOLD_XFER |
+                                    NRFX_SPIM_FLAG_REPEATED_XFER |
+                                    NRFX_SPIM_FLAG_NO_XFER_EVT_HANDLER);
+    if (err != NRFX_SUCCESS) {
+        evlog_write(EVLOG_SPI_ERROR, err, DAC1_CS_PIN);
+    }
+}
+
+// Copy the current DAC codes into the list and hold the transfer.
+// COMPARE0 then sends the DAC1 entry and COMPARE2 the DAC2 entry through
+// DPPI. Must be re-armed once per period after the DAC2 transfer.
+void spi_dac_dppi_arm(void) {
+    memcpy(dac_tx_list[0], dac1_buf_tx, DAC_TX_LEN);
+    memcpy(dac_tx_list[1], dac2_buf_tx, DAC_TX_LEN);
+    spi_dac_list_arm(dac_tx_list[0]);
+}
+
+#if defined(CONFIG_CHRONOS_DAC_PAIR)
+// Timer ISR only: both codes, one transfer per chip select. Blocking, as
+// 16 bits at 32 MHz are over before a completion interrupt could be taken.
+void spi_write_dac_pair(void) {
+    for (size_t i = 0; i < ARRAY_SIZE(dac_pair_cs_pins); i++) {
+        nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TX(dac_pair_tx[i], DAC_TX_LEN);
+
+        cs_select(dac_pair_cs_pins[i]);
+        nrfx_err_t err = nrfx_spim_xfer(&dac_pair_inst, &xfer_desc, 0);
+        cs_deselect(dac_pair_cs_pins[i]);
+        if (err != NRFX_SUCCESS) {
+            evlog_write(EVLOG_SPI_ERROR, err, dac_pair_cs_pins[i]);
+        }
     }
-    cs_deselect(DAC2_CS_PIN);
 }
+
+static void dac_pair_init(void) {
+    nrfx_spim_config_t spim_config = NRFX_SPIM_DEFAULT_CONFIG(DAC_PAIR_SCK_PIN,
+                                                              DAC_PAIR_MOSI_PIN,
+                                                              DAC_PAIR_MISO_PIN,
+                                                              NRF_SPIM_PIN_NOT_CONNECTED);
+
+    spim_config.frequency = DAC_PAIR_FREQUENCY;
+    // No handler: transfers block
+    nrfx_err_t status = nrfx_spim_init(&dac_pair_inst, &spim_config, NULL, NULL);
+    if (status == NRFX_SUCCESS) {
+        printf("DAC pair on SPIM%d at %d MHz\n", DAC_PAIR_INST_IDX,
+               DAC_PAIR_FREQUENCY / 1000000);
+    } else {
+        printf("DAC pair initialization failed with error: %d\n", status);
+    }
+}
+#endif
+
+uint32_t spi_dac_start_task_address(void) {
+    return nrfx_spim_start_task_address_get(&spim_inst);
+}
+
+uint32_t spi_dac_end_event_address(void) {
+    return nrfx_spim_end_event_address_get(&spim_inst);
+}
+
 void spi_init(){
+#if defined(CONFIG_CHRONOS_DAC_PAIR)
+    // Nothing is left on SPIM1
+    dac_pair_init();
+    return;
+#endif
     nrfx_spim_config_t spim_config = NRFX_SPIM_DEFAULT_CONFIG(SCK_PIN,
                                                               MOSI_PIN,
                                                               MISO_PIN,
                                                               NRF_SPIM_PIN_NOT_CONNECTED);
 
     spim_config.frequency = 8000000;
-    nrfx_err_t status = nrfx_spim_init(&spim_inst, &spim_config, spim_handler, NULL);
+    nrfx_err_t status = nrfx_spim_init(&spim_inst, &spim_config,
+                                        SPIM_BLOCKING ? NULL : spim_handler, NULL);
     if (status == NRFX_SUCCESS) {
         printf("SPI initialized successfully on SPIM%d\n", SPIM_INST_IDX);
         printf("  SCK: P%d.%02d\n", (SCK_PIN >> 5), (SCK_PIN & 0x1F));
@@ -91,7 +190,8 @@ void spi_init(){
 
 static void spim_handler(nrfx_spim_evt_t const * p_event, void * p_context){
     if ((p_event->type == NRFX_SPIM_EVENT_DONE)&& (SPI_VERBOSE == 1)){
-        printf("Message received: %02X\n", p_event->xfer_desc.p_rx_buffer);
+        const nrfx_spim_xfer_desc_t *xfer = &p_event->xfer_desc;
+        evlog_write(EVLOG_SPI_DONE, xfer->rx_length ? xfer->p_rx_buffer[0] : 0, xfer->rx_length);
     }
 }
 
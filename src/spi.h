@@ -14,13 +14,28 @@
 #define MISO_PIN 25
 #define SCK_PIN NRF_GPIO_PIN_MAP(1, 2)   //1.02
 
+// Shared with the PPR link, which builds programs without this driver
+static inline uint16_t dac_opposite_code(uint16_t amplitude) {
+    if (amplitude == 0x0000) {
+        return 0xFFFF;  // Most negative → Most positive
+    }
+    return (uint16_t)(0x10000UL - amplitude);
+}
+
 void cs_select(uint32_t pin_number);
 void cs_deselect(uint32_t pin_number);
 void spi_write_dac1(uint8_t *tx_data, uint8_t *rx_data);
 void spi_write_dac2(uint8_t *tx_data, uint8_t *rx_data);
+void spi_write_dac(uint32_t cs_pin, uint8_t *tx_data, uint8_t *rx_data);
 void spi_init();
 void update_dac1_amplitude(uint16_t amplitude);
 void update_dac2_amplitude(uint16_t amplitude);
+void spi_set_dac_codes(uint16_t dac1_code, uint16_t dac2_code);
+void spi_dac_list_arm(const uint8_t *list);
+void spi_dac_dppi_arm(void);
+void spi_write_dac_pair(void);
+uint32_t spi_dac_start_task_address(void);
+uint32_t spi_dac_end_event_address(void);
 
 extern uint8_t dac1_buf_rx[DAC_RX_LEN];
 extern uint8_t dac1_buf_tx[DAC_TX_LEN];
@@ -0,0 +1,19 @@
+#ifndef STIM_HAL_H
+#define STIM_HAL_H
+
+#include <zephyr/types.h>
+#include "stim_seq.h"
+
+// Thin shim between the sequencer table and the (D)PPI/GPIOTE hardware.
+// stim_hal_nrfx.c implements it on target; tests link a fake instead.
+
+#define STIM_GPIOTE_INST_IDX 0
+
+// Allocate one (D)PPI channel, publish every event in event_mask to it and
+// subscribe every task in tasks. Returns 0 or a negative errno.
+int stim_hal_connect(uint8_t event_mask, const stim_seq_task *tasks, uint8_t task_count);
+
+// Release every channel created by stim_hal_connect.
+void stim_hal_disconnect_all(void);
+
+#endif // STIM_HAL_H
@@ -0,0 +1,178 @@
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+#include <hal/nrf_gpio.h>
+#include <zephyr/kernel.h>
+#include "stim_hal.h"
+#include "timer.h"
+#include "spi.h"
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+#include "waveform.h"
+#endif
+
+#define HAL_MAX_ENDPOINTS (STIM_EVT_COUNT + STIM_SEQ_MAX_TASKS)
+
+typedef struct {
+    uint8_t channel;
+    uint8_t endpoint_count;
+    uint32_t endpoints[HAL_MAX_ENDPOINTS];
+    bool is_event[HAL_MAX_ENDPOINTS];
+} hal_channel;
+
+static const nrfx_gpiote_t gpiote = NRFX_GPIOTE_INSTANCE(STIM_GPIOTE_INST_IDX);
+static const nrfx_timer_t timer_inst = NRFX_TIMER_INSTANCE(TIMER_INST_IDX);
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+static const nrfx_timer_t sample_timer = NRFX_TIMER_INSTANCE(WAVEFORM_TIMER_INST_IDX);
+#endif
+
+static hal_channel channels[STIM_SEQ_MAX_CHANNELS];
+static size_t channel_count = 0;
+static uint32_t task_pins[GPIOTE_CH_NUM];
+static size_t task_pin_count = 0;
+
+// Hand a pin over to a GPIOTE task channel, keeping its current level.
+static int pin_task_setup(uint32_t pin) {
+    for (size_t i = 0; i < task_pin_count; i++) {
+        if (task_pins[i] == pin) {
+            return 0;
+        }
+    }
+    if (task_pin_count >= ARRAY_SIZE(task_pins)) {
+        return -ENOMEM;
+    }
+
+    nrfx_err_t err;
+    if (!nrfx_gpiote_init_check(&gpiote)) {
+        err = nrfx_gpiote_init(&gpiote, 0);
+        if (err != NRFX_SUCCESS) {
+            return -EIO;
+        }
+    }
+
+    uint8_t gpiote_channel;
+    err = nrfx_gpiote_channel_alloc(&gpiote, &gpiote_channel);
+    if (err != NRFX_SUCCESS) {
+        return -ENOMEM;
+    }
+
+    nrfx_gpiote_output_config_t output_config = NRFX_GPIOTE_DEFAULT_OUTPUT_CONFIG;
+    nrfx_gpiote_task_config_t task_config = {
+        .task_ch = gpiote_channel,
+        .polarity = NRF_GPIOTE_POLARITY_TOGGLE,
+        .init_val = nrf_gpio_pin_out_read(pin) ? NRF_GPIOTE_INITIAL_VALUE_HIGH
+                                               : NRF_GPIOTE_INITIAL_VALUE_LOW,
+    };
+    err = nrfx_gpiote_output_configure(&gpiote, pin, &output_config, &task_config);
+    if (err != NRFX_SUCCESS) {
+        nrfx_gpiote_channel_free(&gpiote, gpiote_channel);
+        return -EIO;
+    }
+    nrfx_gpiote_out_task_enable(&gpiote, pin);
+    task_pins[task_pin_count++] = pin;
+    return 0;
+}
+
+static uint32_t task_address(const stim_seq_task *task) {
+    switch (task->type) {
+        case STIM_TASK_PIN_SET:
+            return nrfx_gpiote_set_task_address_get(&gpiote, task->pin);
+        case STIM_TASK_PIN_CLR:
+            return nrfx_gpiote_clr_task_address_get(&gpiote, task->pin);
+        case STIM_TASK_PIN_TOGGLE:
+            return nrfx_gpiote_out_task_address_get(&gpiote, task->pin);
+        case STIM_TASK_SPIM_START:
+            return spi_dac_start_task_address();
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+        case STIM_TASK_SAMPLE_START:
+            return nrfx_timer_task_address_get(&sample_timer, NRF_TIMER_TASK_START);
+        case STIM_TASK_SAMPLE_STOP:
+            return nrfx_timer_task_address_get(&sample_timer, NRF_TIMER_TASK_STOP);
+        case STIM_TASK_SAMPLE_CLEAR:
+            return nrfx_timer_task_address_get(&sample_timer, NRF_TIMER_TASK_CLEAR);
+#endif
+        default:
+            break;
+    }
+    return 0;
+}
+
+static uint32_t event_address(stim_seq_event event) {
+    if (event == STIM_EVT_SPIM_END) {
+        return spi_dac_end_event_address();
+    }
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+    if (event == STIM_EVT_SAMPLE) {
+        return nrfx_timer_compare_event_address_get(&sample_timer, NRF_TIMER_CC_CHANNEL0);
+    }
+#endif
+    if (event > STIM_EVT_COMPARE5) {
+        return 0;
+    }
+    return nrfx_timer_compare_event_address_get(&timer_inst, (uint32_t)event);
+}
+
+int stim_hal_connect(uint8_t event_mask, const stim_seq_task *tasks, uint8_t task_count) {
+    if (channel_count >= ARRAY_SIZE(channels)) {
+        return -ENOMEM;
+    }
+
+    for (uint8_t i = 0; i < task_count; i++) {
+        if (!stim_seq_is_pin_task(tasks[i].type)) {
+            if (task_address(&tasks[i]) == 0) {
+                return -ENOTSUP;
+            }
+            continue;
+        }
+        int err = pin_task_setup(tasks[i].pin);
+        if (err) {
+            return err;
+        }
+    }
+    for (uint8_t event = 0; event < STIM_EVT_COUNT; event++) {
+        if ((event_mask & (1U << event)) && (event_address((stim_seq_event)event) == 0)) {
+            return -ENOTSUP;
+        }
+    }
+
+    hal_channel *ch = &channels[channel_count];
+    if (nrfx_gppi_channel_alloc(&ch->channel) != NRFX_SUCCESS) {
+        return -ENOMEM;
+    }
+    ch->endpoint_count = 0;
+
+    for (uint8_t event = 0; event < STIM_EVT_COUNT; event++) {
+        if (event_mask & (1U << event)) {
+            uint32_t eep = event_address((stim_seq_event)event);
+            nrfx_gppi_event_endpoint_setup(ch->channel, eep);
+            ch->is_event[ch->endpoint_count] = true;
+            ch->endpoints[ch->endpoint_count++] = eep;
+        }
+    }
+    for (uint8_t i = 0; i < task_count; i++) {
+        uint32_t tep = task_address(&tasks[i]);
+        nrfx_gppi_task_endpoint_setup(ch->channel, tep);
+        ch->is_event[ch->endpoint_count] = false;
+        ch->endpoints[ch->endpoint_count++] = tep;
+    }
+
+    nrfx_gppi_channels_enable(BIT(ch->channel));
+    channel_count++;
+    return 0;
+}
+
+void stim_hal_disconnect_all(void) {
+    for (size_t c = 0; c < channel_count; c++) {
+        hal_channel *ch = &channels[c];
+
+        nrfx_gppi_channels_disable(BIT(ch->channel));
+        for (uint8_t i = 0; i < ch->endpoint_count; i++) {
+            if (ch->is_event[i]) {
+                nrfx_gppi_event_endpoint_clear(ch->channel, ch->endpoints[i]);
+            } else {
+                nrfx_gppi_task_endpoint_clear(ch->channel, ch->endpoints[i]);
+            }
+        }
+        nrfx_gppi_channel_free(ch->channel);
+    }
+    channel_count = 0;
+}
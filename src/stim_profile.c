@@ -0,0 +1,159 @@
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <stdio.h>
+#include <string.h>
+#include "stim_profile.h"
+
+#define PROFILE_SUBTREE "chronos"
+
+// Edited from the command work queue, written back from the system work
+// queue; the lock is never held across a flash write
+static K_MUTEX_DEFINE(cache_lock);
+static profile_cache cache;
+static bool boot_valid;
+static stim_setting boot_setting;
+
+static atomic_t updates;
+static atomic_t writes;
+static atomic_t failures;
+
+static void save_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(save_work, save_handler);
+
+static int profile_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg) {
+    uint8_t value[sizeof(stim_profile)];
+
+    if (len > sizeof(value)) {
+        return -EINVAL;
+    }
+    ssize_t read = read_cb(cb_arg, value, len);
+    if (read < 0) {
+        return read;
+    }
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    int err = profile_cache_load(&cache, key, value, read);
+    k_mutex_unlock(&cache_lock);
+    if (err) {
+        printf("Profile: ignoring stored %s/%s (error: %d)\n", PROFILE_SUBTREE, key, err);
+    }
+    // A bad value must not stop the rest of the subtree from loading
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(chronos_profiles, PROFILE_SUBTREE, NULL, profile_set, NULL, NULL);
+
+// Writes every value that differs from flash. Each value is copied out under
+// the lock and written without it, so a change arriving during the write is
+// simply found different again on the next pass.
+static void save_handler(struct k_work *work) {
+    ARG_UNUSED(work);
+    char key[sizeof(PROFILE_SUBTREE) + PROFILE_KEY_LEN];
+    uint8_t value[sizeof(stim_profile)];
+    profile_write write;
+
+    for (;;) {
+        k_mutex_lock(&cache_lock, K_FOREVER);
+        bool pending = profile_cache_next_write(&cache, &write);
+        if (pending) {
+            memcpy(value, write.value, write.len);
+            write.value = value;
+        }
+        k_mutex_unlock(&cache_lock);
+        if (!pending) {
+            return;
+        }
+
+        snprintf(key, sizeof(key), PROFILE_SUBTREE "/%s", write.key);
+        int err = (write.len > 0) ? settings_save_one(key, value, write.len)
+                                  : settings_delete(key);
+        if (err) {
+            // Left different from flash, so the next save tries again
+            atomic_inc(&failures);
+            printf("Profile: saving %s failed with error: %d\n", key, err);
+            return;
+        }
+        atomic_inc(&writes);
+        k_mutex_lock(&cache_lock, K_FOREVER);
+        profile_cache_written(&cache, &write);
+        k_mutex_unlock(&cache_lock);
+    }
+}
+
+// k_work_schedule leaves a pending save where it is, so a stream of updates
+// costs one write per delay instead of pushing the save out indefinitely
+static void schedule_save(void) {
+    k_work_schedule(&save_work, K_MSEC(CONFIG_CHRONOS_STIM_PROFILE_SAVE_DELAY_MS));
+}
+
+const stim_setting *stim_profile_load(void) {
+    int err = settings_subsys_init();
+
+    if (err) {
+        printf("Profile: settings init failed with error: %d\n", err);
+        return NULL;
+    }
+    profile_cache_init(&cache);
+    err = settings_load_subtree(PROFILE_SUBTREE);
+    if (err) {
+        printf("Profile: loading failed with error: %d\n", err);
+    }
+    boot_valid = cache.last_valid;
+    boot_setting = cache.last;
+    return stim_profile_boot();
+}
+
+const stim_setting *stim_profile_boot(void) {
+    return boot_valid ? &boot_setting : NULL;
+}
+
+void stim_profile_note(const stim_setting *setting) {
+    if ((setting->frequency == 0) || (setting->pulse_width == 0)) {
+        // Not applied in full; the previous boot setting stays
+        return;
+    }
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    profile_cache_set_last(&cache, setting);
+    k_mutex_unlock(&cache_lock);
+    atomic_inc(&updates);
+    schedule_save();
+}
+
+int stim_profile_save(uint8_t slot, const char *name, const stim_setting *setting) {
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    int err = profile_cache_save(&cache, slot, name, setting);
+    k_mutex_unlock(&cache_lock);
+    if (err == 0) {
+        // An explicit save goes out now rather than with the next batch
+        k_work_reschedule(&save_work, K_NO_WAIT);
+    }
+    return err;
+}
+
+int stim_profile_select(uint8_t slot, stim_setting *setting) {
+    stim_profile profile;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    int err = profile_cache_get(&cache, slot, &profile);
+    k_mutex_unlock(&cache_lock);
+    if (err == 0) {
+        *setting = profile.setting;
+        printf("Profile %u \"%s\" selected\n", slot, profile.name);
+    }
+    return err;
+}
+
+int stim_profile_delete(uint8_t slot) {
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    int err = profile_cache_delete(&cache, slot);
+    k_mutex_unlock(&cache_lock);
+    if (err == 0) {
+        k_work_reschedule(&save_work, K_NO_WAIT);
+    }
+    return err;
+}
+
+void get_profile_stats(profile_stats *stats) {
+    stats->updates = atomic_get(&updates);
+    stats->writes = atomic_get(&writes);
+    stats->failures = atomic_get(&failures);
+}
@@ -0,0 +1,31 @@
+#ifndef STIM_PROFILE_H
+#define STIM_PROFILE_H
+
+#include <zephyr/types.h>
+#include "data.h"
+#include "profile_cache.h"
+
+// Stimulation settings kept in flash through the settings subsystem (NVS or
+// ZMS). stim_profile_load runs before bt_enable and timer_init starts the
+// train from the returned setting, so a reset resumes the last protocol
+// without the host. Changes only reach the RAM cache; a delayed save writes
+// whatever differs from flash once per CONFIG_CHRONOS_STIM_PROFILE_SAVE_DELAY_MS,
+// however many updates arrived in between.
+typedef struct {
+    uint32_t updates;           // settings changes noted since boot
+    uint32_t writes;            // values written or deleted in flash
+    uint32_t failures;          // failed writes, retried at the next save
+} profile_stats;
+
+// The last committed setting, NULL when flash holds none
+const stim_setting *stim_profile_load(void);
+const stim_setting *stim_profile_boot(void);
+// A setting was applied: becomes the boot setting at the next save
+void stim_profile_note(const stim_setting *setting);
+int stim_profile_save(uint8_t slot, const char *name, const stim_setting *setting);
+// Copies the profile into setting; the caller applies it
+int stim_profile_select(uint8_t slot, stim_setting *setting);
+int stim_profile_delete(uint8_t slot);
+void get_profile_stats(profile_stats *stats);
+
+#endif // STIM_PROFILE_H
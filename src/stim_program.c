@@ -0,0 +1,96 @@
+#include <zephyr/types.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+#include "stim_program.h"
+
+#define PIN_PORT(pin) ((pin) >> 5)
+#define PIN_MASK(pin) (1UL << ((pin) & 0x1F))
+
+void stim_program_reset(stim_program *program) {
+    memset(program, 0, sizeof(*program));
+}
+
+int stim_program_add(stim_program *program, const stim_program_entry *entry) {
+    if (program->count >= STIM_PROGRAM_MAX_ENTRIES) {
+        return -ENOMEM;
+    }
+    program->entries[program->count++] = *entry;
+    return 0;
+}
+
+// The fixed biphasic pulse as a program: phase pin and DAC1 at the start of
+// the period, phase pin off and switch pins on after the pulse width, the
+// same with DAC2 for the second phase. Pins are NRF_GPIO_PIN_MAP numbers;
+// the phase and switch pins have to share a port.
+int stim_program_build_biphasic(stim_program *program, uint32_t period_ticks,
+                                uint32_t pulse_width_ticks, uint32_t switch_ticks,
+                                uint16_t dac1_code, uint16_t dac2_code, uint32_t phase_pin,
+                                uint32_t switch0_pin, uint32_t switch1_pin) {
+    uint64_t pulse_ticks = (2ULL * pulse_width_ticks) + switch_ticks;
+
+    if ((pulse_width_ticks == 0) || (pulse_ticks >= period_ticks)) {
+        return -EINVAL;
+    }
+    if ((PIN_PORT(switch0_pin) != PIN_PORT(phase_pin)) ||
+        (PIN_PORT(switch1_pin) != PIN_PORT(phase_pin))) {
+        return -EINVAL;
+    }
+
+    uint8_t port = PIN_PORT(phase_pin);
+    uint32_t phase_mask = PIN_MASK(phase_pin);
+    uint32_t switch_mask = PIN_MASK(switch0_pin) | PIN_MASK(switch1_pin);
+    const stim_program_entry entries[] = {
+        {.delta_ticks = period_ticks - (uint32_t)pulse_ticks, .port = port,
+         .set_mask = phase_mask, .dac = STIM_PROGRAM_DAC1, .dac_code = dac1_code},
+        {.delta_ticks = pulse_width_ticks, .port = port,
+         .set_mask = switch_mask, .clr_mask = phase_mask},
+        {.delta_ticks = switch_ticks, .port = port,
+         .set_mask = phase_mask, .dac = STIM_PROGRAM_DAC2, .dac_code = dac2_code},
+        {.delta_ticks = pulse_width_ticks, .port = port,
+         .set_mask = switch_mask, .clr_mask = phase_mask},
+    };
+
+    stim_program_reset(program);
+    for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+        int err = stim_program_add(program, &entries[i]);
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+// Everything the ISR relies on without checking: every entry is far enough
+// from the previous one to be serviced in time and only touches pins the
+// program is allowed to drive.
+int stim_program_validate(const stim_program *program, uint32_t min_delta_ticks,
+                          const uint32_t allowed_pins[STIM_PROGRAM_PORTS]) {
+    if (program->count == 0) {
+        return -EINVAL;
+    }
+    for (uint16_t i = 0; i < program->count; i++) {
+        const stim_program_entry *entry = &program->entries[i];
+
+        if (entry->delta_ticks < min_delta_ticks) {
+            return -ERANGE;
+        }
+        if ((entry->port >= STIM_PROGRAM_PORTS) || (entry->dac > STIM_PROGRAM_DAC2)) {
+            return -EINVAL;
+        }
+        if ((entry->set_mask & entry->clr_mask) ||
+            ((entry->set_mask | entry->clr_mask) & ~allowed_pins[entry->port])) {
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+uint64_t stim_program_period(const stim_program *program) {
+    uint64_t ticks = 0;
+
+    for (uint16_t i = 0; i < program->count; i++) {
+        ticks += program->entries[i].delta_ticks;
+    }
+    return ticks;
+}
@@ -0,0 +1,46 @@
+#ifndef STIM_PROGRAM_H
+#define STIM_PROGRAM_H
+
+#include <zephyr/types.h>
+
+// Stimulation program: a flat table of (delta_ticks, action) entries played
+// in a loop by the timer ISR. Each action is pre-decoded into port masks and
+// a DAC code, so the ISR never converts units or branches on the pattern.
+#if defined(CONFIG_CHRONOS_STIM_PROGRAM_MAX_ENTRIES)
+#define STIM_PROGRAM_MAX_ENTRIES CONFIG_CHRONOS_STIM_PROGRAM_MAX_ENTRIES
+#else
+#define STIM_PROGRAM_MAX_ENTRIES 32
+#endif
+#define STIM_PROGRAM_PORTS 2
+
+typedef enum {
+    STIM_PROGRAM_DAC_NONE,
+    STIM_PROGRAM_DAC1,
+    STIM_PROGRAM_DAC2,
+} stim_program_dac;
+
+typedef struct {
+    uint32_t delta_ticks;       // after the previous entry; entry 0 after the last
+    uint32_t set_mask;          // pins of port driven high
+    uint32_t clr_mask;          // pins of port driven low
+    uint16_t dac_code;
+    uint8_t port;
+    uint8_t dac;                // stim_program_dac, written after the pins
+} stim_program_entry;
+
+typedef struct {
+    stim_program_entry entries[STIM_PROGRAM_MAX_ENTRIES];
+    uint16_t count;
+} stim_program;
+
+void stim_program_reset(stim_program *program);
+int stim_program_add(stim_program *program, const stim_program_entry *entry);
+int stim_program_build_biphasic(stim_program *program, uint32_t period_ticks,
+                                uint32_t pulse_width_ticks, uint32_t switch_ticks,
+                                uint16_t dac1_code, uint16_t dac2_code, uint32_t phase_pin,
+                                uint32_t switch0_pin, uint32_t switch1_pin);
+int stim_program_validate(const stim_program *program, uint32_t min_delta_ticks,
+                          const uint32_t allowed_pins[STIM_PROGRAM_PORTS]);
+uint64_t stim_program_period(const stim_program *program);
+
+#endif // STIM_PROGRAM_H
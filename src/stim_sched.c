@@ -0,0 +1,221 @@
+#include <zephyr/types.h>
+#include <errno.h>
+#include <string.h>
+#include "stim_sched.h"
+
+// Tick comparisons go through the signed difference so the queue keeps its
+// order across the 32-bit counter wrap.
+static bool tick_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+// Queue order: earliest deadline first, lower channel first on a tie.
+static bool edge_before(const stim_sched_edge *a, const stim_sched_edge *b) {
+    if (a->deadline != b->deadline) {
+        return tick_before(a->deadline, b->deadline);
+    }
+    return a->channel < b->channel;
+}
+
+static void queue_insert(stim_sched *sched, const stim_sched_edge *edge) {
+    uint8_t i = sched->queue_len++;
+
+    while ((i > 0) && edge_before(edge, &sched->queue[i - 1])) {
+        sched->queue[i] = sched->queue[i - 1];
+        i--;
+    }
+    sched->queue[i] = *edge;
+}
+
+static void queue_remove(stim_sched *sched, uint8_t index) {
+    sched->queue_len--;
+    memmove(&sched->queue[index], &sched->queue[index + 1],
+            (sched->queue_len - index) * sizeof(stim_sched_edge));
+}
+
+static void schedule(stim_sched *sched, uint8_t channel, stim_sched_phase phase,
+                     uint32_t tick) {
+    stim_sched_edge edge = {
+        .deadline = tick,
+        .nominal = tick,
+        .channel = channel,
+        .phase = phase,
+    };
+    queue_insert(sched, &edge);
+}
+
+// Queue the edge that follows the one just dispatched. Within a pulse the
+// edges follow the dispatched ones, so a shift moves the rest of the pulse
+// with it, and the anodic phase lasts as long as the cathodic one actually
+// did. Periods still start on the nominal tick, so the channel never drifts.
+static void schedule_next(stim_sched *sched, const stim_sched_edge *edge) {
+    stim_sched_channel *ch = &sched->channels[edge->channel];
+    const stim_sched_config *config = &ch->config;
+
+    switch (edge->phase) {
+        case STIM_PHASE_CATHODIC:
+            ch->pulse_start = edge->deadline;
+            schedule(sched, edge->channel, STIM_PHASE_INTERPHASE,
+                     edge->deadline + config->pulse_width_ticks);
+            break;
+        case STIM_PHASE_INTERPHASE:
+            ch->cathodic_ticks = edge->deadline - ch->pulse_start;
+            schedule(sched, edge->channel, STIM_PHASE_ANODIC,
+                     edge->deadline + config->interphase_ticks);
+            break;
+        case STIM_PHASE_ANODIC:
+            schedule(sched, edge->channel, STIM_PHASE_REST,
+                     edge->deadline + ch->cathodic_ticks);
+            break;
+        case STIM_PHASE_REST:
+            // Period boundary: the only place a new configuration starts
+            ch->period_start += config->period_ticks;
+            if (ch->has_next) {
+                ch->config = ch->next_config;
+                ch->has_next = false;
+            }
+            if (ch->config.period_ticks == 0) {
+                ch->running = false;
+                break;
+            }
+            schedule(sched, edge->channel, STIM_PHASE_CATHODIC, ch->period_start);
+            break;
+    }
+}
+
+void stim_sched_init(stim_sched *sched, uint32_t guard_ticks) {
+    memset(sched, 0, sizeof(*sched));
+    sched->guard_ticks = guard_ticks;
+}
+
+// Both phases and the interphase gap have to fit in one period.
+int stim_sched_validate(const stim_sched_config *config) {
+    if (config->period_ticks == 0) {
+        return 0;
+    }
+    if (config->pulse_width_ticks == 0) {
+        return -EINVAL;
+    }
+    uint64_t pulse_ticks = (2ULL * config->pulse_width_ticks) + config->interphase_ticks;
+    if (pulse_ticks >= config->period_ticks) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// A running channel switches at its next period boundary, an idle one starts
+// at now. A period of 0 stops the channel once its current pulse is over.
+int stim_sched_configure(stim_sched *sched, uint8_t channel,
+                         const stim_sched_config *config, uint32_t now) {
+    if (channel >= STIM_SCHED_MAX_CHANNELS) {
+        return -EINVAL;
+    }
+    int err = stim_sched_validate(config);
+    if (err) {
+        return err;
+    }
+
+    stim_sched_channel *ch = &sched->channels[channel];
+    if (ch->running) {
+        ch->next_config = *config;
+        ch->has_next = true;
+        return 0;
+    }
+    if (config->period_ticks == 0) {
+        return 0;
+    }
+    ch->config = *config;
+    ch->has_next = false;
+    ch->running = true;
+    ch->period_start = now;
+    schedule(sched, channel, STIM_PHASE_CATHODIC, now);
+    return 0;
+}
+
+// True if tick lies in [start, start + guard)
+static bool within_guard(const stim_sched *sched, uint32_t tick, uint32_t start) {
+    return !tick_before(tick, start) && tick_before(tick, start + sched->guard_ticks);
+}
+
+// Earliest tick the queue head may be dispatched at. The end of an anodic
+// phase is the one edge that cannot move without unbalancing its pulse, so
+// every other edge makes way for a queued one, and an anodic phase starts
+// late rather than end within a guard of another.
+static uint32_t head_due(const stim_sched *sched) {
+    const stim_sched_edge *head = &sched->queue[0];
+    uint32_t cathodic_ticks = sched->channels[head->channel].cathodic_ticks;
+    uint32_t due = head->deadline;
+    bool moved;
+
+    if (sched->dispatched && tick_before(due, sched->last_dispatch + sched->guard_ticks)) {
+        due = sched->last_dispatch + sched->guard_ticks;
+    }
+    if (head->phase == STIM_PHASE_REST) {
+        return due;
+    }
+    do {
+        moved = false;
+        for (uint8_t i = 1; i < sched->queue_len; i++) {
+            uint32_t rest = sched->queue[i].deadline;
+
+            if (sched->queue[i].phase != STIM_PHASE_REST) {
+                continue;
+            }
+            if (within_guard(sched, rest, due)) {
+                due = rest + sched->guard_ticks;
+                moved = true;
+            } else if ((head->phase == STIM_PHASE_ANODIC) &&
+                       (within_guard(sched, rest, due + cathodic_ticks) ||
+                        within_guard(sched, due + cathodic_ticks, rest))) {
+                due = rest + sched->guard_ticks - cathodic_ticks;
+                moved = true;
+            }
+        }
+    } while (moved);
+    return due;
+}
+
+// Deadline of the next edge. Edges closer than guard_ticks to the last
+// dispatched one (one DAC transaction), or to the end of another channel's
+// pulse, are collisions: they are pushed back and keep the queue order, so
+// the channel that was first, or the lower channel on an exact tie, always
+// goes first.
+bool stim_sched_peek(stim_sched *sched, uint32_t *deadline) {
+    if (sched->queue_len == 0) {
+        return false;
+    }
+
+    stim_sched_edge *head = &sched->queue[0];
+    uint32_t due;
+    while ((due = head_due(sched)) != head->deadline) {
+        stim_sched_edge shifted = *head;
+
+        shifted.deadline = due;
+        sched->collisions++;
+        sched->channels[shifted.channel].collisions++;
+        queue_remove(sched, 0);
+        queue_insert(sched, &shifted);
+    }
+    if (deadline != NULL) {
+        *deadline = head->deadline;
+    }
+    return true;
+}
+
+bool stim_sched_pop(stim_sched *sched, stim_sched_edge *edge) {
+    if (!stim_sched_peek(sched, NULL)) {
+        return false;
+    }
+
+    *edge = sched->queue[0];
+    queue_remove(sched, 0);
+    sched->last_dispatch = edge->deadline;
+    sched->dispatched = true;
+    schedule_next(sched, edge);
+    if (sched->queue_len == 0) {
+        // Nothing left to space against; a stale tick would break the
+        // signed comparisons once the counter has wrapped far enough
+        sched->dispatched = false;
+    }
+    return true;
+}
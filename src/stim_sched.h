@@ -0,0 +1,65 @@
+#ifndef STIM_SCHED_H
+#define STIM_SCHED_H
+
+#include <zephyr/types.h>
+
+// Multi-channel stimulation scheduler: every logical channel runs its own
+// biphasic train on one free-running timer. The edges of all channels sit in
+// a queue sorted by deadline, one pending edge per running channel, and the
+// timer is always armed for the head of the queue.
+#if defined(CONFIG_CHRONOS_MULTICHANNEL_COUNT)
+#define STIM_SCHED_MAX_CHANNELS CONFIG_CHRONOS_MULTICHANNEL_COUNT
+#else
+#define STIM_SCHED_MAX_CHANNELS 8
+#endif
+
+typedef enum {
+    STIM_PHASE_CATHODIC,        // DAC to amplitude, phase pin on
+    STIM_PHASE_INTERPHASE,      // phase pin off
+    STIM_PHASE_ANODIC,          // DAC to the opposite code, phase pin on
+    STIM_PHASE_REST,            // phase pin off until the next period
+} stim_sched_phase;
+
+typedef struct {
+    uint32_t period_ticks;      // 0 stops the channel
+    uint32_t pulse_width_ticks;
+    uint32_t interphase_ticks;
+    uint16_t amplitude;
+} stim_sched_config;
+
+typedef struct {
+    uint32_t deadline;          // dispatch tick, after collision shifts
+    uint32_t nominal;           // tick it was scheduled for
+    uint8_t channel;
+    uint8_t phase;              // stim_sched_phase
+} stim_sched_edge;
+
+typedef struct {
+    stim_sched_config config;
+    stim_sched_config next_config;  // takes over at the next period
+    bool has_next;
+    bool running;
+    uint32_t period_start;
+    uint32_t pulse_start;       // dispatched cathodic edge of the current pulse
+    uint32_t cathodic_ticks;    // its dispatched width, repeated by the anodic phase
+    uint32_t collisions;
+} stim_sched_channel;
+
+typedef struct {
+    stim_sched_channel channels[STIM_SCHED_MAX_CHANNELS];
+    stim_sched_edge queue[STIM_SCHED_MAX_CHANNELS];
+    uint8_t queue_len;
+    uint32_t guard_ticks;       // minimum spacing of two dispatched edges
+    uint32_t last_dispatch;
+    bool dispatched;            // last_dispatch is valid
+    uint32_t collisions;
+} stim_sched;
+
+void stim_sched_init(stim_sched *sched, uint32_t guard_ticks);
+int stim_sched_validate(const stim_sched_config *config);
+int stim_sched_configure(stim_sched *sched, uint8_t channel,
+                         const stim_sched_config *config, uint32_t now);
+bool stim_sched_peek(stim_sched *sched, uint32_t *deadline);
+bool stim_sched_pop(stim_sched *sched, stim_sched_edge *edge);
+
+#endif // STIM_SCHED_H
@@ -0,0 +1,171 @@
+#include <zephyr/types.h>
+#include <errno.h>
+#include <string.h>
+#include "stim_seq.h"
+#include "stim_hal.h"
+
+static bool task_equal(const stim_seq_task *a, const stim_seq_task *b) {
+    return (a->type == b->type) && (a->pin == b->pin);
+}
+
+void stim_seq_reset(stim_seq_table *table) {
+    memset(table, 0, sizeof(*table));
+}
+
+int stim_seq_add(stim_seq_table *table, stim_seq_event event,
+                 stim_seq_task_type type, uint32_t pin) {
+    if (event >= STIM_EVT_COUNT) {
+        return -EINVAL;
+    }
+    if (table->link_count >= STIM_SEQ_MAX_LINKS) {
+        return -ENOMEM;
+    }
+
+    stim_seq_link *link = &table->links[table->link_count++];
+    link->event = event;
+    link->task.type = type;
+    link->task.pin = stim_seq_is_pin_task(type) ? pin : 0;
+    return 0;
+}
+
+// Same shape as the software path in timer_handler:
+// EVENT0/EVENT2 switch the phase pin on, EVENT1/EVENT3 switch it off and
+// switch on the two switch pins.
+int stim_seq_add_biphasic(stim_seq_table *table, uint32_t phase_pin,
+                          uint32_t switch0_pin, uint32_t switch1_pin) {
+    static const stim_seq_event on_events[] = {STIM_EVT_COMPARE0, STIM_EVT_COMPARE2};
+    static const stim_seq_event off_events[] = {STIM_EVT_COMPARE1, STIM_EVT_COMPARE3};
+    int err = 0;
+
+    for (size_t i = 0; (i < 2) && !err; i++) {
+        err = stim_seq_add(table, on_events[i], STIM_TASK_PIN_SET, phase_pin);
+    }
+    for (size_t i = 0; (i < 2) && !err; i++) {
+        err = stim_seq_add(table, off_events[i], STIM_TASK_PIN_CLR, phase_pin);
+        if (!err) {
+            err = stim_seq_add(table, off_events[i], STIM_TASK_PIN_SET, switch0_pin);
+        }
+        if (!err) {
+            err = stim_seq_add(table, off_events[i], STIM_TASK_PIN_SET, switch1_pin);
+        }
+    }
+    return err;
+}
+
+// DAC writes without the CPU. COMPARE0/COMPARE2 start the transfer held in
+// the SPIM, COMPARE4/COMPARE5 fire on the same ticks (the timer mirrors CC0
+// into CC4 and CC2 into CC5) and pull the matching chip select low, and the
+// SPIM END event releases both chip selects.
+int stim_seq_add_dac(stim_seq_table *table, uint32_t dac1_cs_pin, uint32_t dac2_cs_pin) {
+    int err = stim_seq_add(table, STIM_EVT_COMPARE0, STIM_TASK_SPIM_START, 0);
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_COMPARE2, STIM_TASK_SPIM_START, 0);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_COMPARE4, STIM_TASK_PIN_CLR, dac1_cs_pin);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_COMPARE5, STIM_TASK_PIN_CLR, dac2_cs_pin);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_SPIM_END, STIM_TASK_PIN_SET, dac1_cs_pin);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_SPIM_END, STIM_TASK_PIN_SET, dac2_cs_pin);
+    }
+    return err;
+}
+
+// Waveform playback. COMPARE5 mirrors CC0 and starts the sample timer at the
+// start of the pulse, every sample tick selects the DAC and starts the next
+// list entry, SPIM END latches it, and COMPARE4 stops and rewinds the sample
+// timer once the last sample has gone out.
+int stim_seq_add_waveform(stim_seq_table *table, uint32_t dac_cs_pin) {
+    int err = stim_seq_add(table, STIM_EVT_COMPARE5, STIM_TASK_SAMPLE_START, 0);
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_COMPARE4, STIM_TASK_SAMPLE_STOP, 0);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_COMPARE4, STIM_TASK_SAMPLE_CLEAR, 0);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_SAMPLE, STIM_TASK_PIN_CLR, dac_cs_pin);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_SAMPLE, STIM_TASK_SPIM_START, 0);
+    }
+    if (!err) {
+        err = stim_seq_add(table, STIM_EVT_SPIM_END, STIM_TASK_PIN_SET, dac_cs_pin);
+    }
+    return err;
+}
+
+// Group the links into channels. On DPPI an event publishes to exactly one
+// channel and a task subscribes to exactly one, so every distinct task gets
+// the set of events that drive it, and tasks sharing an identical event set
+// share a channel. Two channels with overlapping event sets cannot be wired.
+int stim_seq_compile(stim_seq_table *table) {
+    stim_seq_task tasks[STIM_SEQ_MAX_LINKS];
+    uint8_t masks[STIM_SEQ_MAX_LINKS];
+    size_t task_count = 0;
+
+    for (size_t i = 0; i < table->link_count; i++) {
+        const stim_seq_link *link = &table->links[i];
+        size_t t;
+
+        for (t = 0; t < task_count; t++) {
+            if (task_equal(&tasks[t], &link->task)) {
+                break;
+            }
+        }
+        if (t == task_count) {
+            tasks[t] = link->task;
+            masks[t] = 0;
+            task_count++;
+        }
+        masks[t] |= (uint8_t)(1U << link->event);
+    }
+
+    table->channel_count = 0;
+    for (size_t t = 0; t < task_count; t++) {
+        stim_seq_channel *channel = NULL;
+
+        for (size_t c = 0; c < table->channel_count; c++) {
+            if (table->channels[c].event_mask == masks[t]) {
+                channel = &table->channels[c];
+                break;
+            }
+            if (table->channels[c].event_mask & masks[t]) {
+                return -EINVAL;
+            }
+        }
+        if (channel == NULL) {
+            if (table->channel_count >= STIM_SEQ_MAX_CHANNELS) {
+                return -ENOMEM;
+            }
+            channel = &table->channels[table->channel_count++];
+            channel->event_mask = masks[t];
+            channel->task_count = 0;
+        }
+        if (channel->task_count >= STIM_SEQ_MAX_TASKS) {
+            return -ENOMEM;
+        }
+        channel->tasks[channel->task_count++] = tasks[t];
+    }
+    return 0;
+}
+
+int stim_seq_apply(const stim_seq_table *table) {
+    stim_hal_disconnect_all();
+
+    for (size_t c = 0; c < table->channel_count; c++) {
+        const stim_seq_channel *channel = &table->channels[c];
+        int err = stim_hal_connect(channel->event_mask, channel->tasks,
+                                   channel->task_count);
+        if (err) {
+            stim_hal_disconnect_all();
+            return err;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#ifndef STIM_SEQ_H
+#define STIM_SEQ_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+
+// Hardware pulse sequencer: a table of (event -> task) links that is compiled
+// into (D)PPI channels, so pin edges happen without the CPU.
+#define STIM_SEQ_MAX_LINKS      16
+#define STIM_SEQ_MAX_CHANNELS   8
+#define STIM_SEQ_MAX_TASKS      6   // tasks subscribed to one channel
+
+typedef enum {
+    STIM_EVT_COMPARE0 = 0,      // TIMER0 COMPARE[n] is STIM_EVT_COMPARE0 + n
+    STIM_EVT_COMPARE1,
+    STIM_EVT_COMPARE2,
+    STIM_EVT_COMPARE3,
+    STIM_EVT_COMPARE4,
+    STIM_EVT_COMPARE5,
+    STIM_EVT_SPIM_END,          // DAC SPIM transaction finished
+    STIM_EVT_SAMPLE,            // waveform sample timer tick
+    STIM_EVT_COUNT
+} stim_seq_event;
+
+typedef enum {
+    STIM_TASK_PIN_SET,
+    STIM_TASK_PIN_CLR,
+    STIM_TASK_PIN_TOGGLE,
+    STIM_TASK_SPIM_START,       // start the transfer held in the DAC SPIM
+    STIM_TASK_SAMPLE_START,     // waveform sample timer
+    STIM_TASK_SAMPLE_STOP,
+    STIM_TASK_SAMPLE_CLEAR,
+} stim_seq_task_type;
+
+typedef struct {
+    stim_seq_task_type type;
+    uint32_t pin;               // pin tasks only, 0 otherwise
+} stim_seq_task;
+
+static inline bool stim_seq_is_pin_task(stim_seq_task_type type) {
+    return type <= STIM_TASK_PIN_TOGGLE;
+}
+
+typedef struct {
+    stim_seq_event event;
+    stim_seq_task task;
+} stim_seq_link;
+
+// One (D)PPI channel: every event in event_mask publishes to it and every
+// task in tasks subscribes to it.
+typedef struct {
+    uint8_t event_mask;
+    uint8_t task_count;
+    stim_seq_task tasks[STIM_SEQ_MAX_TASKS];
+} stim_seq_channel;
+
+typedef struct {
+    stim_seq_link links[STIM_SEQ_MAX_LINKS];
+    size_t link_count;
+    stim_seq_channel channels[STIM_SEQ_MAX_CHANNELS];
+    size_t channel_count;
+} stim_seq_table;
+
+void stim_seq_reset(stim_seq_table *table);
+int stim_seq_add(stim_seq_table *table, stim_seq_event event,
+                 stim_seq_task_type type, uint32_t pin);
+int stim_seq_add_biphasic(stim_seq_table *table, uint32_t phase_pin,
+                          uint32_t switch0_pin, uint32_t switch1_pin);
+int stim_seq_add_dac(stim_seq_table *table, uint32_t dac1_cs_pin, uint32_t dac2_cs_pin);
+int stim_seq_add_waveform(stim_seq_table *table, uint32_t dac_cs_pin);
+int stim_seq_compile(stim_seq_table *table);
+int stim_seq_apply(const stim_seq_table *table);
+
+#endif // STIM_SEQ_H
@@ -0,0 +1,279 @@
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <bluetooth/services/nus.h>
+#include <cmsis_core.h>
+#include <stdio.h>
+#include "telemetry.h"
+#include "timer.h"
+#include "config.h"
+
+#define TELEMETRY_DEPTH CONFIG_CHRONOS_TELEMETRY_DEPTH
+#define TELEMETRY_FRAME_RECORDS ((TELEMETRY_FRAME_MAX - TELEMETRY_HEADER_LEN) / TELEMETRY_RECORD_LEN)
+BUILD_ASSERT((TELEMETRY_DEPTH & (TELEMETRY_DEPTH - 1)) == 0,
+             "CONFIG_CHRONOS_TELEMETRY_DEPTH must be a power of two");
+
+typedef struct {
+    uint32_t seq;               // ring position + 1 once the record is complete
+    telemetry_record record;
+} telemetry_slot;
+
+// Same reservation scheme as the event log: writers claim ring_head by CAS,
+// only the telemetry thread moves ring_tail, and it does so only after the
+// frame holding the records has been accepted by the stack.
+static telemetry_slot ring[TELEMETRY_DEPTH];
+static atomic_t ring_head;
+static atomic_t ring_tail;
+
+static atomic_t streaming;
+static atomic_t frame_payload;      // usable notification length, 0 when disconnected
+static atomic_t sent_records;
+static atomic_t sent_frames;
+static atomic_t dropped;
+
+static K_SEM_DEFINE(tx_credits, 0, CONFIG_CHRONOS_TELEMETRY_TX_CREDITS);
+// Reference for the link setup work, owned by whoever clears it: the work
+// handler, a reconnect or the disconnect
+static atomic_ptr_t link_conn;
+static const struct bt_gatt_attr *nus_tx_attr;
+
+void telemetry_write(telemetry_type type, uint8_t index, uint32_t value0, uint32_t value1) {
+    telemetry_write_at(DWT->CYCCNT, type, index, value0, value1);
+}
+
+void telemetry_write_at(uint32_t timestamp, telemetry_type type, uint8_t index,
+                        uint32_t value0, uint32_t value1) {
+    atomic_val_t head;
+
+    if (!atomic_get(&streaming)) {
+        return;
+    }
+    do {
+        head = atomic_get(&ring_head);
+        if ((head - atomic_get(&ring_tail)) >= TELEMETRY_DEPTH) {
+            atomic_inc(&dropped);
+            return;
+        }
+    } while (!atomic_cas(&ring_head, head, head + 1));
+
+    telemetry_slot *slot = &ring[head & (TELEMETRY_DEPTH - 1)];
+    slot->record.timestamp = timestamp;
+    slot->record.type = type;
+    slot->record.index = index;
+    slot->record.reserved = 0;
+    slot->record.value[0] = value0;
+    slot->record.value[1] = value1;
+    __DMB();
+    slot->seq = (uint32_t)head + 1;
+}
+
+void telemetry_enable(bool enable) {
+    atomic_set(&streaming, enable);
+    printf("Telemetry %s\n", enable ? "enabled" : "disabled");
+}
+
+// Whichever side started the exchange; phones usually do it themselves
+static void mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx) {
+    ARG_UNUSED(conn);
+    ARG_UNUSED(rx);
+    // Notification header is 3 bytes
+    atomic_set(&frame_payload, MIN(tx - 3, TELEMETRY_FRAME_MAX));
+    printf("Telemetry frames up to %ld bytes\n", atomic_get(&frame_payload));
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+    .att_mtu_updated = mtu_updated,
+};
+
+// The result arrives through mtu_updated
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+                          struct bt_gatt_exchange_params *params) {
+    ARG_UNUSED(conn);
+    ARG_UNUSED(params);
+    if (err) {
+        printf("Telemetry MTU exchange failed (err %u)\n", err);
+    }
+}
+
+// 2M PHY, longest data length and largest MTU the central accepts, so a
+// frame of TELEMETRY_FRAME_MAX bytes goes out in one link layer packet
+static void link_work_handler(struct k_work *work) {
+    static struct bt_gatt_exchange_params exchange_params = {.func = mtu_exchanged};
+    ARG_UNUSED(work);
+    struct bt_conn *conn = atomic_ptr_clear(&link_conn);
+    int err;
+
+    if (!conn) {
+        return;     // disconnected before the work ran
+    }
+    err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (err) {
+        printf("Telemetry PHY update failed (err %d)\n", err);
+    }
+    err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (err) {
+        printf("Telemetry data length update failed (err %d)\n", err);
+    }
+    err = bt_gatt_exchange_mtu(conn, &exchange_params);
+    if (err) {
+        printf("Telemetry MTU exchange failed (err %d)\n", err);
+    }
+    bt_conn_unref(conn);
+}
+
+static K_WORK_DEFINE(link_work, link_work_handler);
+
+void telemetry_init(void) {
+    bt_gatt_cb_register(&gatt_callbacks);
+    nus_tx_attr = bt_gatt_find_by_uuid(NULL, 0, BT_UUID_NUS_TX);
+}
+
+void telemetry_connected(struct bt_conn *conn) {
+    // Default ATT MTU until an exchange completes
+    atomic_set(&frame_payload, bt_gatt_get_mtu(conn) - 3);
+    k_sem_reset(&tx_credits);
+    for (int i = 0; i < CONFIG_CHRONOS_TELEMETRY_TX_CREDITS; i++) {
+        k_sem_give(&tx_credits);
+    }
+    // A reconnect before the work ran takes over the earlier link's
+    // reference; submitting pending work does not run it twice
+    struct bt_conn *stale = atomic_ptr_set(&link_conn, bt_conn_ref(conn));
+    if (stale) {
+        bt_conn_unref(stale);
+    }
+    k_work_submit(&link_work);
+}
+
+void telemetry_disconnected(void) {
+    atomic_set(&frame_payload, 0);
+    atomic_set(&streaming, false);
+    k_work_cancel(&link_work);
+    struct bt_conn *conn = atomic_ptr_clear(&link_conn);
+    if (conn) {
+        bt_conn_unref(conn);
+    }
+}
+
+// Completion of a frame sent by notify_frame. The UART bridge notifications
+// on the same characteristic complete through NUS, so only telemetry frames
+// return credits.
+static void frame_sent(struct bt_conn *conn, void *user_data) {
+    ARG_UNUSED(conn);
+    ARG_UNUSED(user_data);
+    k_sem_give(&tx_credits);
+}
+
+// bt_nus_send without its shared sent callback; returns the credit on error
+static int notify_frame(const uint8_t *frame, uint16_t len) {
+    struct bt_gatt_notify_params params = {
+        .attr = nus_tx_attr,
+        .data = frame,
+        .len = len,
+        .func = frame_sent,
+    };
+    int err = (nus_tx_attr != NULL) ? bt_gatt_notify_cb(NULL, &params) : -ENOENT;
+
+    if (err) {
+        k_sem_give(&tx_credits);
+    }
+    return err;
+}
+
+void get_telemetry_stats(telemetry_stats *stats) {
+    stats->records = atomic_get(&sent_records);
+    stats->frames = atomic_get(&sent_frames);
+    stats->dropped = atomic_get(&dropped);
+}
+
+int telemetry_send(const uint8_t *frame, uint16_t len, k_timeout_t timeout) {
+    uint16_t payload = atomic_get(&frame_payload);
+
+    if (payload == 0) {
+        return -ENOTCONN;
+    }
+    if (len > payload) {
+        return -EMSGSIZE;
+    }
+    if (k_sem_take(&tx_credits, timeout)) {
+        return -EAGAIN;
+    }
+    return notify_frame(frame, len);
+}
+
+// Copy up to max complete records from the tail without consuming them
+static size_t ring_peek(telemetry_record *records, size_t max) {
+    atomic_val_t tail = atomic_get(&ring_tail);
+    size_t count = 0;
+
+    while (count < max) {
+        const telemetry_slot *slot = &ring[(tail + count) & (TELEMETRY_DEPTH - 1)];
+        if (slot->seq != (uint32_t)(tail + count) + 1) {
+            break;
+        }
+        __DMB();
+        records[count++] = slot->record;
+    }
+    return count;
+}
+
+static void write_jitter(void) {
+    jitter_snapshot jitter;
+
+    get_jitter_snapshot(&jitter);
+    for (uint8_t i = 0; i < JITTER_EVENT_COUNT; i++) {
+        telemetry_write(TELEMETRY_JITTER, i, jitter.events[i].p99, jitter.events[i].max);
+    }
+}
+
+static void telemetry_thread(void) {
+    static uint8_t frame[TELEMETRY_FRAME_MAX];
+    static telemetry_record records[TELEMETRY_FRAME_RECORDS];
+    uint16_t frame_seq = 0;
+    int64_t next_stats = 0;
+    bool flush = false;
+
+    for (;;) {
+        uint16_t payload = atomic_get(&frame_payload);
+
+        if (!atomic_get(&streaming) || (payload == 0)) {
+            k_msleep(CONFIG_CHRONOS_TELEMETRY_FLUSH_MS);
+            continue;
+        }
+        if ((MEASURE_TIMER == 1) && (k_uptime_get() >= next_stats)) {
+            next_stats = k_uptime_get() + CONFIG_CHRONOS_TELEMETRY_STATS_MS;
+            write_jitter();
+        }
+
+        // Full frames go out at once, partial ones after one flush interval
+        size_t capacity = telemetry_frame_capacity(payload);
+        size_t count = ring_peek(records, capacity);
+        if ((count < capacity) && !flush) {
+            flush = true;
+            k_msleep(CONFIG_CHRONOS_TELEMETRY_FLUSH_MS);
+            continue;
+        }
+        flush = false;
+        if (count == 0) {
+            continue;
+        }
+        // Link busy: the records stay queued
+        if (k_sem_take(&tx_credits, K_MSEC(CONFIG_CHRONOS_TELEMETRY_FLUSH_MS))) {
+            continue;
+        }
+
+        size_t len = telemetry_frame_pack(frame, sizeof(frame), frame_seq, records, count);
+        int err = notify_frame(frame, len);
+        if (err) {
+            k_msleep(CONFIG_CHRONOS_TELEMETRY_FLUSH_MS);
+            continue;
+        }
+        atomic_add(&ring_tail, count);
+        atomic_add(&sent_records, count);
+        atomic_inc(&sent_frames);
+        frame_seq++;
+    }
+}
+
+K_THREAD_DEFINE(telemetry_thread_id, CONFIG_CHRONOS_TELEMETRY_STACK_SIZE, telemetry_thread,
+                NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO - 1, 0, 0);
@@ -0,0 +1,39 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <zephyr/types.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include "telemetry_frame.h"
+
+// Binary telemetry over NUS notifications. Records are queued from any
+// context, including the timer ISR, and the telemetry thread packs them into
+// frames as large as the negotiated MTU allows. Only TX credits returned by
+// the completion of an earlier frame allow a new one, so records wait in the ring while
+// the link is busy instead of being dropped by the stack.
+typedef struct {
+    uint32_t records;       // records sent
+    uint32_t frames;        // notifications sent
+    uint32_t dropped;       // records lost to a full ring
+} telemetry_stats;
+
+// Any context; a no-op unless the host enabled streaming
+void telemetry_write(telemetry_type type, uint8_t index, uint32_t value0, uint32_t value1);
+// Same, for an event stamped earlier on the DWT cycle counter
+void telemetry_write_at(uint32_t timestamp, telemetry_type type, uint8_t index,
+                        uint32_t value0, uint32_t value1);
+// Host opt-in, reset on every disconnect
+void telemetry_enable(bool enable);
+// A frame of another kind, paced by the same TX credits; -ENOTCONN without
+// a link, -EMSGSIZE beyond the MTU, -EAGAIN if no credit came within timeout
+int telemetry_send(const uint8_t *frame, uint16_t len, k_timeout_t timeout);
+
+// After bt_nus_init: frames are notified on the NUS TX characteristic
+void telemetry_init(void);
+// Bluetooth callbacks
+void telemetry_connected(struct bt_conn *conn);
+void telemetry_disconnected(void);
+
+void get_telemetry_stats(telemetry_stats *stats);
+
+#endif // TELEMETRY_H
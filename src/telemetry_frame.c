@@ -0,0 +1,36 @@
+#include <zephyr/types.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include "telemetry_frame.h"
+
+size_t telemetry_frame_capacity(uint16_t payload_len) {
+    size_t len = MIN(payload_len, TELEMETRY_FRAME_MAX);
+
+    if (len < TELEMETRY_HEADER_LEN + TELEMETRY_RECORD_LEN) {
+        return 0;
+    }
+    return MIN((len - TELEMETRY_HEADER_LEN) / TELEMETRY_RECORD_LEN, UINT8_MAX);
+}
+
+size_t telemetry_frame_pack(uint8_t *frame, size_t frame_len, uint16_t frame_seq,
+                            const telemetry_record *records, size_t count) {
+    size_t len = TELEMETRY_HEADER_LEN + count * TELEMETRY_RECORD_LEN;
+
+    if ((count == 0) || (count > UINT8_MAX) || (len > frame_len)) {
+        return 0;
+    }
+    frame[0] = TELEMETRY_MAGIC;
+    frame[1] = (uint8_t)count;
+    sys_put_le16(frame_seq, &frame[2]);
+
+    uint8_t *out = &frame[TELEMETRY_HEADER_LEN];
+    for (size_t i = 0; i < count; i++, out += TELEMETRY_RECORD_LEN) {
+        sys_put_le32(records[i].timestamp, &out[0]);
+        out[4] = records[i].type;
+        out[5] = records[i].index;
+        sys_put_le16(records[i].reserved, &out[6]);
+        sys_put_le32(records[i].value[0], &out[8]);
+        sys_put_le32(records[i].value[1], &out[12]);
+    }
+    return len;
+}
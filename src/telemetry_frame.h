@@ -0,0 +1,46 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <zephyr/types.h>
+
+// Binary telemetry notification: a 4-byte header followed by fixed 16-byte
+// records, all little endian. Frames are told apart from the UART bridge
+// text on the same NUS characteristic by the magic byte.
+//
+//   header: u8 magic, u8 record_count, u16 frame_seq
+//   record: u32 timestamp, u8 type, u8 index, u16 reserved, u32 value[2]
+#define TELEMETRY_MAGIC 0xC8
+#define TELEMETRY_HEADER_LEN 4
+#define TELEMETRY_RECORD_LEN 16
+#define TELEMETRY_FRAME_MAX 244     // ATT MTU 247 less the notification header
+
+typedef enum {
+    TELEMETRY_PULSE = 1,        // value: pulse count, DAC1 code << 16 | DAC2 code
+    TELEMETRY_JITTER = 2,       // index: compare event, value: p99, max (ticks)
+    TELEMETRY_CHARGE = 3,       // index: CHARGE_ALERT_* flags, value: cathodic, anodic charge
+    TELEMETRY_BURST = 4,        // value: burst number, pulses delivered
+    TELEMETRY_LATENCY = 5,      // index: latency_stage, value: command seq, see below
+} telemetry_type;
+
+// Stages of a timed settings command, one record each, stamped when reached
+typedef enum {
+    LATENCY_RX = 0,             // BLE write received; value1: host time (us) it carried
+    LATENCY_APPLY = 1,          // setting committed to the stimulation engine
+    LATENCY_PULSE = 2,          // first pulse on it, DAC written; value1: pulse count
+} latency_stage;
+
+typedef struct {
+    uint32_t timestamp;         // CPU cycles (DWT CYCCNT)
+    uint8_t type;               // telemetry_type
+    uint8_t index;
+    uint16_t reserved;
+    uint32_t value[2];
+} telemetry_record;
+
+// Records that fit in a notification of payload_len bytes
+size_t telemetry_frame_capacity(uint16_t payload_len);
+// Returns the frame length, or 0 if frame_len cannot hold the records
+size_t telemetry_frame_pack(uint8_t *frame, size_t frame_len, uint16_t frame_seq,
+                            const telemetry_record *records, size_t count);
+
+#endif // TELEMETRY_FRAME_H
@@ -4,6 +4,68 @@
 #include "timer.h"
 #include "spi.h"
 #include "config.h"
+#include "evlog.h"
+#include "jitter_hist.h"
+#include "boot_stages.h"
+#if defined(CONFIG_CHRONOS_STIM_HW_SEQ)
+#include "stim_seq.h"
+#endif
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+#include "waveform.h"
+#endif
+#if defined(CONFIG_CHRONOS_MULTICHANNEL)
+#include "stim_sched.h"
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROGRAM)
+#include "program_engine.h"
+#endif
+#if defined(CONFIG_CHRONOS_EDGE_CAPTURE)
+#include "edge_capture.h"
+#endif
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+#include "telemetry.h"
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+#include "stim_profile.h"
+#endif
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+#include "low_power.h"
+#endif
+#if defined(CONFIG_CHRONOS_CHARGE_MONITOR)
+#include "charge_monitor.h"
+#endif
+#if defined(CONFIG_CHRONOS_BURST)
+#include "burst_gate.h"
+#endif
+
+// With the hardware sequencer the pin edges of EVENT1/EVENT3 need no CPU, so
+// their interrupts are only kept when the measurement path wants them.
+#define EDGE_IRQ_ENABLED ((MEASURE_TIMER == 1) || !IS_ENABLED(CONFIG_CHRONOS_STIM_HW_SEQ))
+// The DAC transfers are written from the ISR unless DPPI or the waveform
+// engine starts them, in which case EVENT2 needs no interrupt either. EVENT3
+// stays enabled in DPPI mode to re-arm the SPIM for the next period, and
+// with the burst gate, which re-arms a continuous train after a pulse.
+#define DAC_ISR_WRITES (!IS_ENABLED(CONFIG_CHRONOS_DAC_DPPI) && !IS_ENABLED(CONFIG_CHRONOS_WAVEFORM))
+// The SPIM4 DAC pair takes both codes at EVENT0, leaving nothing to write at
+// EVENT2
+#define DAC2_ISR_WRITES (DAC_ISR_WRITES && !IS_ENABLED(CONFIG_CHRONOS_DAC_PAIR))
+#define DAC_IRQ_ENABLED (EDGE_IRQ_ENABLED || DAC2_ISR_WRITES)
+#define EVENT3_IRQ_ENABLED (EDGE_IRQ_ENABLED || IS_ENABLED(CONFIG_CHRONOS_DAC_DPPI) || \
+                            IS_ENABLED(CONFIG_CHRONOS_BURST))
+
+// The DPPI DAC path and the waveform engine both use CC4/CC5, so CC4 is no
+// longer free for the software measurement captures.
+BUILD_ASSERT(!((IS_ENABLED(CONFIG_CHRONOS_DAC_DPPI) || IS_ENABLED(CONFIG_CHRONOS_WAVEFORM)) &&
+               (MEASURE_TIMER == 1)),
+             "MEASURE_TIMER needs TIMER0 CC4, which the DPPI DAC modes use");
+BUILD_ASSERT(!((IS_ENABLED(CONFIG_CHRONOS_MULTICHANNEL) || IS_ENABLED(CONFIG_CHRONOS_STIM_PROGRAM)) &&
+               (MEASURE_TIMER == 1)),
+             "MEASURE_TIMER expects the single-channel CC0..CC3 layout");
+// irq_lock() does not mask a zero-latency interrupt, so the atomics shared
+// with the ISR must be lock-free instructions
+BUILD_ASSERT(!IS_ENABLED(CONFIG_CHRONOS_STIM_IRQ_ZLI) ||
+             IS_ENABLED(CONFIG_ATOMIC_OPERATIONS_BUILTIN),
+             "The zero-latency timer interrupt needs CONFIG_ATOMIC_OPERATIONS_BUILTIN");
 
 static uint32_t timer_freq_hz = 0;  
 static uint32_t main_event_time = 0;
@@ -12,29 +74,316 @@ static uint32_t event2_time = 0;
 static uint32_t event3_time = 0;
 
 static atomic_t counter;            // test variable to record how many times the timer handler has been called 
-static atomic_t error;
-static atomic_t event1_error_max;
-static atomic_t event2_error_max;
-static atomic_t event3_error_max;
-static atomic_t event0_error_counter;
-static atomic_t event0_error_max;
+// Timing error of each compare event against its nominal interval
+static jitter_hist event_jitter[JITTER_EVENT_COUNT];
 static uint32_t prev_main_event_time = 0;
+static atomic_t pulse_count;        // EVENT0 interrupts, single-channel mode
 static nrfx_timer_t measurement_timer = NRFX_TIMER_INSTANCE(1); // Use a separate timer for measurements
 static nrfx_timer_t timer_inst = NRFX_TIMER_INSTANCE(TIMER_INST_IDX);; // Timer instance for the main timer
 static uint32_t current_period_us = DEFAULT_STIM_PERIOD;
 static uint32_t current_pulse_width_us = DEFAULT_PULSE_WIDTH;
 static void timer_handler(nrf_timer_event_t event_type, void * p_context);
 
-void get_error_data(error_data *data) {
-    data->event1_max = atomic_get(&event1_error_max);
-    data->event2_max = atomic_get(&event2_error_max);
-    data->event3_max = atomic_get(&event3_error_max);
-    data->event0_error = atomic_get(&event0_error_counter);
-    data->event0_max = atomic_get(&event0_error_max);
-    data->myerror = atomic_get(&error);
-    data->mycounter = atomic_get(&counter);
+typedef struct {
+    uint32_t period_ticks;
+    uint32_t event1_ticks;
+    uint32_t event2_ticks;
+    uint32_t event3_ticks;
+    uint16_t dac1_code;
+    uint16_t dac2_code;
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+    uint32_t stop_ticks;        // TIMER0 stops here, and HFCLK with it
+    uint32_t rtc_ticks;         // 0: continuous train
+#endif
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+    uint32_t probe;             // timed setting: command seq + 1, reported once
+#endif
+} stim_params;
+
+#if defined(CONFIG_CHRONOS_STIM_HW_SEQ)
+static stim_seq_table seq_table;
+
+static void hw_seq_init(void) {
+    stim_seq_reset(&seq_table);
+    int err = stim_seq_add_biphasic(&seq_table, NRF_GPIO_PIN_MAP(1, 3),
+                                    NRF_GPIO_PIN_MAP(1, 0), NRF_GPIO_PIN_MAP(1, 1));
+    if (!err && IS_ENABLED(CONFIG_CHRONOS_DAC_DPPI)) {
+        err = stim_seq_add_dac(&seq_table, NRF_GPIO_PIN_MAP(0, DAC1_CS_PIN),
+                               NRF_GPIO_PIN_MAP(0, DAC2_CS_PIN));
+    }
+    if (!err && IS_ENABLED(CONFIG_CHRONOS_WAVEFORM)) {
+        err = stim_seq_add_waveform(&seq_table, NRF_GPIO_PIN_MAP(0, DAC1_CS_PIN));
+    }
+    if (!err) {
+        err = stim_seq_compile(&seq_table);
+    }
+    if (!err) {
+        err = stim_seq_apply(&seq_table);
+    }
+    if (err) {
+        printf("Hardware sequencer setup failed with error: %d\n", err);
+    } else {
+        printf("Hardware sequencer: %zu (D)PPI channels\n", seq_table.channel_count);
+    }
+}
+#endif
+
+// Parameter handoff between the BLE side and the timer ISR. update_* edit
+// params_shadow with params_ready cleared and stim_params_commit() sets it
+// again; the ISR only copies the shadow while params_ready is set. The ISR
+// always runs to completion over thread code on this core, so it never sees
+// a half-written block and neither side ever waits on the other.
+static stim_params params_shadow;
+static atomic_t params_ready;
+static stim_params params_live;     // ISR only
+static bool params_latched = false; // ISR only: params_live not on TIMER0 yet
+
+static stim_params *params_edit(void) {
+    // Withdraw an unapplied commit for as long as the block is being changed
+    atomic_clear(&params_ready);
+    return &params_shadow;
+}
+
+// Take a committed block, if any, and queue its DAC codes for the next
+// transfers. Runs at EVENT0, or at EVENT3 in DPPI mode where the transfer at
+// EVENT0 is already queued in the SPIM by then.
+static void params_latch(void) {
+    if (!atomic_clear(&params_ready)) {
+        return;
+    }
+    params_live = params_shadow;
+    params_latched = true;
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+    // Thread code is not editing the shadow while params_ready was set
+    params_shadow.probe = 0;
+#endif
+    spi_set_dac_codes(params_live.dac1_code, params_live.dac2_code);
+}
+
+// Move TIMER0 to the latched block. Runs at EVENT0, right after the counter
+// has been cleared, so every edge of the period uses the same block. The
+// first edge must be further out than the interrupt latency.
+static void params_apply(NRF_TIMER_Type *timer) {
+    if (!params_latched) {
+        return;
+    }
+    params_latched = false;
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL0, params_live.period_ticks);
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL1, params_live.event1_ticks);
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL2, params_live.event2_ticks);
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL3, params_live.event3_ticks);
+#if defined(CONFIG_CHRONOS_DAC_DPPI)
+    // Chip select mirrors of EVENT0 and EVENT2
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL4, params_live.period_ticks);
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL5, params_live.event2_ticks);
+#endif
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+    // Sample timer start mirror of EVENT0
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL5, params_live.period_ticks);
+#endif
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+    low_power_apply(timer, params_live.stop_ticks, params_live.rtc_ticks);
+#endif
+}
+
+#if defined(CONFIG_CHRONOS_MULTICHANNEL)
+// TIMER0 runs free in multi-channel mode. CC0 holds the next edge of any
+// channel, CC1 is the ISR's capture register and CC2 is armed by
+// update_channel so an idle scheduler still picks changes up. Channel
+// changes use the same handoff as params_shadow, one ready bit per channel.
+static stim_sched sched;                // ISR only, after timer_init
+static stim_sched_config channel_shadow[STIM_SCHED_MAX_CHANNELS];
+static atomic_t channel_ready;
+static uint32_t multichannel_late = 0;
+static const uint32_t channel_cs_pins[] = MULTICHANNEL_DAC_CS_PINS;
+static const uint32_t channel_phase_pins[] = MULTICHANNEL_PHASE_PINS;
+static uint8_t channel_buf_tx[DAC_TX_LEN];
+static uint8_t channel_buf_rx[DAC_RX_LEN];
+
+BUILD_ASSERT(ARRAY_SIZE(channel_cs_pins) >= STIM_SCHED_MAX_CHANNELS,
+             "MULTICHANNEL_DAC_CS_PINS needs an entry per channel");
+BUILD_ASSERT(ARRAY_SIZE(channel_phase_pins) >= STIM_SCHED_MAX_CHANNELS,
+             "MULTICHANNEL_PHASE_PINS needs an entry per channel");
+
+static void channel_write_dac(uint8_t channel, uint16_t code) {
+    channel_buf_tx[0] = (code >> 8) & 0xFF;  // MSB
+    channel_buf_tx[1] = code & 0xFF;         // LSB
+    spi_write_dac(channel_cs_pins[channel], channel_buf_tx, channel_buf_rx);
+}
+
+static void multichannel_dispatch(const stim_sched_edge *edge) {
+    uint16_t amplitude = sched.channels[edge->channel].config.amplitude;
+    uint32_t phase_pin = channel_phase_pins[edge->channel];
+
+    switch (edge->phase) {
+        case STIM_PHASE_CATHODIC:
+            channel_write_dac(edge->channel, amplitude);
+            nrf_gpio_pin_set(phase_pin);
+            break;
+        case STIM_PHASE_ANODIC:
+            channel_write_dac(edge->channel, dac_opposite_code(amplitude));
+            nrf_gpio_pin_set(phase_pin);
+            break;
+        case STIM_PHASE_INTERPHASE:
+        case STIM_PHASE_REST:
+            nrf_gpio_pin_clear(phase_pin);
+            break;
+    }
 }
 
+// Dispatch every edge that is due and arm CC0 for the next one.
+static void multichannel_service(nrfx_timer_t *timer) {
+    atomic_val_t ready = atomic_clear(&channel_ready);
+    uint32_t now = nrfx_timer_capture(timer, NRF_TIMER_CC_CHANNEL1);
+    uint32_t due;
+
+    for (uint8_t channel = 0; ready != 0; channel++, ready >>= 1) {
+        if (ready & 1) {
+            stim_sched_configure(&sched, channel, &channel_shadow[channel], now);
+        }
+    }
+
+    while (stim_sched_peek(&sched, &due)) {
+        now = nrfx_timer_capture(timer, NRF_TIMER_CC_CHANNEL1);
+        if ((int32_t)(due - now) > 0) {
+            nrf_timer_cc_set(timer->p_reg, NRF_TIMER_CC_CHANNEL0, due);
+            // The counter may have passed due while CC0 was written
+            now = nrfx_timer_capture(timer, NRF_TIMER_CC_CHANNEL1);
+            if ((int32_t)(due - now) > 0) {
+                return;
+            }
+        }
+        if ((now - due) > sched.guard_ticks) {
+            multichannel_late++;
+        }
+
+        stim_sched_edge edge;
+        stim_sched_pop(&sched, &edge);
+        multichannel_dispatch(&edge);
+    }
+}
+
+static void multichannel_init(void) {
+    stim_sched_init(&sched, nrfx_timer_us_to_ticks(&timer_inst, CONFIG_CHRONOS_MULTICHANNEL_GUARD_US));
+    atomic_clear(&channel_ready);
+    for (uint8_t channel = 0; channel < STIM_SCHED_MAX_CHANNELS; channel++) {
+        nrf_gpio_cfg_output(channel_cs_pins[channel]);
+        nrf_gpio_pin_set(channel_cs_pins[channel]);       // inactive
+        nrf_gpio_cfg_output(channel_phase_pins[channel]);
+        nrf_gpio_pin_clear(channel_phase_pins[channel]);
+    }
+
+    // Channel 0 starts with the single-channel defaults once the timer runs
+    stim_sched_config config = {
+        .period_ticks = nrfx_timer_us_to_ticks(&timer_inst, DEFAULT_STIM_PERIOD),
+        .pulse_width_ticks = nrfx_timer_us_to_ticks(&timer_inst, DEFAULT_PULSE_WIDTH),
+        .interphase_ticks = nrfx_timer_us_to_ticks(&timer_inst, SWITCH_PERIOD),
+        .amplitude = (dac1_buf_tx[0] << 8) | dac1_buf_tx[1],
+    };
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+    // or with the last committed setting from flash
+    const stim_setting *boot = stim_profile_boot();
+    if (boot) {
+        config.period_ticks = nrfx_timer_us_to_ticks(&timer_inst, 1000000 / boot->frequency);
+        config.pulse_width_ticks = nrfx_timer_us_to_ticks(&timer_inst, boot->pulse_width);
+        config.amplitude = boot->DAC_amplitude;
+    }
+#endif
+    stim_sched_configure(&sched, 0, &config, sched.guard_ticks);
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL0, sched.guard_ticks, true);
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL2, 0, true);
+}
+
+int update_channel(uint8_t channel, uint16_t frequency_hz, uint16_t pulse_width_us,
+                   uint32_t interphase_us, uint16_t amplitude) {
+    stim_sched_config config = {0};
+
+    if (channel >= STIM_SCHED_MAX_CHANNELS) {
+        return -EINVAL;
+    }
+    // 0 Hz stops the channel at the end of its current pulse
+    if (frequency_hz > 0) {
+        config.period_ticks = nrfx_timer_us_to_ticks(&timer_inst, 1000000 / frequency_hz);
+        config.pulse_width_ticks = nrfx_timer_us_to_ticks(&timer_inst, pulse_width_us);
+        config.interphase_ticks = nrfx_timer_us_to_ticks(&timer_inst, interphase_us);
+        config.amplitude = amplitude;
+    }
+    int err = stim_sched_validate(&config);
+    if (err) {
+        return err;
+    }
+
+    atomic_clear_bit(&channel_ready, channel);
+    channel_shadow[channel] = config;
+    atomic_set_bit(&channel_ready, channel);
+
+    // Kick the ISR in case no channel is running to wake it up
+    uint32_t now = nrfx_timer_capture(&timer_inst, NRF_TIMER_CC_CHANNEL2);
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL2, now + sched.guard_ticks, true);
+
+    printf("Channel %u updated: %u Hz, %u us pulse, %lu us interphase, amplitude %u\n",
+           channel, frequency_hz, pulse_width_us, interphase_us, amplitude);
+    return 0;
+}
+
+void get_multichannel_stats(multichannel_stats *stats) {
+    stats->collisions = sched.collisions;
+    stats->late = multichannel_late;
+}
+#endif
+
+static void jitter_record(jitter_event event, uint32_t actual_ticks, uint32_t expected_ticks) {
+    int32_t diff = (int32_t)(actual_ticks - expected_ticks);
+    jitter_hist_record(&event_jitter[event], (diff < 0) ? (uint32_t)-diff : (uint32_t)diff);
+}
+
+void get_jitter_snapshot(jitter_snapshot *snapshot) {
+    snapshot->interrupts = atomic_get(&counter);
+    for (size_t i = 0; i < JITTER_EVENT_COUNT; i++) {
+        jitter_hist_snapshot_get(&event_jitter[i], &snapshot->events[i]);
+    }
+}
+
+// Safe while the timer runs; the ISR keeps recording throughout
+void reset_jitter(void) {
+    atomic_set(&counter, 0);
+    for (size_t i = 0; i < JITTER_EVENT_COUNT; i++) {
+        jitter_hist_reset(&event_jitter[i]);
+    }
+}
+
+uint32_t get_stim_period_us(void) {
+    return current_period_us;
+}
+
+uint32_t get_pulse_width_us(void) {
+    return current_pulse_width_us;
+}
+
+uint32_t get_pulse_count(void) {
+    return atomic_get(&pulse_count);
+}
+
+#if defined(CONFIG_CHRONOS_BURST)
+static atomic_t gate_rearmed;       // CC0 holds the gate lead, not the period
+
+// Stop TIMER0 and arm it to reach EVENT0 lead_ticks after its next start.
+// Only called with the pulse over, from the gate interrupt with TIMER0
+// stopped or from EVENT3. The short first period ends at that EVENT0,
+// where the ISR puts the full period back into CC0.
+void timer_gate_prepare(uint32_t lead_ticks) {
+    NRF_TIMER_Type *timer = timer_inst.p_reg;
+
+    nrfx_timer_pause(&timer_inst);
+    nrfx_timer_clear(&timer_inst);
+    for (uint8_t ch = NRF_TIMER_CC_CHANNEL0; ch <= NRF_TIMER_CC_CHANNEL3; ch++) {
+        nrf_timer_event_clear(timer, nrf_timer_compare_event_get(ch));
+    }
+    nrf_timer_cc_set(timer, NRF_TIMER_CC_CHANNEL0, lead_ticks);
+    atomic_set(&gate_rearmed, 1);
+}
+#endif
+
 void update_stim_frequency(uint16_t frequency_hz) {
     if (frequency_hz == 0) {
         printf("Invalid frequency: 0 Hz\n");
@@ -43,41 +392,29 @@ void update_stim_frequency(uint16_t frequency_hz) {
     
     // Calculate period in microseconds from frequency in Hz
     uint32_t period_us = 1000000 / frequency_hz;
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+    if (period_us <= waveform_duration_us()) {
+        printf("Invalid frequency: %u Hz is shorter than the %lu us waveform\n",
+               frequency_hz, waveform_duration_us());
+        return;
+    }
+#endif
     current_period_us = period_us;
     
     // Convert to timer ticks
     uint32_t period_ticks = nrfx_timer_us_to_ticks(&timer_inst, period_us);
 
-    //LEE ADDING CODE *************************************************************************************************************************
-    //Clear the TIMER to stop missing compare events
-    nrfx_timer_disable(&timer_inst);
-    nrfx_timer_clear(&timer_inst);
-    //LEE DONE ADDING CODE*************************************************************************************************************************
-
-    // Update channel 0 compare value
-    // Note: We keep the SHORT to clear on compare to maintain periodic operation
-    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL0, period_ticks, 
-        NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, true);
-
-    //LEE STILL ADDING CODE*************************************************************************************************************************
-    //Start the timer again
-    nrfx_timer_enable(&timer_inst);
-    //LEE DONE ADDING CODE*************************************************************************************************************************
+    // The timer keeps running; the ISR picks the new period up at the next
+    // EVENT0 once the change is committed
+    params_edit()->period_ticks = period_ticks;
 
     // Also update the measurement timer expectations if needed
     if (MEASURE_TIMER == 1) {
-        // Reset error counters when frequency changes
-        atomic_set(&event0_error_counter, 0);
-        atomic_set(&event0_error_max, 0);
-        atomic_set(&counter,0);            
-        atomic_set(&error,0);
-        atomic_set(&event1_error_max,0);
-        atomic_set(&event2_error_max,0);
-        atomic_set(&event3_error_max,0);
+        // Reset error histograms when frequency changes
+        reset_jitter();
     }
     
-    printf("Timer frequency updated to %u Hz (period: %lu us, ticks: %lu)\n", 
-           frequency_hz, period_us, period_ticks);
+    evlog_write(EVLOG_FREQUENCY, frequency_hz, period_us);
 }
 
 void update_pulse_width(uint16_t pulse_width_us) {
@@ -100,21 +437,56 @@ void update_pulse_width(uint16_t pulse_width_us) {
     uint32_t channel3_us = channel2_us + pulse_width_us;
     uint32_t channel3_ticks = nrfx_timer_us_to_ticks(&timer_inst, channel3_us);
     
-    // Update the compare values
-    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL1, channel1_ticks, true);
-    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL3, channel3_ticks, true);
+    // Staged like the period, so a pulse in flight keeps its edges
+    stim_params *params = params_edit();
+    params->event1_ticks = channel1_ticks;
+    params->event2_ticks = channel2_ticks;
+    params->event3_ticks = channel3_ticks;
     
-    // Also need to make sure channel 2 is still at the right position
-    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL2, channel2_ticks, true);
-    
-    printf("Pulse width updated to %u us (ticks: %lu)\n", pulse_width_us, channel1_ticks);
-    printf("Channel 1 at %u us, Channel 2 at %lu us, Channel 3 at %lu us\n", 
-           pulse_width_us, channel2_us, channel3_us);
+    evlog_write(EVLOG_PULSE_WIDTH, pulse_width_us, channel1_ticks);
+}
+
+void stim_params_set_dac1_code(uint16_t code) {
+    params_edit()->dac1_code = code;
+}
+
+void stim_params_set_dac2_code(uint16_t code) {
+    params_edit()->dac2_code = code;
+}
+
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+uint32_t stim_params_last_edge_ticks(void) {
+    return params_shadow.event3_ticks;
+}
+
+// In low-power mode CC0 holds the short frame from the timer restart to
+// EVENT0 instead of the period, which the RTC keeps
+void stim_params_set_low_power(uint32_t frame_ticks, uint32_t stop_ticks, uint32_t rtc_ticks) {
+    stim_params *params = params_edit();
+
+    if (rtc_ticks > 0) {
+        params->period_ticks = frame_ticks;
+        params->stop_ticks = stop_ticks;
+    } else {
+        params->period_ticks = nrfx_timer_us_to_ticks(&timer_inst, current_period_us);
+        params->stop_ticks = UINT32_MAX;
+    }
+    params->rtc_ticks = rtc_ticks;
+}
+#endif
+
+void stim_params_commit(void) {
+    atomic_set(&params_ready, 1);
 }
 
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+void stim_params_probe(uint16_t seq) {
+    params_edit()->probe = (uint32_t)seq + 1;
+}
+#endif
+
 void timer_init(){
-    atomic_set(&counter, 0);
-    atomic_set(&error,0);
+    reset_jitter();
     uint32_t base_frequency = NRF_TIMER_BASE_FREQUENCY_GET(timer_inst.p_reg);    
     timer_freq_hz = base_frequency;
     printf("Timer frequency: %lu Hz\n", timer_freq_hz);
@@ -127,16 +499,68 @@ void timer_init(){
     if(status != NRFX_SUCCESS){
         printf("Timer initialization failed with error: %d\n", status);
     }
-    uint32_t event1_ticks = nrfx_timer_us_to_ticks(&timer_inst, DEFAULT_PULSE_WIDTH);
-    uint32_t event2_ticks = nrfx_timer_us_to_ticks(&timer_inst, (DEFAULT_PULSE_WIDTH + SWITCH_PERIOD));
-    uint32_t event3_ticks = nrfx_timer_us_to_ticks(&timer_inst, (2*DEFAULT_PULSE_WIDTH + SWITCH_PERIOD));
+#if defined(CONFIG_CHRONOS_MULTICHANNEL)
+    multichannel_init();
+#elif defined(CONFIG_CHRONOS_STIM_PROGRAM)
+    // Free running, CC0 walks through the program entries
+    program_init(&timer_inst);
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+    const stim_setting *boot = stim_profile_boot();
+    if (boot) {
+        // Committed now, so program_start already plays it
+        int err = program_load_setting(boot->frequency, boot->pulse_width, boot->DAC_amplitude);
+        if (err) {
+            printf("Boot profile rejected with error: %d\n", err);
+        }
+    }
+#endif
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL0, program_start(), true);
+#else
+    params_shadow.period_ticks = nrfx_timer_us_to_ticks(&timer_inst, DEFAULT_STIM_PERIOD);
+    params_shadow.event1_ticks = nrfx_timer_us_to_ticks(&timer_inst, DEFAULT_PULSE_WIDTH);
+    params_shadow.event2_ticks = nrfx_timer_us_to_ticks(&timer_inst, (DEFAULT_PULSE_WIDTH + SWITCH_PERIOD));
+    params_shadow.event3_ticks = nrfx_timer_us_to_ticks(&timer_inst, (2*DEFAULT_PULSE_WIDTH + SWITCH_PERIOD));
+    params_shadow.dac1_code = (dac1_buf_tx[0] << 8) | dac1_buf_tx[1];
+    params_shadow.dac2_code = (dac2_buf_tx[0] << 8) | dac2_buf_tx[1];
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+    // Continuous until low_power_init has costed the setting
+    params_shadow.stop_ticks = UINT32_MAX;
+    params_shadow.rtc_ticks = 0;
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROFILES)
+    // The last committed setting from flash replaces the defaults before
+    // the timer first starts, through the same staging as a BLE update
+    const stim_setting *boot = stim_profile_boot();
+    if (boot) {
+        update_stim_frequency(boot->frequency);
+        update_pulse_width(boot->pulse_width);
+        update_dac1_amplitude(boot->DAC_amplitude);
+        update_dac2_amplitude(boot->DAC_amplitude);
+    }
+#endif
+    atomic_clear(&params_ready);
+    params_live = params_shadow;
+    params_latched = false;
     // set frequency of stimulation
-    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL0, 
-                                nrfx_timer_us_to_ticks(&timer_inst, DEFAULT_STIM_PERIOD),
+    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL0, params_live.period_ticks,
                                 NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, true);
-    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL1, event1_ticks, 0, true);
-    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL2, event2_ticks, 0, true);
-    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL3, event3_ticks, 0, true);
+    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL1, params_live.event1_ticks, 0, EDGE_IRQ_ENABLED);
+    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL2, params_live.event2_ticks, 0, DAC_IRQ_ENABLED);
+    nrfx_timer_extended_compare(&timer_inst, NRF_TIMER_CC_CHANNEL3, params_live.event3_ticks, 0, EVENT3_IRQ_ENABLED);
+#if defined(CONFIG_CHRONOS_DAC_DPPI)
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL4, params_live.period_ticks, false);
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL5, params_live.event2_ticks, false);
+    spi_dac_dppi_arm();
+#endif
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+    waveform_init();
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL5, params_live.period_ticks, false);
+    nrfx_timer_compare(&timer_inst, NRF_TIMER_CC_CHANNEL4, waveform_rearm(), true);
+#endif
+#endif
+#if defined(CONFIG_CHRONOS_STIM_HW_SEQ)
+    hw_seq_init();
+#endif
     nrfx_timer_enable(&timer_inst);
     printf("Timer status: %s\n", nrfx_timer_is_enabled(&timer_inst) ? "enabled" : "disabled");
 }
@@ -145,20 +569,36 @@ nrfx_timer_t measurement_timer_init() {
     nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG(NRF_TIMER_BASE_FREQUENCY_GET(measurement_timer.p_reg));
     config.bit_width = NRF_TIMER_BIT_WIDTH_32;
     nrfx_err_t err = nrfx_timer_init(&measurement_timer, &config, NULL); // No handler needed
+#if !defined(CONFIG_CHRONOS_LOW_POWER)
+    // A running TIMER1 would hold HFCLK on between low-power pulses
     nrfx_timer_enable(&measurement_timer);
+#endif
+#if defined(CONFIG_CHRONOS_EDGE_CAPTURE)
+    edge_capture_init(&measurement_timer);
+#endif
     return measurement_timer;
 }
 
 static void timer_handler(nrf_timer_event_t event_type, void * p_context)
 {   
     // Get reference to timer
-    atomic_inc(&counter);
+    if ((atomic_inc(&counter) == 0) &&
+        (IS_ENABLED(CONFIG_CHRONOS_MULTICHANNEL) || IS_ENABLED(CONFIG_CHRONOS_STIM_PROGRAM))) {
+        // Every interrupt of these engines drives an edge
+        boot_stage_mark(BOOT_FIRST_PULSE);
+    }
     //printf("Time handler count: %i \n", counter);
     nrfx_timer_t *timer_inst = (nrfx_timer_t *)p_context;
+#if defined(CONFIG_CHRONOS_MULTICHANNEL)
+    // Every channel runs off CC0, plus the CC2 kick from update_channel
+    multichannel_service(timer_inst);
+    return;
+#endif
+#if defined(CONFIG_CHRONOS_STIM_PROGRAM)
+    program_step(timer_inst->p_reg);
+    return;
+#endif
     uint32_t current_time;
-    uint32_t current_max;
-    uint32_t my_error;
-    uint32_t elapsed1_ticks;
     
     switch(event_type) {
         case NRF_TIMER_EVENT_COMPARE0:
@@ -166,89 +606,158 @@ static void timer_handler(nrf_timer_event_t event_type, void * p_context)
                 current_time = nrfx_timer_capture(&measurement_timer, NRF_TIMER_CC_CHANNEL0);
                     
                 if (prev_main_event_time > 0) {
-                    // Calculate actual interval duration
-                    uint32_t interval_ticks = current_time - prev_main_event_time;
-                    uint32_t expected_ticks = nrfx_timer_us_to_ticks(&measurement_timer, DEFAULT_STIM_PERIOD);
-                    uint32_t event0_error = abs(interval_ticks - expected_ticks);
-                    
-                    // Update statistics
-                    atomic_add(&event0_error_counter, event0_error);
-                    
-                    // Track maximum error
-                    current_max = atomic_get(&event0_error_max);
-                    if (event0_error > current_max) {
-                        atomic_set(&event0_error_max, event0_error);
-                    }
+                    // The period that just ended ran on params_live; both
+                    // timers count at the same base frequency
+                    jitter_record(JITTER_EVENT0, current_time - prev_main_event_time,
+                                  params_live.period_ticks);
                 }
                 prev_main_event_time = current_time;
                 // Capture timestamp when main event occurs (after timer reset)
                 main_event_time = nrfx_timer_capture(timer_inst, NRF_TIMER_CC_CHANNEL4);
             }
 
+            // New period: switch to the last committed parameters
+            if (!IS_ENABLED(CONFIG_CHRONOS_DAC_DPPI)) {
+                params_latch();
+            }
+#if defined(CONFIG_CHRONOS_BURST)
+            // End of the lead after a gate re-arm: the full period goes
+            // back into CC0 even without a new block
+            if (atomic_clear(&gate_rearmed)) {
+                params_latched = true;
+            }
+#endif
+            params_apply(timer_inst->p_reg);
+
             // Switch on 1.03
-            nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 3));
+            if (!IS_ENABLED(CONFIG_CHRONOS_STIM_HW_SEQ)) {
+                nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 3));
+            }
             // SPI transaction on DAC 1
             // 100 us
-            spi_write_dac1(dac1_buf_tx, dac1_buf_rx);
+            if (IS_ENABLED(CONFIG_CHRONOS_DAC_PAIR)) {
+                // DAC2 only drives the electrode from EVENT2, so its code
+                // can go out with DAC1's
+                spi_write_dac_pair();
+            } else if (DAC_ISR_WRITES) {
+                spi_write_dac1(dac1_buf_tx, dac1_buf_rx);
+            }
+            if (atomic_inc(&pulse_count) == 0) {
+                // Not the first interrupt: EVENT1..3 of the lead-in period
+                // after timer_init, or a burst lead, come earlier
+                boot_stage_mark(BOOT_FIRST_PULSE);
+            }
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+            // After the edge and the DAC write, so it adds no jitter to them
+            telemetry_write(TELEMETRY_PULSE, 0, atomic_get(&pulse_count),
+                            ((uint32_t)params_live.dac1_code << 16) | params_live.dac2_code);
+            if (params_live.probe) {
+                // First pulse of a timed setting, its DAC code already written
+                telemetry_write(TELEMETRY_LATENCY, LATENCY_PULSE, params_live.probe - 1,
+                                atomic_get(&pulse_count));
+                params_live.probe = 0;
+            }
+#endif
             break;
             
         case NRF_TIMER_EVENT_COMPARE1:
             if(MEASURE_TIMER == 1){
                 // Capture timestamp when event 1 occurs
-                current_time = nrfx_timer_capture(timer_inst, NRF_TIMER_CC_CHANNEL4);
-                // Calculate elapsed time from main event
-                elapsed1_ticks = current_time - main_event_time;
-                my_error = abs(elapsed1_ticks-DEFAULT_PULSE_WIDTH*timer_freq_hz/1000000);
-                atomic_add(&error,my_error);
-                current_max = atomic_get(&event1_error_max);
-                if (my_error > current_max) {atomic_set(&event1_error_max, my_error);}
+                event1_time = nrfx_timer_capture(timer_inst, NRF_TIMER_CC_CHANNEL4);
+                // Elapsed time from main event
+                jitter_record(JITTER_EVENT1, event1_time - main_event_time,
+                              params_live.event1_ticks);
             }
         
-            // Switch off 1.03
-            nrf_gpio_pin_clear(NRF_GPIO_PIN_MAP(1, 3));
-            // Switch on 1.00
-            nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 0));
-            // Switch on 1.01
-            nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 1));
+            if (!IS_ENABLED(CONFIG_CHRONOS_STIM_HW_SEQ)) {
+                // Switch off 1.03
+                nrf_gpio_pin_clear(NRF_GPIO_PIN_MAP(1, 3));
+                // Switch on 1.00
+                nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 0));
+                // Switch on 1.01
+                nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 1));
+            }
             // wait 10 us
             break;
             
         case NRF_TIMER_EVENT_COMPARE2:
             if(MEASURE_TIMER == 1){
                 // Capture timestamp when event 2 occurs
-                current_time = nrfx_timer_capture(timer_inst, NRF_TIMER_CC_CHANNEL4);
-                // Calculate elapsed time from event 1
-                my_error = abs(elapsed1_ticks-SWITCH_PERIOD*timer_freq_hz/1000000);
-                atomic_add(&error, my_error);
-                current_max = atomic_get(&event2_error_max);
-                if (my_error > current_max) {atomic_set(&event2_error_max, my_error);}
+                event2_time = nrfx_timer_capture(timer_inst, NRF_TIMER_CC_CHANNEL4);
+                // Elapsed time from event 1
+                jitter_record(JITTER_EVENT2, event2_time - event1_time,
+                              params_live.event2_ticks - params_live.event1_ticks);
             }
             
             // Switch on 1.03
-            nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 3));
+            if (!IS_ENABLED(CONFIG_CHRONOS_STIM_HW_SEQ)) {
+                nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 3));
+            }
             // SPI transaction on DAC2 
             // 100 us
-            spi_write_dac2(dac2_buf_tx, dac2_buf_rx);
+            if (DAC2_ISR_WRITES) {
+                spi_write_dac2(dac2_buf_tx, dac2_buf_rx);
+            }
             break;
             
         case NRF_TIMER_EVENT_COMPARE3:
             if(MEASURE_TIMER == 1){
                 // Capture timestamp when event 3 occurs
-                current_time = nrfx_timer_capture(timer_inst, NRF_TIMER_CC_CHANNEL4);
-                // Calculate elapsed time from event 2
-                my_error = abs(elapsed1_ticks-DEFAULT_PULSE_WIDTH*timer_freq_hz/1000000);
-                atomic_add(&error,my_error);
-                current_max = atomic_get(&event3_error_max);
-                if (my_error > current_max) {atomic_set(&event3_error_max, my_error);}
+                event3_time = nrfx_timer_capture(timer_inst, NRF_TIMER_CC_CHANNEL4);
+                // Elapsed time from event 2
+                jitter_record(JITTER_EVENT3, event3_time - event2_time,
+                              params_live.event3_ticks - params_live.event2_ticks);
             }
             
-            // Switch off 1.03
-            nrf_gpio_pin_clear(NRF_GPIO_PIN_MAP(1, 3));
-            // Switch on 1.00
-            nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 0));
-            // Switch on 1.01
-            nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 1));
+            if (!IS_ENABLED(CONFIG_CHRONOS_STIM_HW_SEQ)) {
+                // Switch off 1.03
+                nrf_gpio_pin_clear(NRF_GPIO_PIN_MAP(1, 3));
+                // Switch on 1.00
+                nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 0));
+                // Switch on 1.01
+                nrf_gpio_pin_set(NRF_GPIO_PIN_MAP(1, 1));
+            }
             // wait 10 us
+#if defined(CONFIG_CHRONOS_CHARGE_MONITOR)
+            charge_monitor_pulse_end();
+#endif
+#if defined(CONFIG_CHRONOS_BURST)
+            burst_gate_pulse_end();
+#endif
+#if defined(CONFIG_CHRONOS_DAC_DPPI)
+            // Both DAC transfers of this period are done, queue the next
+            // with the codes that go with the next period's timing
+            params_latch();
+            spi_dac_dppi_arm();
+#endif
             break;
+
+#if defined(CONFIG_CHRONOS_WAVEFORM)
+        case NRF_TIMER_EVENT_COMPARE4:
+            // Last sample of this pulse is out, rewind for the next one
+            nrfx_timer_compare(timer_inst, NRF_TIMER_CC_CHANNEL4, waveform_rearm(), true);
+            break;
+#endif
     }
-}
\ No newline at end of file
+}
+#if defined(CONFIG_CHRONOS_STIM_IRQ_ZLI)
+// Zero-latency entry point for TIMER0, in place of the nrfx dispatch: one
+// pass over the compare events that have their interrupt enabled, in
+// channel order like nrfx_timer_irq_handler. Never asks for a reschedule,
+// as the kernel state may be mid-update underneath it.
+ISR_DIRECT_DECLARE(timer_zli_isr)
+{
+    NRF_TIMER_Type *reg = timer_inst.p_reg;
+
+    for (uint8_t ch = 0; ch < timer_inst.cc_channel_count; ch++) {
+        nrf_timer_event_t event = nrf_timer_compare_event_get(ch);
+
+        if (nrf_timer_int_enable_check(reg, nrf_timer_compare_int_get(ch)) &&
+            nrf_timer_event_check(reg, event)) {
+            nrf_timer_event_clear(reg, event);
+            timer_handler(event, &timer_inst);
+        }
+    }
+    return 0;
+}
+#endif
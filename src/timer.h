@@ -4,6 +4,7 @@
 #include <nrfx_timer.h>
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
+#include "jitter_hist.h"
 
 #define TIMER_INST_IDX 0
 //This is the time between stim
@@ -13,19 +14,64 @@
 // This is the time between switching 1.03 off and SPI transac on DAC2 
 #define SWITCH_PERIOD 1000000  // x2: Time after EVENT1
 
+// MEASURE_TIMER: EVENT0 is measured period to period on TIMER1, EVENT1..3
+// each against the edge before it
+typedef enum {
+    JITTER_EVENT0,
+    JITTER_EVENT1,
+    JITTER_EVENT2,
+    JITTER_EVENT3,
+    JITTER_EVENT_COUNT
+} jitter_event;
+
+typedef struct {
+    uint32_t interrupts;    // timer handler calls since the last reset
+    jitter_hist_snapshot events[JITTER_EVENT_COUNT];
+} jitter_snapshot;
+
 typedef struct {
-    uint32_t event1_max;
-    uint32_t event2_max;
-    uint32_t event3_max;
-    uint32_t event0_error;
-    uint32_t event0_max;
-    uint32_t myerror;
-    uint32_t mycounter;
-} error_data;
+    uint32_t collisions;    // edges delayed to keep a DAC transaction apart
+    uint32_t late;          // edges dispatched more than the guard too late
+} multichannel_stats;
 
 void timer_init();
-void get_error_data(error_data *data);
+#if defined(CONFIG_CHRONOS_STIM_IRQ_ZLI)
+// TIMER0 zero-latency ISR, for IRQ_DIRECT_CONNECT
+void timer_zli_isr(void);
+#endif
+void get_jitter_snapshot(jitter_snapshot *snapshot);
+void reset_jitter(void);
 nrfx_timer_t measurement_timer_init();
+uint32_t get_stim_period_us(void);
+uint32_t get_pulse_width_us(void);
+// Pulses started since boot, single-channel mode
+uint32_t get_pulse_count(void);
+#if defined(CONFIG_CHRONOS_BURST)
+// Burst gate only, between pulses: TIMER0 stopped, EVENT0 due lead_ticks
+// after the next start
+void timer_gate_prepare(uint32_t lead_ticks);
+#endif
 void update_stim_frequency(uint16_t frequency_hz);
 void update_pulse_width(uint16_t pulse_width_us);
+// update_* and the DAC code setters only stage a change; the timer ISR
+// switches to the whole set at the start of the period after the commit.
+void stim_params_set_dac1_code(uint16_t code);
+void stim_params_set_dac2_code(uint16_t code);
+void stim_params_commit(void);
+#if defined(CONFIG_CHRONOS_TELEMETRY)
+// Tags the next commit with a timed setting's command seq; the first pulse
+// on it reports TELEMETRY_LATENCY / LATENCY_PULSE once its DAC write is done
+void stim_params_probe(uint16_t seq);
+#endif
+#if defined(CONFIG_CHRONOS_LOW_POWER)
+// EVENT3 of the staged setting, the last edge of a pulse
+uint32_t stim_params_last_edge_ticks(void);
+// Stages the mode picked by low_power_stage; rtc_ticks 0 is the continuous
+// train at the staged period
+void stim_params_set_low_power(uint32_t frame_ticks, uint32_t stop_ticks, uint32_t rtc_ticks);
+#endif
+// Multi-channel mode: takes effect at the channel's next period
+int update_channel(uint8_t channel, uint16_t frequency_hz, uint16_t pulse_width_us,
+                   uint32_t interphase_us, uint16_t amplitude);
+void get_multichannel_stats(multichannel_stats *stats);
 #endif
\ No newline at end of file
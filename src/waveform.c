@@ -0,0 +1,127 @@
+#include <nrfx_timer.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include "waveform.h"
+#include "timer.h"
+#include "spi.h"
+
+typedef struct {
+    uint8_t codes[WAVEFORM_MAX_SAMPLES][DAC_TX_LEN];   // MSB first, as sent
+    uint16_t sample_count;
+    uint16_t sample_period_us;
+} waveform_bank;
+
+// One bank is played while the other is uploaded. The timer ISR owns
+// active_bank and only flips it while commit_pending is set, and uploads are
+// refused until the flip has happened, so the two sides never share a bank.
+static waveform_bank banks[2];
+static uint8_t active_bank = 0;
+static atomic_t commit_pending;
+static nrfx_timer_t sample_timer = NRFX_TIMER_INSTANCE(WAVEFORM_TIMER_INST_IDX);
+static uint32_t stop_ticks = 0;
+
+static uint32_t bank_duration_us(const waveform_bank *bank) {
+    return (uint32_t)(bank->sample_count + 1) * bank->sample_period_us;
+}
+
+// Program the sample clock and the TIMER0 tick that stops it. The stop lands
+// half a sample after the last one so exactly sample_count transfers start.
+static void bank_apply(const waveform_bank *bank) {
+    uint32_t period_ticks = nrfx_timer_us_to_ticks(&sample_timer, bank->sample_period_us);
+
+    nrfx_timer_extended_compare(&sample_timer, NRF_TIMER_CC_CHANNEL0, period_ticks,
+                                NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, false);
+    stop_ticks = (bank->sample_count * period_ticks) + (period_ticks / 2);
+}
+
+void waveform_init(void) {
+    nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG(NRF_TIMER_BASE_FREQUENCY_GET(sample_timer.p_reg));
+    config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    nrfx_err_t status = nrfx_timer_init(&sample_timer, &config, NULL);
+    if (status != NRFX_SUCCESS) {
+        printf("Waveform timer initialization failed with error: %d\n", status);
+        return;
+    }
+
+    // Nothing is played until a waveform has been committed
+    banks[0].sample_count = 0;
+    banks[0].sample_period_us = WAVEFORM_MIN_SAMPLE_PERIOD_US;
+    active_bank = 0;
+    atomic_clear(&commit_pending);
+    bank_apply(&banks[0]);
+    spi_dac_list_arm(banks[0].codes[0]);
+}
+
+int waveform_begin(uint16_t sample_period_us, uint16_t sample_count) {
+    if (atomic_get(&commit_pending)) {
+        return -EBUSY;
+    }
+    if ((sample_period_us < WAVEFORM_MIN_SAMPLE_PERIOD_US) ||
+        (sample_count == 0) || (sample_count > WAVEFORM_MAX_SAMPLES)) {
+        return -EINVAL;
+    }
+
+    waveform_bank *staging = &banks[active_bank ^ 1];
+    staging->sample_period_us = sample_period_us;
+    staging->sample_count = sample_count;
+    return 0;
+}
+
+int waveform_write(uint16_t offset, const uint8_t *codes_le, uint16_t count) {
+    if (atomic_get(&commit_pending)) {
+        return -EBUSY;
+    }
+
+    waveform_bank *staging = &banks[active_bank ^ 1];
+    if ((uint32_t)offset + count > staging->sample_count) {
+        return -EINVAL;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t code = sys_get_le16(&codes_le[2 * i]);
+        staging->codes[offset + i][0] = (code >> 8) & 0xFF;  // MSB
+        staging->codes[offset + i][1] = code & 0xFF;         // LSB
+    }
+    return 0;
+}
+
+// Hand the uploaded table to the timer ISR, which switches to it at the end
+// of the current playback.
+int waveform_commit(void) {
+    const waveform_bank *staging = &banks[active_bank ^ 1];
+
+    if (staging->sample_count == 0) {
+        return -EINVAL;
+    }
+    if (bank_duration_us(staging) >= get_stim_period_us()) {
+        return -ERANGE;
+    }
+    atomic_set(&commit_pending, 1);
+    return 0;
+}
+
+// Called from the timer ISR once playback of the current pulse is over.
+// Rewinds the SPIM list and returns the TIMER0 tick at which the sample
+// clock has to be stopped in the next period.
+uint32_t waveform_rearm(void) {
+    nrf_timer_task_trigger(sample_timer.p_reg, NRF_TIMER_TASK_STOP);
+    nrf_timer_task_trigger(sample_timer.p_reg, NRF_TIMER_TASK_CLEAR);
+
+    if (atomic_get(&commit_pending)) {
+        active_bank ^= 1;
+        bank_apply(&banks[active_bank]);
+        atomic_clear(&commit_pending);
+    }
+    spi_dac_list_arm(banks[active_bank].codes[0]);
+    return stop_ticks;
+}
+
+// Longest playback that may still be running, active or about to be.
+uint32_t waveform_duration_us(void) {
+    uint32_t duration = bank_duration_us(&banks[active_bank]);
+
+    if (atomic_get(&commit_pending)) {
+        duration = MAX(duration, bank_duration_us(&banks[active_bank ^ 1]));
+    }
+    return duration;
+}
@@ -0,0 +1,19 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <zephyr/types.h>
+
+// Waveform playback: a table of DAC8832 codes streamed to DAC1 by SPIM
+// EasyDMA in ArrayList mode, one entry per tick of the sample timer.
+#define WAVEFORM_TIMER_INST_IDX         2
+#define WAVEFORM_MAX_SAMPLES            CONFIG_CHRONOS_WAVEFORM_MAX_SAMPLES
+#define WAVEFORM_MIN_SAMPLE_PERIOD_US   4   // one 16-bit SPIM transfer plus CS
+
+void waveform_init(void);
+int waveform_begin(uint16_t sample_period_us, uint16_t sample_count);
+int waveform_write(uint16_t offset, const uint8_t *codes_le, uint16_t count);
+int waveform_commit(void);
+uint32_t waveform_rearm(void);
+uint32_t waveform_duration_us(void);
+
+#endif // WAVEFORM_H
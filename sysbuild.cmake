@@ -0,0 +1,10 @@
+#
+# Pulse sequencer on the nRF54H20 PPR, launched by the application core
+#
+if(SB_CONFIG_CHRONOS_PPR)
+  ExternalZephyrProject_Add(
+    APPLICATION chronos_ppr
+    SOURCE_DIR ${APP_DIR}/ppr
+    BOARD ${SB_CONFIG_BOARD}/${SB_CONFIG_SOC}/cpuppr
+  )
+endif()
@@ -0,0 +1,107 @@
+#include <zephyr/ztest.h>
+#include <string.h>
+#include "blackbox_block.h"
+
+#define PAGE_SIZE       4096
+#define PARTITION_SIZE  (4 * PAGE_SIZE)
+
+static uint8_t block[BLACKBOX_BLOCK_LEN];
+static blackbox_record records[BLACKBOX_BLOCK_RECORDS];
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    for (size_t i = 0; i < ARRAY_SIZE(records); i++) {
+        records[i] = (blackbox_record){
+            .timestamp = 1000 * i,
+            .type = BLACKBOX_SETTING,
+            .index = i,
+            .value = {(100 << 16) | 200, 0x8000 + i},
+        };
+    }
+}
+
+ZTEST(blackbox_block, test_pack_and_check) {
+    blackbox_record out;
+    uint32_t seq = 0;
+
+    zassert_ok(blackbox_block_pack(block, 42, records, 3));
+    zassert_equal(blackbox_block_check(block, &seq), 3);
+    zassert_equal(seq, 42);
+    memcpy(&out, block + BLACKBOX_HEADER_LEN + 2 * BLACKBOX_RECORD_LEN, sizeof(out));
+    zassert_mem_equal(&out, &records[2], sizeof(out));
+    // Unused records stay erased, so a block is written once
+    zassert_equal(block[BLACKBOX_HEADER_LEN + 3 * BLACKBOX_RECORD_LEN], 0xFF);
+    zassert_equal(block[BLACKBOX_BLOCK_LEN - 1], 0xFF);
+
+    zassert_ok(blackbox_block_pack(block, 43, records, BLACKBOX_BLOCK_RECORDS));
+    zassert_equal(blackbox_block_check(block, &seq), BLACKBOX_BLOCK_RECORDS);
+    zassert_equal(blackbox_block_pack(block, 44, records, 0), -EINVAL);
+    zassert_equal(blackbox_block_pack(block, 44, records, BLACKBOX_BLOCK_RECORDS + 1), -EINVAL);
+}
+
+ZTEST(blackbox_block, test_erased_and_corrupt_blocks) {
+    uint32_t seq = 7;
+
+    memset(block, 0xFF, sizeof(block));
+    zassert_equal(blackbox_block_check(block, &seq), -ENOENT);
+    zassert_equal(seq, 7);
+
+    // Cut short by a reset: the magic landed, a record did not
+    zassert_ok(blackbox_block_pack(block, 1, records, 2));
+    block[BLACKBOX_HEADER_LEN + BLACKBOX_RECORD_LEN + 5] = 0xFF;
+    zassert_equal(blackbox_block_check(block, &seq), -EBADMSG);
+
+    // Only the magic missing: still not erased
+    zassert_ok(blackbox_block_pack(block, 1, records, 2));
+    memset(block, 0xFF, 4);
+    zassert_equal(blackbox_block_check(block, &seq), -EBADMSG);
+}
+
+ZTEST(blackbox_block, test_blocks_stay_within_pages) {
+    blackbox_index index;
+
+    zassert_equal(blackbox_index_init(&index, PAGE_SIZE, PAGE_SIZE), -EINVAL);
+    zassert_equal(blackbox_index_init(&index, PARTITION_SIZE, 128), -EINVAL);
+    zassert_ok(blackbox_index_init(&index, PARTITION_SIZE, PAGE_SIZE));
+    zassert_equal(index.blocks_per_page, 17);
+    zassert_equal(index.block_count, 4 * 17);
+
+    for (uint32_t b = 0; b < index.block_count; b++) {
+        uint32_t offset = blackbox_block_offset(&index, b);
+        zassert_equal(offset / PAGE_SIZE, (offset + BLACKBOX_BLOCK_LEN - 1) / PAGE_SIZE,
+                      "block %u crosses a page", b);
+        zassert_equal(blackbox_block_starts_page(&index, b), (offset % PAGE_SIZE) == 0);
+    }
+    zassert_equal(blackbox_block_offset(&index, 17), PAGE_SIZE);
+}
+
+ZTEST(blackbox_block, test_index_finds_the_newest_block) {
+    blackbox_index index;
+
+    zassert_ok(blackbox_index_init(&index, PARTITION_SIZE, PAGE_SIZE));
+    zassert_equal(blackbox_index_next(&index), 0);
+    zassert_equal(blackbox_index_next_seq(&index), 1);
+
+    // Wrapped once: the first page was erased again and holds the newest
+    // blocks, the rest of it is still empty
+    for (uint32_t b = 0; b < 5; b++) {
+        blackbox_index_note(&index, b, 69 + b);
+    }
+    for (uint32_t b = 17; b < index.block_count; b++) {
+        blackbox_index_note(&index, b, b + 1);
+    }
+    zassert_equal(index.newest_block, 4);
+    zassert_equal(blackbox_index_next(&index), 5);
+    zassert_equal(blackbox_index_next_seq(&index), 74);
+
+    // seq wraps around too
+    zassert_ok(blackbox_index_init(&index, PARTITION_SIZE, PAGE_SIZE));
+    blackbox_index_note(&index, index.block_count - 1, UINT32_MAX);
+    blackbox_index_note(&index, 3, UINT32_MAX - 1);
+    zassert_equal(blackbox_index_next(&index), 0);
+    blackbox_index_note(&index, 0, 0);
+    zassert_equal(blackbox_index_next(&index), 1);
+    zassert_equal(blackbox_index_next_seq(&index), 1);
+}
+
+ZTEST_SUITE(blackbox_block, NULL, NULL, before, NULL, NULL);
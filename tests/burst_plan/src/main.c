@@ -0,0 +1,90 @@
+#include <zephyr/ztest.h>
+#include "burst_plan.h"
+
+#define TICKS_PER_MS 16000          // 16 MHz timers
+#define PERIOD_100HZ 160000
+#define LAST_EDGE 7200              // 2 x 200 us + 50 us interphase
+
+ZTEST(burst_plan, test_theta_burst) {
+    // 5 pulses at 100 Hz every 200 ms, 10 s on / 50 s off
+    const burst_setting setting = {5, 200, 10, 50};
+    burst_plan plan;
+
+    zassert_ok(burst_plan_compute(&setting, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan));
+    zassert_equal(plan.lead_ticks, 16);
+    zassert_equal(plan.stop_ticks, 5 * PERIOD_100HZ);
+    zassert_equal(plan.period_ticks, 200 * TICKS_PER_MS);
+    zassert_equal(plan.on_bursts, 50);
+    zassert_equal(plan.cycle_bursts, 300);
+
+    zassert_true(burst_plan_is_on(&plan, 0));
+    zassert_true(burst_plan_is_on(&plan, 49));
+    zassert_false(burst_plan_is_on(&plan, 50));
+    zassert_false(burst_plan_is_on(&plan, 299));
+    zassert_true(burst_plan_is_on(&plan, 300));
+}
+
+ZTEST(burst_plan, test_without_off_time) {
+    const burst_setting setting = {3, 100, 0, 0};
+    burst_plan plan;
+
+    zassert_ok(burst_plan_compute(&setting, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan));
+    zassert_equal(plan.on_bursts, 0);
+    for (uint32_t burst = 0; burst < 1000; burst += 7) {
+        zassert_true(burst_plan_is_on(&plan, burst));
+    }
+    // The on window alone means nothing without an off window
+    const burst_setting on_only = {3, 100, 5, 0};
+    zassert_ok(burst_plan_compute(&on_only, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan));
+    zassert_equal(plan.on_bursts, 0);
+}
+
+ZTEST(burst_plan, test_windows_round_to_bursts) {
+    const burst_setting setting = {1, 300, 1, 2};
+    burst_plan plan;
+
+    zassert_ok(burst_plan_compute(&setting, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan));
+    zassert_equal(plan.on_bursts, 3);       // 3.33 bursts
+    zassert_equal(plan.cycle_bursts, 3 + 7);    // 6.67 bursts
+
+    // Shorter than half a burst still gets one
+    const burst_setting long_bursts = {1, 5000, 1, 1};
+    zassert_ok(burst_plan_compute(&long_bursts, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan));
+    zassert_equal(plan.on_bursts, 1);
+    zassert_equal(plan.cycle_bursts, 2);
+}
+
+ZTEST(burst_plan, test_burst_must_fit) {
+    burst_plan plan;
+
+    // 50 ms of pulses need the guard on top
+    const burst_setting full = {5, 50, 0, 0};
+    zassert_equal(burst_plan_compute(&full, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan),
+                  -ERANGE);
+    const burst_setting fits = {5, 51, 0, 0};
+    zassert_ok(burst_plan_compute(&fits, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan));
+    const burst_setting overflow = {65535, 65535, 0, 0};
+    zassert_equal(burst_plan_compute(&overflow, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan),
+                  -ERANGE);
+}
+
+ZTEST(burst_plan, test_invalid) {
+    burst_plan plan;
+    const burst_setting no_pulses = {0, 200, 0, 0};
+    const burst_setting no_period = {5, 0, 0, 0};
+    const burst_setting off_only = {5, 200, 0, 10};
+    const burst_setting valid = {5, 200, 0, 0};
+
+    zassert_equal(burst_plan_compute(&no_pulses, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan),
+                  -EINVAL);
+    zassert_equal(burst_plan_compute(&no_period, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan),
+                  -EINVAL);
+    zassert_equal(burst_plan_compute(&off_only, PERIOD_100HZ, LAST_EDGE, TICKS_PER_MS, &plan),
+                  -EINVAL);
+    // No room to park the timer between the last edge and the next pulse
+    zassert_equal(burst_plan_compute(&valid, PERIOD_100HZ, PERIOD_100HZ - 16, TICKS_PER_MS, &plan),
+                  -EINVAL);
+    zassert_ok(burst_plan_compute(&valid, PERIOD_100HZ, PERIOD_100HZ - 17, TICKS_PER_MS, &plan));
+}
+
+ZTEST_SUITE(burst_plan, NULL, NULL, NULL, NULL, NULL);
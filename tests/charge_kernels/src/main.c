@@ -0,0 +1,81 @@
+#include <zephyr/ztest.h>
+#include "charge_kernels.h"
+#include "samples.h"
+
+static const charge_limits limits = {
+    .baseline = SAMPLE_BASELINE,
+    .expected = {600, -600},
+    .residual_pct = 5,
+    .compliance_pct = 20,
+};
+
+ZTEST(charge_kernels, test_sum) {
+    static const int16_t mixed[7] = {-32768, 32767, -1, 1, 100, -200, 300};
+    int32_t sum = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(balanced_cathodic); i++) {
+        sum += balanced_cathodic[i];
+    }
+    zassert_equal(charge_sum_q15(balanced_cathodic, ARRAY_SIZE(balanced_cathodic)), sum);
+    // Every tail length after the four-sample passes
+    zassert_equal(charge_sum_q15(mixed, 0), 0);
+    zassert_equal(charge_sum_q15(mixed, 1), -32768);
+    zassert_equal(charge_sum_q15(mixed, 4), -1);
+    zassert_equal(charge_sum_q15(mixed, 5), 99);
+    zassert_equal(charge_sum_q15(mixed, 7), 199);
+    // Unaligned start
+    zassert_equal(charge_sum_q15(&mixed[1], 6), 32967);
+}
+
+ZTEST(charge_kernels, test_expected_mean) {
+    zassert_equal(charge_expected_mean(0x8000, 58), 0);
+    zassert_equal(charge_expected_mean(0x8000 + 1024, 58), 58);
+    zassert_equal(charge_expected_mean(0x8000 - 2048, 58), -116);
+    zassert_equal(charge_expected_mean(0xFFFF, 58), 1855);
+}
+
+ZTEST(charge_kernels, test_balanced_pulse) {
+    const int16_t *const samples[] = {balanced_cathodic, balanced_anodic};
+    const size_t count[] = {ARRAY_SIZE(balanced_cathodic), ARRAY_SIZE(balanced_anodic)};
+    charge_pulse pulse;
+
+    charge_pulse_evaluate(samples, count, &limits, &pulse);
+    zassert_equal(pulse.samples[CHARGE_PHASE_CATHODIC], 50);
+    zassert_equal(pulse.charge[CHARGE_PHASE_CATHODIC], 28793);
+    zassert_equal(pulse.charge[CHARGE_PHASE_ANODIC], -28813);
+    zassert_equal(pulse.mean[CHARGE_PHASE_CATHODIC], 575);
+    zassert_equal(pulse.mean[CHARGE_PHASE_ANODIC], -576);
+    zassert_equal(pulse.residual, -20);
+    zassert_equal(pulse.alerts, 0);
+}
+
+ZTEST(charge_kernels, test_compliance) {
+    const int16_t *const samples[] = {balanced_cathodic, compliance_anodic};
+    const size_t count[] = {ARRAY_SIZE(balanced_cathodic), ARRAY_SIZE(compliance_anodic)};
+    charge_pulse pulse;
+
+    charge_pulse_evaluate(samples, count, &limits, &pulse);
+    zassert_equal(pulse.charge[CHARGE_PHASE_ANODIC], -18668);
+    zassert_equal(pulse.mean[CHARGE_PHASE_ANODIC], -373);
+    zassert_equal(pulse.residual, 10125);
+    zassert_equal(pulse.alerts, CHARGE_ALERT_COMPLIANCE_ANODIC | CHARGE_ALERT_RESIDUAL);
+
+    // Wrong polarity is a compliance failure whatever the magnitude
+    const int16_t *const swapped[] = {balanced_anodic, balanced_cathodic};
+    charge_pulse_evaluate(swapped, count, &limits, &pulse);
+    zassert_equal(pulse.alerts, CHARGE_ALERT_COMPLIANCE_CATHODIC | CHARGE_ALERT_COMPLIANCE_ANODIC);
+}
+
+ZTEST(charge_kernels, test_missing_phase) {
+    const int16_t *const samples[] = {balanced_cathodic, balanced_anodic};
+    const size_t count[] = {ARRAY_SIZE(balanced_cathodic), 0};
+    charge_pulse pulse;
+
+    charge_pulse_evaluate(samples, count, &limits, &pulse);
+    zassert_equal(pulse.samples[CHARGE_PHASE_ANODIC], 0);
+    zassert_equal(pulse.charge[CHARGE_PHASE_ANODIC], 0);
+    zassert_equal(pulse.residual, 28793);
+    zassert_equal(pulse.alerts, CHARGE_ALERT_RESIDUAL);
+}
+
+ZTEST_SUITE(charge_kernels, NULL, NULL, NULL, NULL, NULL);
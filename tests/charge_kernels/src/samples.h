@@ -0,0 +1,35 @@
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+// Current-sense buffers in the format the charge monitor hands to the
+// kernels: 12-bit single-ended SAADC codes around the mid-scale baseline
+// (2048), one every 10 us over a 500 us phase, with the edge ramps and a few
+// LSB of noise. The compliance buffer is a 600 LSB anodic phase that the
+// source could only drive to 380 LSB.
+#define SAMPLE_BASELINE 2048
+
+static const int16_t balanced_cathodic[50] = {
+    2245, 2442, 2650, 2653, 2642, 2644, 2645, 2642, 2642, 2654, 2652, 2644,
+    2653, 2647, 2645, 2643, 2647, 2649, 2653, 2647, 2646, 2648, 2646, 2647,
+    2645, 2645, 2647, 2654, 2647, 2645, 2646, 2653, 2650, 2648, 2645, 2651,
+    2649, 2648, 2649, 2643, 2649, 2651, 2654, 2647, 2649, 2651, 2647, 2653,
+    2452, 2249,
+};
+
+static const int16_t balanced_anodic[50] = {
+    1848, 1654, 1454, 1443, 1449, 1442, 1445, 1444, 1450, 1444, 1451, 1454,
+    1453, 1453, 1442, 1446, 1450, 1449, 1444, 1443, 1443, 1448, 1442, 1443,
+    1449, 1453, 1450, 1446, 1448, 1450, 1445, 1444, 1450, 1450, 1447, 1443,
+    1445, 1446, 1446, 1444, 1452, 1447, 1448, 1449, 1447, 1449, 1454, 1443,
+    1654, 1854,
+};
+
+static const int16_t compliance_anodic[50] = {
+    1846, 1669, 1664, 1663, 1672, 1669, 1668, 1668, 1662, 1666, 1673, 1663,
+    1666, 1663, 1662, 1669, 1662, 1666, 1664, 1669, 1671, 1669, 1669, 1662,
+    1670, 1662, 1669, 1663, 1671, 1669, 1665, 1674, 1674, 1671, 1669, 1673,
+    1673, 1666, 1672, 1663, 1671, 1662, 1662, 1667, 1674, 1672, 1668, 1668,
+    1667, 1842,
+};
+
+#endif // SAMPLES_H
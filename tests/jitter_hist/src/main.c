@@ -0,0 +1,70 @@
+#include <zephyr/ztest.h>
+#include "jitter_hist.h"
+
+static jitter_hist hist;
+static jitter_hist_snapshot snapshot;
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    jitter_hist_reset(&hist);
+}
+
+ZTEST(jitter_hist, test_empty) {
+    jitter_hist_snapshot_get(&hist, &snapshot);
+    zassert_equal(snapshot.count, 0);
+    zassert_equal(snapshot.min, 0);
+    zassert_equal(snapshot.max, 0);
+    zassert_equal(snapshot.p99, 0);
+}
+
+ZTEST(jitter_hist, test_buckets) {
+    jitter_hist_record(&hist, 0);
+    jitter_hist_record(&hist, 1);
+    jitter_hist_record(&hist, 2);
+    jitter_hist_record(&hist, 3);
+    jitter_hist_record(&hist, 4);
+    jitter_hist_record(&hist, UINT32_MAX);
+
+    jitter_hist_snapshot_get(&hist, &snapshot);
+    zassert_equal(snapshot.count, 6);
+    zassert_equal(snapshot.buckets[0], 1);
+    zassert_equal(snapshot.buckets[1], 1);
+    zassert_equal(snapshot.buckets[2], 2);
+    zassert_equal(snapshot.buckets[3], 1);
+    zassert_equal(snapshot.buckets[32], 1);
+    zassert_equal(snapshot.min, 0);
+    zassert_equal(snapshot.max, UINT32_MAX);
+}
+
+ZTEST(jitter_hist, test_percentiles) {
+    // 990 samples at 5 ticks, 9 at 100, 1 at 5000
+    for (int i = 0; i < 990; i++) {
+        jitter_hist_record(&hist, 5);
+    }
+    for (int i = 0; i < 9; i++) {
+        jitter_hist_record(&hist, 100);
+    }
+    jitter_hist_record(&hist, 5000);
+
+    jitter_hist_snapshot_get(&hist, &snapshot);
+    zassert_equal(snapshot.count, 1000);
+    zassert_equal(snapshot.min, 5);
+    zassert_equal(snapshot.max, 5000);
+    zassert_equal(snapshot.p50, 7);
+    zassert_equal(snapshot.p99, 7);
+    zassert_equal(snapshot.p999, 127);
+}
+
+ZTEST(jitter_hist, test_reset) {
+    jitter_hist_record(&hist, 42);
+    jitter_hist_reset(&hist);
+    jitter_hist_record(&hist, 8);
+
+    jitter_hist_snapshot_get(&hist, &snapshot);
+    zassert_equal(snapshot.count, 1);
+    zassert_equal(snapshot.min, 8);
+    zassert_equal(snapshot.max, 8);
+    zassert_equal(snapshot.p50, 15);
+}
+
+ZTEST_SUITE(jitter_hist, NULL, NULL, before, NULL, NULL);
@@ -0,0 +1,80 @@
+#include <zephyr/ztest.h>
+#include <errno.h>
+#include "lp_plan.h"
+
+#define TICKS_PER_US 16
+#define RTC_HZ 32768
+#define LEAD_US 50
+
+static const lp_model model = {.hfclk_ua = 400, .wake_pc = 2000, .max_hz = 0};
+
+static int plan_for(const lp_model *m, uint32_t period_us, uint32_t last_edge_us, lp_plan *plan) {
+    return lp_plan_compute(m, period_us, last_edge_us * TICKS_PER_US, TICKS_PER_US,
+                           RTC_HZ, LEAD_US, plan);
+}
+
+ZTEST(lp_plan, test_low_rate) {
+    lp_plan plan;
+
+    // 10 Hz, 200 us of pulse phases
+    zassert_ok(plan_for(&model, 100000, 200, &plan));
+    zassert_equal(plan.stop_ticks, (200 + LP_GUARD_US) * TICKS_PER_US);
+    zassert_equal(plan.frame_ticks, (200 + LP_GUARD_US + LEAD_US) * TICKS_PER_US);
+    zassert_equal(plan.pulse_pc, 400 * 270 + 2000);
+    zassert_equal(plan.break_even_us, 275);
+    zassert_not_equal(plan.rtc_ticks, 0);
+
+    // The RTC keeps the period to within one of its ticks
+    uint32_t period_us = (uint64_t)plan.rtc_ticks * 1000000 / RTC_HZ + LEAD_US;
+    zassert_within(period_us, 100000, 1000000 / RTC_HZ);
+
+    zassert_equal(lp_plan_average_na(&model, &plan, 100000), 1100);
+}
+
+ZTEST(lp_plan, test_break_even) {
+    lp_plan plan;
+
+    // At break-even a pulse costs as much as keeping HFCLK running
+    zassert_ok(plan_for(&model, 275, 200, &plan));
+    zassert_equal(plan.rtc_ticks, 0);
+    zassert_equal(lp_plan_average_na(&model, &plan, 275), 400000);
+    // Just above it low-power mode would draw less, but the RTC cannot
+    // restart the timer that soon after it stopped
+    zassert_ok(plan_for(&model, 276, 200, &plan));
+    zassert_equal(plan.rtc_ticks, 0);
+    zassert_ok(plan_for(&model, 1000, 200, &plan));
+    zassert_not_equal(plan.rtc_ticks, 0);
+}
+
+ZTEST(lp_plan, test_max_rate) {
+    lp_model limited = model;
+    lp_plan plan;
+
+    limited.max_hz = 100;
+    zassert_ok(plan_for(&limited, 1000, 200, &plan));
+    zassert_equal(plan.rtc_ticks, 0);
+    zassert_ok(plan_for(&limited, 10000, 200, &plan));
+    zassert_not_equal(plan.rtc_ticks, 0);
+}
+
+ZTEST(lp_plan, test_limits) {
+    lp_model no_current = model;
+    lp_plan plan;
+
+    // Longer than the 24-bit RTC can count
+    zassert_ok(plan_for(&model, 600000000, 200, &plan));
+    zassert_equal(plan.rtc_ticks, 0);
+
+    // Nothing to save without a current figure
+    no_current.hfclk_ua = 0;
+    zassert_ok(plan_for(&no_current, 100000, 200, &plan));
+    zassert_equal(plan.rtc_ticks, 0);
+
+    zassert_equal(lp_plan_compute(&model, 100000, UINT32_MAX, TICKS_PER_US, RTC_HZ,
+                                  LEAD_US, &plan), -ERANGE);
+    zassert_equal(lp_plan_compute(&model, 100000, 0, 0, RTC_HZ, LEAD_US, &plan), -EINVAL);
+    zassert_equal(lp_plan_compute(&model, 100000, 0, TICKS_PER_US, 0, LEAD_US, &plan), -EINVAL);
+    zassert_equal(lp_plan_compute(&model, 0, 0, TICKS_PER_US, RTC_HZ, LEAD_US, &plan), -EINVAL);
+}
+
+ZTEST_SUITE(lp_plan, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,39 @@
+#include <string.h>
+#include "fake_ppr_hal.h"
+
+uint32_t fake_ppr_now;
+fake_ppr_event fake_ppr_trace[FAKE_PPR_TRACE_DEPTH];
+size_t fake_ppr_trace_count;
+
+static void record(bool dac, uint8_t target, uint32_t set_mask, uint32_t clr_mask) {
+    if (fake_ppr_trace_count == FAKE_PPR_TRACE_DEPTH) {
+        return;
+    }
+    fake_ppr_event *event = &fake_ppr_trace[fake_ppr_trace_count++];
+    event->now = fake_ppr_now;
+    event->dac = dac;
+    event->target = target;
+    event->set_mask = set_mask;
+    event->clr_mask = clr_mask;
+}
+
+void fake_ppr_hal_reset(void) {
+    fake_ppr_now = 0;
+    memset(fake_ppr_trace, 0, sizeof(fake_ppr_trace));
+    fake_ppr_trace_count = 0;
+}
+
+void ppr_hal_init(void) {
+}
+
+uint32_t ppr_hal_now(void) {
+    return fake_ppr_now;
+}
+
+void ppr_hal_pins(uint8_t port, uint32_t set_mask, uint32_t clr_mask) {
+    record(false, port, set_mask, clr_mask);
+}
+
+void ppr_hal_dac_write(uint8_t dac, uint16_t code) {
+    record(true, dac, code, 0);
+}
@@ -0,0 +1,23 @@
+#ifndef FAKE_PPR_HAL_H
+#define FAKE_PPR_HAL_H
+
+#include "ppr_hal.h"
+
+#define FAKE_PPR_TRACE_DEPTH 64
+
+// Records what the sequencer drove, stamped with the virtual clock.
+typedef struct {
+    uint32_t now;
+    bool dac;                   // a DAC write, otherwise pins
+    uint8_t target;             // port or stim_program_dac
+    uint32_t set_mask;          // or the DAC code
+    uint32_t clr_mask;
+} fake_ppr_event;
+
+extern uint32_t fake_ppr_now;
+extern fake_ppr_event fake_ppr_trace[FAKE_PPR_TRACE_DEPTH];
+extern size_t fake_ppr_trace_count;
+
+void fake_ppr_hal_reset(void);
+
+#endif // FAKE_PPR_HAL_H
@@ -0,0 +1,223 @@
+#include <zephyr/ztest.h>
+#include "ppr_ring.h"
+#include "ppr_seq.h"
+#include "fake_ppr_hal.h"
+
+#define PHASE_PIN   ((1 << 5) | 3)     // P1.03
+#define SWITCH0_PIN ((1 << 5) | 0)     // P1.00
+#define SWITCH1_PIN ((1 << 5) | 1)     // P1.01
+#define MIN_DELTA   20
+
+static const uint32_t allowed[STIM_PROGRAM_PORTS] = {0, BIT(0) | BIT(1) | BIT(3)};
+static ppr_ring cmd;
+static ppr_ring evt;
+static ppr_seq seq;
+static stim_program program;
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    fake_ppr_hal_reset();
+    ppr_ring_init(&cmd);
+    ppr_ring_init(&evt);
+    ppr_seq_init(&seq, MIN_DELTA, allowed);
+}
+
+// Biphasic train: phase and DAC1 at period - 220, switches 100 later, DAC2
+// 20 after that and the phase cleared 100 later again
+static void build(uint32_t period, uint16_t dac1_code) {
+    zassert_ok(stim_program_build_biphasic(&program, period, 100, 20, dac1_code, 0x7000,
+                                           PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN));
+}
+
+// Upload and let the sequencer take every message at the current time
+static void load(uint32_t upload_seq) {
+    zassert_ok(ppr_ring_put_program(&cmd, &program, upload_seq));
+    while (ppr_ring_space(&cmd) < PPR_RING_DEPTH) {
+        ppr_seq_poll(&seq, &cmd, &evt);
+    }
+}
+
+// Polls once per tick, as if the PPR loop took one tick per pass
+static void run_to(uint32_t end) {
+    while (fake_ppr_now < end) {
+        ppr_seq_poll(&seq, &cmd, &evt);
+        fake_ppr_now++;
+    }
+}
+
+static bool next_event(uint8_t type, ppr_msg *msg) {
+    while (ppr_ring_get(&evt, msg)) {
+        if (msg->type == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const fake_ppr_event *next_edge(size_t *i) {
+    while (*i < fake_ppr_trace_count) {
+        const fake_ppr_event *event = &fake_ppr_trace[(*i)++];
+        if (!event->dac) {
+            return event;
+        }
+    }
+    return NULL;
+}
+
+ZTEST(ppr_seq, test_ring_order_wrap_and_drops) {
+    ppr_msg msg = {.type = PPR_MSG_LOOP};
+    ppr_msg out;
+
+    // Three times around, a few messages in flight at a time
+    for (uint32_t i = 0; i < 3 * PPR_RING_DEPTH; i += 3) {
+        for (uint32_t j = 0; j < 3; j++) {
+            msg.seq = i + j;
+            zassert_true(ppr_ring_put(&evt, &msg));
+        }
+        for (uint32_t j = 0; j < 3; j++) {
+            zassert_true(ppr_ring_get(&evt, &out));
+            zassert_equal(out.seq, i + j);
+        }
+    }
+    zassert_false(ppr_ring_get(&evt, &out));
+
+    for (uint32_t i = 0; i < PPR_RING_DEPTH; i++) {
+        zassert_true(ppr_ring_put(&evt, &msg));
+    }
+    zassert_equal(ppr_ring_space(&evt), 0);
+    zassert_false(ppr_ring_put(&evt, &msg));
+    zassert_equal(ppr_ring_dropped(&evt), 1);
+    zassert_true(ppr_ring_get(&evt, &out));
+    zassert_equal(ppr_ring_space(&evt), 1);
+}
+
+ZTEST(ppr_seq, test_program_upload_is_all_or_nothing) {
+    ppr_msg msg = {.type = PPR_MSG_LOOP};
+
+    build(1000, 0x9000);
+    for (uint32_t i = 0; i < PPR_RING_DEPTH - program.count - 1; i++) {
+        zassert_true(ppr_ring_put(&cmd, &msg));
+    }
+    zassert_equal(ppr_ring_put_program(&cmd, &program, 1), -EAGAIN);
+    zassert_equal(ppr_ring_space(&cmd), program.count + 1);
+
+    program.count = 0;
+    zassert_equal(ppr_ring_put_program(&cmd, &program, 1), -EINVAL);
+}
+
+ZTEST(ppr_seq, test_program_plays_at_deadlines) {
+    ppr_msg msg;
+    size_t i = 0;
+
+    build(1000, 0x9000);
+    load(1);
+    zassert_true(next_event(PPR_MSG_ACK, &msg));
+    zassert_equal(msg.seq, 1);
+    zassert_equal(msg.status, 0);
+
+    run_to(2001);
+    // DAC1 follows the phase edge of the same entry
+    zassert_equal(fake_ppr_trace[0].now, 780);
+    zassert_equal(fake_ppr_trace[0].set_mask, BIT(3));
+    zassert_true(fake_ppr_trace[1].dac);
+    zassert_equal(fake_ppr_trace[1].target, STIM_PROGRAM_DAC1);
+    zassert_equal(fake_ppr_trace[1].set_mask, 0x9000);
+
+    const uint32_t expected[] = {780, 880, 900, 1000, 1780, 1880, 1900, 2000};
+    for (size_t e = 0; e < ARRAY_SIZE(expected); e++) {
+        const fake_ppr_event *edge = next_edge(&i);
+        zassert_not_null(edge);
+        zassert_equal(edge->now, expected[e], "edge %u at %u", e, edge->now);
+    }
+    zassert_is_null(next_edge(&i));
+
+    zassert_true(next_event(PPR_MSG_LOOP, &msg));
+    zassert_equal(msg.seq, 1);
+    zassert_equal(msg.value[0], 0);
+    zassert_equal(msg.value[1], 1);
+    zassert_true(next_event(PPR_MSG_LOOP, &msg));
+    zassert_equal(msg.seq, 2);
+}
+
+ZTEST(ppr_seq, test_rejected_program_keeps_playing) {
+    stim_program_entry stray = {.delta_ticks = 1000, .port = 0, .set_mask = BIT(16)};
+    ppr_msg msg;
+
+    build(1000, 0x9000);
+    load(1);
+    run_to(500);
+
+    stim_program_reset(&program);
+    zassert_ok(stim_program_add(&program, &stray));
+    load(2);
+    zassert_true(next_event(PPR_MSG_ACK, &msg));
+    zassert_true(next_event(PPR_MSG_ACK, &msg));
+    zassert_equal(msg.seq, 2);
+    zassert_equal(msg.status, -EINVAL);
+
+    fake_ppr_trace_count = 0;
+    run_to(1781);
+    zassert_equal(fake_ppr_trace[fake_ppr_trace_count - 2].now, 1780);
+    zassert_equal(fake_ppr_trace[fake_ppr_trace_count - 2].set_mask, BIT(3));
+    zassert_true(next_event(PPR_MSG_LOOP, &msg));
+    zassert_equal(msg.value[1], 1);
+
+    // Unknown messages are refused, not played
+    msg.type = PPR_MSG_READY;
+    msg.seq = 3;
+    ppr_seq_command(&seq, &msg, &evt);
+    zassert_true(next_event(PPR_MSG_ACK, &msg));
+    zassert_equal(msg.seq, 3);
+    zassert_equal(msg.status, -ENOTSUP);
+}
+
+ZTEST(ppr_seq, test_switch_at_loop_end) {
+    ppr_msg msg;
+    size_t i = 0;
+
+    build(1000, 0x9000);
+    load(1);
+    run_to(790);
+
+    build(2000, 0xA000);
+    load(2);
+    zassert_true(next_event(PPR_MSG_ACK, &msg));
+    zassert_true(next_event(PPR_MSG_ACK, &msg));
+    zassert_equal(msg.seq, 2);
+    zassert_equal(msg.status, 0);
+
+    // The rest of the first loop, then the new period from its end
+    fake_ppr_trace_count = 0;
+    run_to(2781);
+    const uint32_t expected[] = {880, 900, 1000, 2780};
+    for (size_t e = 0; e < ARRAY_SIZE(expected); e++) {
+        const fake_ppr_event *edge = next_edge(&i);
+        zassert_not_null(edge);
+        zassert_equal(edge->now, expected[e], "edge %u at %u", e, edge->now);
+    }
+    zassert_true(fake_ppr_trace[i].dac);
+    zassert_equal(fake_ppr_trace[i].set_mask, 0xA000);
+
+    zassert_true(next_event(PPR_MSG_LOOP, &msg));
+    zassert_equal(msg.value[1], 1);
+    zassert_false(next_event(PPR_MSG_LOOP, &msg));
+}
+
+ZTEST(ppr_seq, test_commands_wait_near_an_edge) {
+    build(1000, 0x9000);
+    load(1);
+    run_to(770);
+
+    // 10 ticks before an edge: nothing is taken, the edge is on time
+    build(1000, 0xA000);
+    zassert_ok(ppr_ring_put_program(&cmd, &program, 2));
+    ppr_seq_poll(&seq, &cmd, &evt);
+    zassert_equal(ppr_ring_space(&cmd), PPR_RING_DEPTH - program.count - 2);
+
+    fake_ppr_trace_count = 0;
+    run_to(800);
+    zassert_equal(fake_ppr_trace[0].now, 780);
+    zassert_equal(ppr_ring_space(&cmd), PPR_RING_DEPTH);
+}
+
+ZTEST_SUITE(ppr_seq, NULL, NULL, before, NULL, NULL);
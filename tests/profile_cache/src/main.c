@@ -0,0 +1,134 @@
+#include <zephyr/ztest.h>
+#include <string.h>
+#include "profile_cache.h"
+
+static const stim_setting setting_a = {0x9000, 200, 100};
+static const stim_setting setting_b = {0x7000, 500, 20};
+
+// Performs every pending write as flash would, returns how many there were
+static int flush(profile_cache *cache) {
+    profile_write write;
+    int count = 0;
+
+    while (profile_cache_next_write(cache, &write)) {
+        profile_cache_written(cache, &write);
+        zassert_true(++count <= PROFILE_SLOTS + 1, "writes do not converge");
+    }
+    return count;
+}
+
+ZTEST(profile_cache, test_updates_coalesce) {
+    profile_cache cache;
+    profile_write write;
+
+    profile_cache_init(&cache);
+    zassert_false(profile_cache_next_write(&cache, &write));
+
+    // Many updates before a save leave one write of the latest value
+    for (uint16_t code = 0x8000; code < 0x8100; code++) {
+        const stim_setting setting = {code, 200, 100};
+        profile_cache_set_last(&cache, &setting);
+    }
+    zassert_true(profile_cache_next_write(&cache, &write));
+    zassert_str_equal(write.key, "last");
+    zassert_equal(write.len, sizeof(stim_setting));
+    zassert_equal(((const stim_setting *)write.value)->DAC_amplitude, 0x80FF);
+    profile_cache_written(&cache, &write);
+    zassert_false(profile_cache_next_write(&cache, &write));
+
+    // Going back to what flash holds needs no write at all
+    const stim_setting other = {0x1234, 200, 100};
+    const stim_setting stored = {0x80FF, 200, 100};
+    profile_cache_set_last(&cache, &other);
+    profile_cache_set_last(&cache, &stored);
+    zassert_false(profile_cache_next_write(&cache, &write));
+}
+
+ZTEST(profile_cache, test_write_during_change) {
+    profile_cache cache;
+    profile_write write;
+    stim_setting written;
+
+    profile_cache_init(&cache);
+    profile_cache_set_last(&cache, &setting_a);
+    zassert_true(profile_cache_next_write(&cache, &write));
+    // The value is copied out, then changes while the copy is written
+    memcpy(&written, write.value, sizeof(written));
+    write.value = &written;
+    profile_cache_set_last(&cache, &setting_b);
+    profile_cache_written(&cache, &write);
+    zassert_true(profile_cache_next_write(&cache, &write));
+    zassert_mem_equal(write.value, &setting_b, sizeof(setting_b));
+}
+
+ZTEST(profile_cache, test_profiles) {
+    profile_cache cache;
+    profile_write write;
+    stim_profile profile;
+
+    profile_cache_init(&cache);
+    zassert_equal(profile_cache_get(&cache, 1, &profile), -ENOENT);
+    zassert_ok(profile_cache_save(&cache, 1, "theta", &setting_a));
+    zassert_true(profile_cache_next_write(&cache, &write));
+    zassert_str_equal(write.key, "p1");
+    zassert_equal(write.len, sizeof(stim_profile));
+    zassert_equal(flush(&cache), 1);
+
+    zassert_ok(profile_cache_get(&cache, 1, &profile));
+    zassert_str_equal(profile.name, "theta");
+    zassert_mem_equal(&profile.setting, &setting_a, sizeof(setting_a));
+
+    // Saving the same profile again, from an unpadded name, changes nothing
+    char name[PROFILE_NAME_LEN + 4];
+    memset(name, 'x', sizeof(name));
+    strcpy(name, "theta");
+    zassert_ok(profile_cache_save(&cache, 1, name, &setting_a));
+    zassert_equal(flush(&cache), 0);
+
+    // Names are cut to fit
+    zassert_ok(profile_cache_save(&cache, 2, "a very long profile name", &setting_b));
+    zassert_ok(profile_cache_get(&cache, 2, &profile));
+    zassert_equal(strlen(profile.name), PROFILE_NAME_LEN - 1);
+
+    zassert_ok(profile_cache_delete(&cache, 1));
+    zassert_equal(profile_cache_delete(&cache, 1), -ENOENT);
+    zassert_true(profile_cache_next_write(&cache, &write));
+    zassert_str_equal(write.key, "p1");
+    zassert_equal(write.len, 0);
+    zassert_equal(flush(&cache), 2);    // the delete and profile 2
+
+    zassert_equal(profile_cache_save(&cache, PROFILE_SLOTS, "x", &setting_a), -EINVAL);
+    const stim_setting no_frequency = {0x8000, 200, 0};
+    zassert_equal(profile_cache_save(&cache, 0, "x", &no_frequency), -EINVAL);
+}
+
+ZTEST(profile_cache, test_load) {
+    profile_cache cache;
+    profile_write write;
+    stim_profile profile = {.name = "stored", .setting = setting_b};
+
+    profile_cache_init(&cache);
+    zassert_ok(profile_cache_load(&cache, "last", &setting_a, sizeof(setting_a)));
+    zassert_ok(profile_cache_load(&cache, "p0", &profile, sizeof(profile)));
+    // Loaded values are what flash holds already
+    zassert_false(profile_cache_next_write(&cache, &write));
+    zassert_true(cache.last_valid);
+    zassert_mem_equal(&cache.last, &setting_a, sizeof(setting_a));
+
+    zassert_equal(profile_cache_load(&cache, "last", &setting_a, 4), -EINVAL);
+    const stim_setting no_width = {0x8000, 0, 100};
+    zassert_equal(profile_cache_load(&cache, "last", &no_width, sizeof(no_width)), -EINVAL);
+    zassert_equal(profile_cache_load(&cache, "p00", &profile, sizeof(profile)), -ENOENT);
+    zassert_equal(profile_cache_load(&cache, "p", &profile, sizeof(profile)), -ENOENT);
+    zassert_equal(profile_cache_load(&cache, "p1x", &profile, sizeof(profile)), -ENOENT);
+    zassert_equal(profile_cache_load(&cache, "p99999999999", &profile, sizeof(profile)), -ENOENT);
+    zassert_equal(profile_cache_load(&cache, "other", &profile, sizeof(profile)), -ENOENT);
+
+    // A name without its NUL is terminated on load
+    memset(profile.name, 'n', sizeof(profile.name));
+    zassert_ok(profile_cache_load(&cache, "p1", &profile, sizeof(profile)));
+    zassert_ok(profile_cache_get(&cache, 1, &profile));
+    zassert_equal(strlen(profile.name), PROFILE_NAME_LEN - 1);
+}
+
+ZTEST_SUITE(profile_cache, NULL, NULL, NULL, NULL, NULL);
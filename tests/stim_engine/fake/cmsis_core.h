@@ -0,0 +1,26 @@
+#ifndef FAKE_CMSIS_CORE_H
+#define FAKE_CMSIS_CORE_H
+
+#include <zephyr/types.h>
+
+// DWT cycle counter of the simulated core, kept in step with virtual time
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type fake_dwt;
+extern CoreDebug_Type fake_core_debug;
+extern uint32_t SystemCoreClock;
+
+#define DWT (&fake_dwt)
+#define CoreDebug (&fake_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define __DMB() __sync_synchronize()
+
+#endif // FAKE_CMSIS_CORE_H
@@ -0,0 +1,14 @@
+#ifndef FAKE_NRF_GPIO_H
+#define FAKE_NRF_GPIO_H
+
+#include <nrfx.h>
+
+#define NRF_GPIO_PIN_MAP(port, pin) (((port) << 5) | ((pin) & 0x1F))
+
+void nrf_gpio_cfg_output(uint32_t pin_number);
+void nrf_gpio_pin_set(uint32_t pin_number);
+void nrf_gpio_pin_clear(uint32_t pin_number);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+uint32_t nrf_gpio_pin_out_read(uint32_t pin_number);
+
+#endif // FAKE_NRF_GPIO_H
@@ -0,0 +1,74 @@
+#ifndef FAKE_NRF_TIMER_H
+#define FAKE_NRF_TIMER_H
+
+#include <nrfx.h>
+
+#define NRF_TIMER_CC_COUNT 6
+
+// Register block of a simulated TIMER. The counter is not stored: it is
+// derived from the virtual clock while the timer runs.
+typedef struct {
+    uint32_t CC[NRF_TIMER_CC_COUNT];
+    uint32_t SHORTS;
+    uint32_t INTEN;                 // bit n: COMPARE[n] interrupt
+    // Simulation state
+    bool running;
+    uint32_t base;                  // counter value at start_tick
+    uint64_t start_tick;
+    uint32_t checked;               // compares evaluated up to this count
+    uint64_t checked_tick;
+} NRF_TIMER_Type;
+
+typedef enum {
+    NRF_TIMER_CC_CHANNEL0,
+    NRF_TIMER_CC_CHANNEL1,
+    NRF_TIMER_CC_CHANNEL2,
+    NRF_TIMER_CC_CHANNEL3,
+    NRF_TIMER_CC_CHANNEL4,
+    NRF_TIMER_CC_CHANNEL5,
+} nrf_timer_cc_channel_t;
+
+typedef enum {
+    NRF_TIMER_EVENT_COMPARE0 = 0x140,
+    NRF_TIMER_EVENT_COMPARE1 = 0x144,
+    NRF_TIMER_EVENT_COMPARE2 = 0x148,
+    NRF_TIMER_EVENT_COMPARE3 = 0x14C,
+    NRF_TIMER_EVENT_COMPARE4 = 0x150,
+    NRF_TIMER_EVENT_COMPARE5 = 0x154,
+} nrf_timer_event_t;
+
+#define NRF_TIMER_EVENT_COMPARE(ch) ((nrf_timer_event_t)(NRF_TIMER_EVENT_COMPARE0 + 4 * (ch)))
+
+typedef enum {
+    NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK = 1 << 0,
+    NRF_TIMER_SHORT_COMPARE1_CLEAR_MASK = 1 << 1,
+    NRF_TIMER_SHORT_COMPARE2_CLEAR_MASK = 1 << 2,
+    NRF_TIMER_SHORT_COMPARE3_CLEAR_MASK = 1 << 3,
+} nrf_timer_short_mask_t;
+
+typedef enum {
+    NRF_TIMER_BIT_WIDTH_16,
+    NRF_TIMER_BIT_WIDTH_8,
+    NRF_TIMER_BIT_WIDTH_24,
+    NRF_TIMER_BIT_WIDTH_32,
+} nrf_timer_bit_width_t;
+
+typedef enum {
+    NRF_TIMER_MODE_TIMER,
+    NRF_TIMER_MODE_COUNTER,
+} nrf_timer_mode_t;
+
+#define FAKE_TIMER_FREQUENCY 16000000
+#define NRF_TIMER_BASE_FREQUENCY_GET(p_reg) FAKE_TIMER_FREQUENCY
+
+static inline void nrf_timer_cc_set(NRF_TIMER_Type *p_reg, nrf_timer_cc_channel_t cc_channel,
+                                    uint32_t cc_value) {
+    p_reg->CC[cc_channel] = cc_value;
+}
+
+static inline uint32_t nrf_timer_cc_get(NRF_TIMER_Type const *p_reg,
+                                        nrf_timer_cc_channel_t cc_channel) {
+    return p_reg->CC[cc_channel];
+}
+
+#endif // FAKE_NRF_TIMER_H
@@ -0,0 +1,17 @@
+#ifndef FAKE_NRFX_H
+#define FAKE_NRFX_H
+
+// Just enough of nrfx for timer.c, spi.c and data.c on native_sim. The real
+// nrfx_glue.h pulls in the C library headers the sources rely on.
+#include <zephyr/types.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef enum {
+    NRFX_SUCCESS = 0x0BAD0000,
+    NRFX_ERROR_INTERNAL,
+    NRFX_ERROR_BUSY = 0x0BAD000B,
+} nrfx_err_t;
+
+#endif // FAKE_NRFX_H
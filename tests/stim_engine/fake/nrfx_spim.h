@@ -0,0 +1,60 @@
+#ifndef FAKE_NRFX_SPIM_H
+#define FAKE_NRFX_SPIM_H
+
+#include <nrfx.h>
+
+typedef struct {
+    uint8_t drv_inst_idx;
+} nrfx_spim_t;
+
+#define NRFX_SPIM_INSTANCE(id) { .drv_inst_idx = (id) }
+#define NRF_SPIM_PIN_NOT_CONNECTED 0xFFFFFFFF
+
+typedef struct {
+    uint32_t sck_pin;
+    uint32_t mosi_pin;
+    uint32_t miso_pin;
+    uint32_t ss_pin;
+    uint32_t frequency;
+} nrfx_spim_config_t;
+
+#define NRFX_SPIM_DEFAULT_CONFIG(_pin_sck, _pin_mosi, _pin_miso, _pin_ss) { \
+    .sck_pin = (_pin_sck), .mosi_pin = (_pin_mosi), .miso_pin = (_pin_miso), \
+    .ss_pin = (_pin_ss), .frequency = 4000000 }
+
+typedef struct {
+    uint8_t const *p_tx_buffer;
+    size_t tx_length;
+    uint8_t *p_rx_buffer;
+    size_t rx_length;
+} nrfx_spim_xfer_desc_t;
+
+#define NRFX_SPIM_XFER_TRX(_p_tx_buf, _tx_length, _p_rx_buf, _rx_length) \
+    { .p_tx_buffer = (uint8_t const *)(_p_tx_buf), .tx_length = (_tx_length), \
+      .p_rx_buffer = (_p_rx_buf), .rx_length = (_rx_length) }
+#define NRFX_SPIM_XFER_TX(_p_buf, _length) NRFX_SPIM_XFER_TRX(_p_buf, _length, NULL, 0)
+
+#define NRFX_SPIM_FLAG_TX_POSTINC           (1UL << 0)
+#define NRFX_SPIM_FLAG_HOLD_XFER            (1UL << 3)
+#define NRFX_SPIM_FLAG_REPEATED_XFER        (1UL << 4)
+#define NRFX_SPIM_FLAG_NO_XFER_EVT_HANDLER  (1UL << 2)
+
+typedef enum {
+    NRFX_SPIM_EVENT_DONE,
+} nrfx_spim_evt_type_t;
+
+typedef struct {
+    nrfx_spim_evt_type_t type;
+    nrfx_spim_xfer_desc_t xfer_desc;
+} nrfx_spim_evt_t;
+
+typedef void (*nrfx_spim_evt_handler_t)(nrfx_spim_evt_t const *p_event, void *p_context);
+
+nrfx_err_t nrfx_spim_init(nrfx_spim_t const *p_instance, nrfx_spim_config_t const *p_config,
+                          nrfx_spim_evt_handler_t handler, void *p_context);
+nrfx_err_t nrfx_spim_xfer(nrfx_spim_t const *p_instance, nrfx_spim_xfer_desc_t const *p_xfer_desc,
+                          uint32_t flags);
+uint32_t nrfx_spim_start_task_address_get(nrfx_spim_t const *p_instance);
+uint32_t nrfx_spim_end_event_address_get(nrfx_spim_t const *p_instance);
+
+#endif // FAKE_NRFX_SPIM_H
@@ -0,0 +1,49 @@
+#ifndef FAKE_NRFX_TIMER_H
+#define FAKE_NRFX_TIMER_H
+
+#include <nrfx.h>
+#include <hal/nrf_timer.h>
+
+#define FAKE_TIMER_COUNT 3
+
+extern NRF_TIMER_Type fake_timer_regs[FAKE_TIMER_COUNT];
+
+typedef struct {
+    NRF_TIMER_Type *p_reg;
+    uint8_t instance_id;
+    uint8_t cc_channel_count;
+} nrfx_timer_t;
+
+#define NRFX_TIMER_INSTANCE(id) { \
+    .p_reg = &fake_timer_regs[id], .instance_id = (id), .cc_channel_count = NRF_TIMER_CC_COUNT }
+
+typedef struct {
+    uint32_t frequency;
+    nrf_timer_mode_t mode;
+    nrf_timer_bit_width_t bit_width;
+    uint8_t interrupt_priority;
+    void *p_context;
+} nrfx_timer_config_t;
+
+#define NRFX_TIMER_DEFAULT_CONFIG(_frequency) { \
+    .frequency = (_frequency), .mode = NRF_TIMER_MODE_TIMER, \
+    .bit_width = NRF_TIMER_BIT_WIDTH_16, .interrupt_priority = 0, .p_context = NULL }
+
+typedef void (*nrfx_timer_event_handler_t)(nrf_timer_event_t event_type, void *p_context);
+
+nrfx_err_t nrfx_timer_init(nrfx_timer_t const *p_instance, nrfx_timer_config_t const *p_config,
+                           nrfx_timer_event_handler_t timer_event_handler);
+void nrfx_timer_enable(nrfx_timer_t const *p_instance);
+void nrfx_timer_disable(nrfx_timer_t const *p_instance);
+bool nrfx_timer_is_enabled(nrfx_timer_t const *p_instance);
+void nrfx_timer_clear(nrfx_timer_t const *p_instance);
+uint32_t nrfx_timer_capture(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel);
+uint32_t nrfx_timer_capture_get(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel);
+void nrfx_timer_compare(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel,
+                        uint32_t cc_value, bool enable_int);
+void nrfx_timer_extended_compare(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel,
+                                 uint32_t cc_value, nrf_timer_short_mask_t timer_short_mask,
+                                 bool enable_int);
+uint32_t nrfx_timer_us_to_ticks(nrfx_timer_t const *p_instance, uint32_t time_us);
+
+#endif // FAKE_NRFX_TIMER_H
@@ -0,0 +1,98 @@
+#include <zephyr/ztest.h>
+#include "stim_engine.h"
+#include "timer.h"
+#include "spi.h"
+#include "data.h"
+
+// Synthetic BLE command flood against a 1 kHz stimulation. Virtual time
+// makes the latency numbers exact, so their budget is tight: a change that
+// adds an interrupt, a late event or a busy SPI transfer fails here. Handler
+// cycles come from the host's cycle counter and only guard against gross
+// regressions, so their bound is generous.
+#define BENCH_FREQUENCY_HZ 1000
+#define BENCH_PULSE_WIDTH_US 50
+#define BENCH_PERIODS 32
+#define BENCH_COMMANDS_PER_PERIOD 4
+#define BENCH_LATENCY_BUDGET_TICKS FAKE_IRQ_LATENCY_TICKS
+#define BENCH_HANDLER_CYCLES_MAX 100000
+
+#define BENCH_PERIOD_TICKS ((1000000 / BENCH_FREQUENCY_HZ) * TICKS_PER_US)
+#define DAC1_CS NRF_GPIO_PIN_MAP(0, DAC1_CS_PIN)
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    stim_engine_start();
+}
+
+static void report(const char *name, const jitter_hist *hist, jitter_hist_snapshot *snapshot) {
+    jitter_hist_snapshot_get(hist, snapshot);
+    TC_PRINT("%-24s n=%-5u p50<=%-7u p99<=%-7u max=%u\n", name, snapshot->count,
+             snapshot->p50, snapshot->p99, snapshot->max);
+}
+
+// Empty CMD_TELEMETRY: a malformed or unsupported command in every build
+static void send_command(uint16_t seq) {
+    cmd_header header = {.magic = CMD_MAGIC, .opcode = CMD_TELEMETRY, .seq = seq};
+    process_received_data(&settings, (uint8_t *)&header, sizeof(header));
+}
+
+ZTEST(stim_engine_bench, test_command_flood) {
+    const uint64_t offsets[BENCH_COMMANDS_PER_PERIOD] = {
+        BENCH_PERIOD_TICKS / 8, BENCH_PERIOD_TICKS / 4,
+        BENCH_PERIOD_TICKS / 2, BENCH_PERIOD_TICKS - 1,
+    };
+    uint16_t expected[BENCH_PERIODS];
+    uint16_t amplitude = 0x8000;
+
+    // Switch to the benchmark rate at the end of the default period
+    stim_engine_send_setting(amplitude, BENCH_PULSE_WIDTH_US, BENCH_FREQUENCY_HZ);
+    uint64_t start = DEFAULT_STIM_PERIOD * TICKS_PER_US;
+    fake_nrfx_run_until(start);
+    fake_nrfx_reset_stats();
+    fake_nrfx_clear_trace();
+
+    for (int period = 0; period < BENCH_PERIODS; period++) {
+        uint64_t period_start = start + (uint64_t)period * BENCH_PERIOD_TICKS;
+
+        for (int i = 0; i < BENCH_COMMANDS_PER_PERIOD; i++) {
+            fake_nrfx_run_until(period_start + offsets[i]);
+            if (i == 1) {
+                send_command(period);
+            } else {
+                amplitude += 0x0101;
+                stim_engine_send_setting(amplitude, BENCH_PULSE_WIDTH_US, BENCH_FREQUENCY_HZ);
+            }
+        }
+        // The last commit before the next period's EVENT0 wins
+        expected[period] = amplitude;
+    }
+    fake_nrfx_run_until(start + BENCH_PERIODS * BENCH_PERIOD_TICKS);
+
+    size_t index = 0;
+    for (int period = 0; period < BENCH_PERIODS; period++) {
+        const fake_trace_entry *entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC1_CS);
+        zassert_not_null(entry);
+        zassert_equal(entry->event_tick, start + (uint64_t)(period + 1) * BENCH_PERIOD_TICKS);
+        zassert_equal(entry->code, expected[period]);
+    }
+
+    jitter_hist_snapshot snapshot;
+    TC_PRINT("%u commands over %u periods at %u Hz\n",
+             BENCH_PERIODS * BENCH_COMMANDS_PER_PERIOD, BENCH_PERIODS, BENCH_FREQUENCY_HZ);
+    for (uint8_t ch = 0; ch < 2; ch++) {
+        char name[24];
+
+        snprintf(name, sizeof(name), "EVENT%u latency (ticks)", ch);
+        report(name, &fake_stats[ch].entry_latency, &snapshot);
+        zassert_equal(snapshot.count, BENCH_PERIODS);
+        zassert_true(snapshot.max <= BENCH_LATENCY_BUDGET_TICKS);
+        zassert_equal(fake_stats[ch].late, 0);
+
+        snprintf(name, sizeof(name), "EVENT%u handler (cycles)", ch);
+        report(name, &fake_stats[ch].handler_cycles, &snapshot);
+        zassert_true(snapshot.p99 <= BENCH_HANDLER_CYCLES_MAX);
+    }
+    zassert_equal(fake_spim_busy_errors, 0);
+}
+
+ZTEST_SUITE(stim_engine_bench, NULL, NULL, before, NULL, NULL);
@@ -0,0 +1,358 @@
+#include <zephyr/kernel.h>
+#include <nrfx_timer.h>
+#include <nrfx_spim.h>
+#include <hal/nrf_gpio.h>
+#include <cmsis_core.h>
+#include "fake_nrfx.h"
+
+NRF_TIMER_Type fake_timer_regs[FAKE_TIMER_COUNT];
+DWT_Type fake_dwt;
+CoreDebug_Type fake_core_debug;
+uint32_t SystemCoreClock = FAKE_CPU_FREQUENCY;
+
+fake_trace_entry fake_trace[FAKE_TRACE_MAX];
+size_t fake_trace_count;
+fake_event_stats fake_stats[NRF_TIMER_CC_COUNT];
+uint32_t fake_spim_busy_errors;
+
+typedef struct {
+    nrfx_timer_event_handler_t handler;
+    void *context;
+} fake_timer_driver;
+
+static fake_timer_driver timer_drivers[FAKE_TIMER_COUNT];
+static uint64_t now;
+static uint8_t current_event = FAKE_EVENT_NONE;
+static uint64_t current_event_tick;
+static uint8_t gpio_levels[2][32];
+static uint32_t last_cs_low = NRF_SPIM_PIN_NOT_CONNECTED;
+static uint32_t spim_frequency;
+static uint64_t spim_busy_until;
+
+static uint64_t host_cycles(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void advance(uint64_t ticks) {
+    now += ticks;
+    fake_dwt.CYCCNT = (uint32_t)(now * (FAKE_CPU_FREQUENCY / FAKE_TIMER_FREQUENCY));
+}
+
+static void trace(fake_trace_type type, uint32_t pin, uint16_t code) {
+    if (fake_trace_count >= FAKE_TRACE_MAX) {
+        return;
+    }
+    fake_trace[fake_trace_count++] = (fake_trace_entry){
+        .tick = now,
+        .event_tick = current_event_tick,
+        .pin = pin,
+        .code = code,
+        .type = type,
+        .event = current_event,
+    };
+}
+
+void fake_nrfx_clear_trace(void) {
+    fake_trace_count = 0;
+}
+
+void fake_nrfx_reset_stats(void) {
+    for (size_t i = 0; i < NRF_TIMER_CC_COUNT; i++) {
+        jitter_hist_reset(&fake_stats[i].entry_latency);
+        jitter_hist_reset(&fake_stats[i].handler_cycles);
+        fake_stats[i].late = 0;
+    }
+    fake_spim_busy_errors = 0;
+}
+
+void fake_nrfx_reset(void) {
+    memset(fake_timer_regs, 0, sizeof(fake_timer_regs));
+    memset(timer_drivers, 0, sizeof(timer_drivers));
+    memset(gpio_levels, 0, sizeof(gpio_levels));
+    fake_nrfx_reset_stats();
+    fake_trace_count = 0;
+    current_event = FAKE_EVENT_NONE;
+    current_event_tick = 0;
+    last_cs_low = NRF_SPIM_PIN_NOT_CONNECTED;
+    spim_busy_until = 0;
+    now = 0;
+    advance(0);
+}
+
+void fake_nrfx_print_trace(void) {
+    static const char *const names[] = {"set", "clear", "dac"};
+
+    for (size_t i = 0; i < fake_trace_count; i++) {
+        const fake_trace_entry *entry = &fake_trace[i];
+        printf("%10llu %-5s P%u.%02u", (unsigned long long)entry->tick, names[entry->type],
+               entry->pin >> 5, entry->pin & 0x1F);
+        if (entry->type == FAKE_TRACE_DAC) {
+            printf(" 0x%04X", entry->code);
+        }
+        if (entry->event != FAKE_EVENT_NONE) {
+            printf("  (EVENT%u +%llu)", entry->event,
+                   (unsigned long long)(entry->tick - entry->event_tick));
+        }
+        printf("\n");
+    }
+}
+
+uint64_t fake_nrfx_now(void) {
+    return now;
+}
+
+// ---------------------------------------------------------------- TIMER
+
+static uint32_t counter(const NRF_TIMER_Type *t) {
+    return t->running ? (uint32_t)(t->base + (now - t->start_tick)) : t->base;
+}
+
+static void counter_restart(NRF_TIMER_Type *t, uint32_t value, uint64_t tick) {
+    t->base = value;
+    t->start_tick = tick;
+    t->checked = value;
+    t->checked_tick = tick;
+}
+
+// Virtual time of the next compare match after the last evaluated count,
+// with the channels that match then. It can lie in the past when the counter
+// passed a CC value while the handler was running; that event is then
+// handled late, as on hardware.
+static uint64_t next_compare(const NRF_TIMER_Type *t, uint32_t *channels) {
+    uint64_t best = UINT64_MAX;
+
+    for (uint8_t ch = 0; ch < NRF_TIMER_CC_COUNT; ch++) {
+        uint64_t distance = (uint32_t)(t->CC[ch] - t->checked);
+        if (distance == 0) {
+            distance = 1ULL << 32;
+        }
+        if (t->checked_tick + distance < best) {
+            best = t->checked_tick + distance;
+            *channels = 0;
+        }
+        if (t->checked_tick + distance == best) {
+            *channels |= 1UL << ch;
+        }
+    }
+    return best;
+}
+
+// One interrupt for all channels matching at event_tick, handled in channel
+// order like the nrfx IRQ handler does
+static void dispatch(size_t index, uint32_t channels, uint64_t event_tick) {
+    NRF_TIMER_Type *t = &fake_timer_regs[index];
+    fake_timer_driver *driver = &timer_drivers[index];
+    uint32_t pending = channels & t->INTEN;
+
+    if (t->SHORTS & channels) {
+        counter_restart(t, 0, event_tick);
+    } else {
+        t->checked = t->CC[__builtin_ctz(channels)];
+        t->checked_tick = event_tick;
+    }
+    if ((pending == 0) || (driver->handler == NULL)) {
+        return;
+    }
+
+    bool late = event_tick < now;
+    if (!late) {
+        advance(event_tick - now);
+    }
+    advance(FAKE_IRQ_LATENCY_TICKS);
+
+    for (uint8_t ch = 0; ch < NRF_TIMER_CC_COUNT; ch++) {
+        if (!(pending & (1UL << ch))) {
+            continue;
+        }
+        fake_event_stats *stats = &fake_stats[ch];
+        if (late) {
+            stats->late++;
+        }
+        jitter_hist_record(&stats->entry_latency, (uint32_t)(now - event_tick));
+
+        current_event = ch;
+        current_event_tick = event_tick;
+        uint64_t start = host_cycles();
+        driver->handler(NRF_TIMER_EVENT_COMPARE(ch), driver->context);
+        jitter_hist_record(&stats->handler_cycles, (uint32_t)(host_cycles() - start));
+        current_event = FAKE_EVENT_NONE;
+    }
+}
+
+void fake_nrfx_run(uint64_t ticks) {
+    uint64_t end = now + ticks;
+
+    for (;;) {
+        uint64_t best = UINT64_MAX;
+        size_t best_index = 0;
+        uint32_t best_channels = 0;
+
+        for (size_t i = 0; i < FAKE_TIMER_COUNT; i++) {
+            uint32_t channels;
+            if (!fake_timer_regs[i].running) {
+                continue;
+            }
+            uint64_t tick = next_compare(&fake_timer_regs[i], &channels);
+            if (tick < best) {
+                best = tick;
+                best_index = i;
+                best_channels = channels;
+            }
+        }
+        if (best > end) {
+            break;
+        }
+        dispatch(best_index, best_channels, best);
+    }
+    if (end > now) {
+        advance(end - now);
+    }
+}
+
+void fake_nrfx_run_until(uint64_t tick) {
+    fake_nrfx_run((tick > now) ? tick - now : 0);
+}
+
+nrfx_err_t nrfx_timer_init(nrfx_timer_t const *p_instance, nrfx_timer_config_t const *p_config,
+                           nrfx_timer_event_handler_t timer_event_handler) {
+    timer_drivers[p_instance->instance_id] = (fake_timer_driver){
+        .handler = timer_event_handler,
+        .context = p_config->p_context,
+    };
+    return NRFX_SUCCESS;
+}
+
+void nrfx_timer_enable(nrfx_timer_t const *p_instance) {
+    NRF_TIMER_Type *t = p_instance->p_reg;
+
+    if (!t->running) {
+        t->running = true;
+        counter_restart(t, t->base, now);
+    }
+}
+
+void nrfx_timer_disable(nrfx_timer_t const *p_instance) {
+    NRF_TIMER_Type *t = p_instance->p_reg;
+
+    t->base = counter(t);
+    t->running = false;
+}
+
+bool nrfx_timer_is_enabled(nrfx_timer_t const *p_instance) {
+    return p_instance->p_reg->running;
+}
+
+void nrfx_timer_clear(nrfx_timer_t const *p_instance) {
+    counter_restart(p_instance->p_reg, 0, now);
+}
+
+uint32_t nrfx_timer_capture(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel) {
+    p_instance->p_reg->CC[cc_channel] = counter(p_instance->p_reg);
+    return p_instance->p_reg->CC[cc_channel];
+}
+
+uint32_t nrfx_timer_capture_get(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel) {
+    return p_instance->p_reg->CC[cc_channel];
+}
+
+void nrfx_timer_compare(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel,
+                        uint32_t cc_value, bool enable_int) {
+    NRF_TIMER_Type *t = p_instance->p_reg;
+
+    t->CC[cc_channel] = cc_value;
+    if (enable_int) {
+        t->INTEN |= 1UL << cc_channel;
+    } else {
+        t->INTEN &= ~(1UL << cc_channel);
+    }
+}
+
+void nrfx_timer_extended_compare(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel,
+                                 uint32_t cc_value, nrf_timer_short_mask_t timer_short_mask,
+                                 bool enable_int) {
+    p_instance->p_reg->SHORTS &= ~(1UL << cc_channel);
+    p_instance->p_reg->SHORTS |= timer_short_mask;
+    nrfx_timer_compare(p_instance, cc_channel, cc_value, enable_int);
+}
+
+uint32_t nrfx_timer_us_to_ticks(nrfx_timer_t const *p_instance, uint32_t time_us) {
+    ARG_UNUSED(p_instance);
+    return (uint32_t)((uint64_t)time_us * (FAKE_TIMER_FREQUENCY / 1000000));
+}
+
+// ---------------------------------------------------------------- GPIO
+
+void nrf_gpio_cfg_output(uint32_t pin_number) {
+    ARG_UNUSED(pin_number);
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number) {
+    gpio_levels[pin_number >> 5][pin_number & 0x1F] = 1;
+    trace(FAKE_TRACE_PIN_SET, pin_number, 0);
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number) {
+    gpio_levels[pin_number >> 5][pin_number & 0x1F] = 0;
+    last_cs_low = pin_number;
+    trace(FAKE_TRACE_PIN_CLEAR, pin_number, 0);
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) {
+    return gpio_levels[pin_number >> 5][pin_number & 0x1F];
+}
+
+uint32_t nrf_gpio_pin_out_read(uint32_t pin_number) {
+    return nrf_gpio_pin_read(pin_number);
+}
+
+uint32_t fake_gpio_level(uint32_t pin) {
+    return nrf_gpio_pin_read(pin);
+}
+
+// ---------------------------------------------------------------- SPIM
+
+nrfx_err_t nrfx_spim_init(nrfx_spim_t const *p_instance, nrfx_spim_config_t const *p_config,
+                          nrfx_spim_evt_handler_t handler, void *p_context) {
+    ARG_UNUSED(p_instance);
+    ARG_UNUSED(handler);
+    ARG_UNUSED(p_context);
+    spim_frequency = p_config->frequency;
+    return NRFX_SUCCESS;
+}
+
+// Non-blocking like the driver with an event handler: the CPU pays for
+// starting the transfer and the bus stays busy for the bits on the wire.
+nrfx_err_t nrfx_spim_xfer(nrfx_spim_t const *p_instance, nrfx_spim_xfer_desc_t const *p_xfer_desc,
+                          uint32_t flags) {
+    ARG_UNUSED(p_instance);
+
+    if (now < spim_busy_until) {
+        fake_spim_busy_errors++;
+        return NRFX_ERROR_BUSY;
+    }
+    uint16_t code = 0;
+    if (p_xfer_desc->tx_length >= 2) {
+        code = (p_xfer_desc->p_tx_buffer[0] << 8) | p_xfer_desc->p_tx_buffer[1];
+    }
+    if (!(flags & NRFX_SPIM_FLAG_HOLD_XFER)) {
+        trace(FAKE_TRACE_DAC, last_cs_low, code);
+        uint64_t bits = 8ULL * MAX(p_xfer_desc->tx_length, p_xfer_desc->rx_length);
+        spim_busy_until = now + (bits * FAKE_TIMER_FREQUENCY) / spim_frequency;
+    }
+    advance(FAKE_SPIM_START_TICKS);
+    return NRFX_SUCCESS;
+}
+
+uint32_t nrfx_spim_start_task_address_get(nrfx_spim_t const *p_instance) {
+    ARG_UNUSED(p_instance);
+    return 0;
+}
+
+uint32_t nrfx_spim_end_event_address_get(nrfx_spim_t const *p_instance) {
+    ARG_UNUSED(p_instance);
+    return 0;
+}
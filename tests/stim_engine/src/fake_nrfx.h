@@ -0,0 +1,58 @@
+#ifndef FAKE_NRFX_SIM_H
+#define FAKE_NRFX_SIM_H
+
+#include <nrfx_timer.h>
+#include "jitter_hist.h"
+
+// Virtual-time model of TIMER, SPIM and GPIO. Nothing happens between
+// fake_nrfx_run() calls; inside them the clock jumps from one compare event
+// to the next and the registered timer handler runs at each, so every run is
+// exactly repeatable. Time only passes inside the handler where the modelled
+// hardware costs it (interrupt entry, starting an SPI transfer).
+#define FAKE_CPU_FREQUENCY 64000000
+#define FAKE_IRQ_LATENCY_TICKS 3        // exception entry, ~12 CPU cycles
+#define FAKE_SPIM_START_TICKS 8         // driver call and EasyDMA start, 0.5 us
+#define FAKE_TRACE_MAX 4096
+#define FAKE_EVENT_NONE 0xFF
+
+typedef enum {
+    FAKE_TRACE_PIN_SET,
+    FAKE_TRACE_PIN_CLEAR,
+    FAKE_TRACE_DAC,             // pin: chip select low at the start, code: word sent
+} fake_trace_type;
+
+typedef struct {
+    uint64_t tick;              // virtual time of the pin change or transfer start
+    uint64_t event_tick;        // compare event being handled
+    uint32_t pin;
+    uint16_t code;
+    uint8_t type;               // fake_trace_type
+    uint8_t event;              // compare channel being handled, or FAKE_EVENT_NONE
+} fake_trace_entry;
+
+typedef struct {
+    // Per compare channel of the handled timer
+    jitter_hist entry_latency;  // handler start after the compare event, ticks
+    jitter_hist handler_cycles; // host CPU cycles spent in the handler
+    uint32_t late;              // events that fired while the handler was busy
+} fake_event_stats;
+
+extern fake_trace_entry fake_trace[FAKE_TRACE_MAX];
+extern size_t fake_trace_count;
+extern fake_event_stats fake_stats[NRF_TIMER_CC_COUNT];
+extern uint32_t fake_spim_busy_errors;
+
+void fake_nrfx_reset(void);
+// Clear fake_stats and fake_spim_busy_errors only, the simulation goes on
+void fake_nrfx_reset_stats(void);
+uint64_t fake_nrfx_now(void);
+// Run the simulation for ticks of virtual time
+void fake_nrfx_run(uint64_t ticks);
+// Run up to and including tick; returns at once if a handler already ran past it
+void fake_nrfx_run_until(uint64_t tick);
+void fake_nrfx_clear_trace(void);
+// One line per entry: tick, pin change or DAC code, and the event handled
+void fake_nrfx_print_trace(void);
+uint32_t fake_gpio_level(uint32_t pin);
+
+#endif // FAKE_NRFX_SIM_H
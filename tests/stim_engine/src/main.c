@@ -0,0 +1,177 @@
+#include <zephyr/ztest.h>
+#include "stim_engine.h"
+#include "timer.h"
+#include "spi.h"
+#include "data.h"
+
+// Power-on defaults, in ticks
+#define PERIOD (DEFAULT_STIM_PERIOD * TICKS_PER_US)
+#define EVENT1 (DEFAULT_PULSE_WIDTH * TICKS_PER_US)
+#define EVENT2 ((DEFAULT_PULSE_WIDTH + SWITCH_PERIOD) * TICKS_PER_US)
+#define EVENT3 ((2 * DEFAULT_PULSE_WIDTH + SWITCH_PERIOD) * TICKS_PER_US)
+#define DAC1_CS NRF_GPIO_PIN_MAP(0, DAC1_CS_PIN)
+#define DAC2_CS NRF_GPIO_PIN_MAP(0, DAC2_CS_PIN)
+
+void stim_engine_start(void) {
+    fake_nrfx_reset();
+    // spi.c initial codes, changed by earlier runs
+    dac1_buf_tx[0] = 0x52;
+    dac1_buf_tx[1] = 0x53;
+    dac2_buf_tx[0] = 0x54;
+    dac2_buf_tx[1] = 0x55;
+    spi_init();
+    timer_init();
+}
+
+void stim_engine_send_setting(uint16_t amplitude, uint16_t pulse_width_us, uint16_t frequency_hz) {
+    stim_setting setting = {
+        .DAC_amplitude = amplitude,
+        .pulse_width = pulse_width_us,
+        .frequency = frequency_hz,
+    };
+    process_received_data(&settings, (uint8_t *)&setting, sizeof(setting));
+}
+
+const fake_trace_entry *stim_engine_find(size_t *index, fake_trace_type type, uint32_t pin) {
+    for (; *index < fake_trace_count; (*index)++) {
+        const fake_trace_entry *entry = &fake_trace[*index];
+        if ((entry->type == type) && (entry->pin == pin)) {
+            (*index)++;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    stim_engine_start();
+}
+
+static void assert_entry(const fake_trace_entry *entry, uint64_t event_tick, uint8_t event) {
+    zassert_not_null(entry);
+    zassert_equal(entry->event_tick, event_tick);
+    zassert_equal(entry->event, event);
+    zassert_equal(entry->tick, event_tick + FAKE_IRQ_LATENCY_TICKS);
+}
+
+ZTEST(stim_engine, test_default_edges) {
+    const fake_trace_entry *entry;
+    size_t index = 0;
+
+    fake_nrfx_run(PERIOD + EVENT1);
+    fake_nrfx_print_trace();
+
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+    assert_entry(entry, EVENT1, 1);
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_SET, CATHODE_PIN);
+    assert_entry(entry, EVENT1, 1);
+
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_SET, PHASE_PIN);
+    assert_entry(entry, EVENT2, 2);
+    entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC2_CS);
+    assert_entry(entry, EVENT2, 2);
+    zassert_equal(entry->code, 0x5455);
+
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+    assert_entry(entry, EVENT3, 3);
+
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_SET, PHASE_PIN);
+    assert_entry(entry, PERIOD, 0);
+    entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC1_CS);
+    assert_entry(entry, PERIOD, 0);
+    zassert_equal(entry->code, 0x5253);
+
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+    assert_entry(entry, PERIOD + EVENT1, 1);
+    zassert_equal(fake_gpio_level(PHASE_PIN), 0);
+    zassert_equal(fake_gpio_level(DAC1_CS), 1);
+}
+
+ZTEST(stim_engine, test_setting_applies_next_period) {
+    const uint64_t period = 10000 * TICKS_PER_US;    // 100 Hz
+    const uint64_t event1 = 100 * TICKS_PER_US;
+    const fake_trace_entry *entry;
+    size_t index = 0;
+
+    // Mid-pulse, between EVENT1 and EVENT2
+    fake_nrfx_run(EVENT1 + 1000);
+    stim_engine_send_setting(0x1234, 100, 100);
+    fake_nrfx_run_until(PERIOD + 2 * period);
+
+    // The pulse in flight finishes on the old codes and timing
+    entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC2_CS);
+    assert_entry(entry, EVENT2, 2);
+    zassert_equal(entry->code, 0x5455);
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+    assert_entry(entry, EVENT3, 3);
+
+    // All of the setting at once from the next period on
+    for (uint64_t start = PERIOD; start <= PERIOD + 2 * period; start += period) {
+        entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC1_CS);
+        assert_entry(entry, start, 0);
+        zassert_equal(entry->code, 0x1234);
+        if (start < PERIOD + 2 * period) {
+            entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+            assert_entry(entry, start + event1, 1);
+        }
+    }
+    zassert_equal(get_stim_period_us(), 10000);
+}
+
+ZTEST(stim_engine, test_program_begin_is_not_a_setting) {
+    // CMD_PROGRAM_BEGIN, seq 0x0102, 3 entries, reserved
+    uint8_t begin[] = {CMD_MAGIC, CMD_PROGRAM_BEGIN, 0x02, 0x01, 3, 0, 0, 0};
+    stim_setting before_begin = settings;
+    uint32_t period_us = get_stim_period_us();
+    const fake_trace_entry *entry;
+    size_t index = 0;
+
+    zassert_not_equal(sizeof(begin), sizeof(stim_setting));
+    process_received_data(&settings, begin, sizeof(begin));
+    zassert_mem_equal(&settings, &before_begin, sizeof(settings));
+
+    // The train keeps its codes and timing
+    fake_nrfx_run(PERIOD + EVENT1);
+    entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC1_CS);
+    assert_entry(entry, PERIOD, 0);
+    zassert_equal(entry->code, 0x5253);
+    zassert_equal(get_stim_period_us(), period_us);
+}
+
+ZTEST(stim_engine, test_rejected_setting_keeps_timing) {
+    size_t index = 0;
+
+    stim_engine_send_setting(0x1234, 0, 0);
+    fake_nrfx_run(PERIOD + EVENT1);
+
+    // Only the amplitude changes, from the first period on
+    const fake_trace_entry *entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+    assert_entry(entry, EVENT1, 1);
+    entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC2_CS);
+    assert_entry(entry, EVENT2, 2);
+    zassert_equal(entry->code, 0x5455);
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+    assert_entry(entry, EVENT3, 3);
+    entry = stim_engine_find(&index, FAKE_TRACE_DAC, DAC1_CS);
+    assert_entry(entry, PERIOD, 0);
+    zassert_equal(entry->code, 0x1234);
+    entry = stim_engine_find(&index, FAKE_TRACE_PIN_CLEAR, PHASE_PIN);
+    assert_entry(entry, PERIOD + EVENT1, 1);
+}
+
+ZTEST(stim_engine, test_edge_latency) {
+    fake_nrfx_run(3 * PERIOD);
+
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        jitter_hist_snapshot snapshot;
+
+        jitter_hist_snapshot_get(&fake_stats[ch].entry_latency, &snapshot);
+        zassert_equal(snapshot.count, 3);
+        zassert_equal(snapshot.max, FAKE_IRQ_LATENCY_TICKS);
+        zassert_equal(fake_stats[ch].late, 0);
+    }
+    zassert_equal(fake_spim_busy_errors, 0);
+}
+
+ZTEST_SUITE(stim_engine, NULL, NULL, before, NULL, NULL);
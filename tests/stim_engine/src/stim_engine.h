@@ -0,0 +1,20 @@
+#ifndef STIM_ENGINE_H
+#define STIM_ENGINE_H
+
+#include <hal/nrf_gpio.h>
+#include "fake_nrfx.h"
+
+#define TICKS_PER_US (FAKE_TIMER_FREQUENCY / 1000000)
+#define PHASE_PIN NRF_GPIO_PIN_MAP(1, 3)
+#define ANODE_PIN NRF_GPIO_PIN_MAP(1, 0)
+#define CATHODE_PIN NRF_GPIO_PIN_MAP(1, 1)
+
+// Fresh simulation with the firmware's power-on defaults and the
+// stimulation timer running from tick 0
+void stim_engine_start(void);
+// Legacy stim_setting write, as received over NUS
+void stim_engine_send_setting(uint16_t amplitude, uint16_t pulse_width_us, uint16_t frequency_hz);
+// Next trace entry of type on pin at or after *index, NULL if none
+const fake_trace_entry *stim_engine_find(size_t *index, fake_trace_type type, uint32_t pin);
+
+#endif // STIM_ENGINE_H
@@ -0,0 +1,90 @@
+#include <zephyr/ztest.h>
+#include "stim_program.h"
+
+#define PHASE_PIN   ((1 << 5) | 3)     // P1.03
+#define SWITCH0_PIN ((1 << 5) | 0)     // P1.00
+#define SWITCH1_PIN ((1 << 5) | 1)     // P1.01
+#define OTHER_PIN   ((0 << 5) | 16)    // P0.16
+
+static const uint32_t allowed[STIM_PROGRAM_PORTS] = {0, BIT(0) | BIT(1) | BIT(3)};
+static stim_program program;
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    stim_program_reset(&program);
+}
+
+ZTEST(stim_program, test_biphasic_entries) {
+    zassert_ok(stim_program_build_biphasic(&program, 1000, 100, 20, 0x9000, 0x7000,
+                                           PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN));
+    zassert_equal(program.count, 4);
+    zassert_equal(stim_program_period(&program), 1000);
+
+    const stim_program_entry *e = program.entries;
+    zassert_equal(e[0].delta_ticks, 1000 - 220);
+    zassert_equal(e[0].port, 1);
+    zassert_equal(e[0].set_mask, BIT(3));
+    zassert_equal(e[0].clr_mask, 0);
+    zassert_equal(e[0].dac, STIM_PROGRAM_DAC1);
+    zassert_equal(e[0].dac_code, 0x9000);
+
+    zassert_equal(e[1].delta_ticks, 100);
+    zassert_equal(e[1].set_mask, BIT(0) | BIT(1));
+    zassert_equal(e[1].clr_mask, BIT(3));
+    zassert_equal(e[1].dac, STIM_PROGRAM_DAC_NONE);
+
+    zassert_equal(e[2].delta_ticks, 20);
+    zassert_equal(e[2].dac, STIM_PROGRAM_DAC2);
+    zassert_equal(e[2].dac_code, 0x7000);
+
+    zassert_equal(e[3].delta_ticks, 100);
+    zassert_equal(e[3].clr_mask, BIT(3));
+
+    zassert_ok(stim_program_validate(&program, 20, allowed));
+}
+
+ZTEST(stim_program, test_biphasic_rejects_bad_shapes) {
+    zassert_equal(stim_program_build_biphasic(&program, 200, 100, 20, 0, 0,
+                                              PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN), -EINVAL);
+    zassert_equal(stim_program_build_biphasic(&program, 1000, 0, 20, 0, 0,
+                                              PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN), -EINVAL);
+    zassert_equal(stim_program_build_biphasic(&program, 1000, 100, 20, 0, 0,
+                                              PHASE_PIN, OTHER_PIN, SWITCH1_PIN), -EINVAL);
+}
+
+ZTEST(stim_program, test_validate_limits) {
+    stim_program_entry entry = {.delta_ticks = 50, .port = 1, .set_mask = BIT(3)};
+
+    zassert_equal(stim_program_validate(&program, 20, allowed), -EINVAL);
+
+    zassert_ok(stim_program_add(&program, &entry));
+    zassert_ok(stim_program_validate(&program, 20, allowed));
+    zassert_equal(stim_program_validate(&program, 51, allowed), -ERANGE);
+
+    program.entries[0].set_mask = BIT(5);
+    zassert_equal(stim_program_validate(&program, 20, allowed), -EINVAL);
+
+    program.entries[0].set_mask = BIT(3);
+    program.entries[0].clr_mask = BIT(3);
+    zassert_equal(stim_program_validate(&program, 20, allowed), -EINVAL);
+
+    program.entries[0].clr_mask = 0;
+    program.entries[0].port = STIM_PROGRAM_PORTS;
+    zassert_equal(stim_program_validate(&program, 20, allowed), -EINVAL);
+
+    program.entries[0].port = 1;
+    program.entries[0].dac = STIM_PROGRAM_DAC2 + 1;
+    zassert_equal(stim_program_validate(&program, 20, allowed), -EINVAL);
+}
+
+ZTEST(stim_program, test_table_full) {
+    stim_program_entry entry = {.delta_ticks = 50};
+
+    for (int i = 0; i < STIM_PROGRAM_MAX_ENTRIES; i++) {
+        zassert_ok(stim_program_add(&program, &entry));
+    }
+    zassert_equal(stim_program_add(&program, &entry), -ENOMEM);
+    zassert_equal(stim_program_period(&program), 50ULL * STIM_PROGRAM_MAX_ENTRIES);
+}
+
+ZTEST_SUITE(stim_program, NULL, NULL, before, NULL, NULL);
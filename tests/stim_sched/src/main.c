@@ -0,0 +1,226 @@
+#include <zephyr/ztest.h>
+#include "stim_sched.h"
+
+#define GUARD 10
+
+static stim_sched sched;
+
+static const stim_sched_config train = {
+    .period_ticks = 1000,
+    .pulse_width_ticks = 100,
+    .interphase_ticks = 20,
+    .amplitude = 0x9000,
+};
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    stim_sched_init(&sched, GUARD);
+}
+
+static void expect_edge(uint8_t channel, stim_sched_phase phase, uint32_t deadline) {
+    stim_sched_edge edge;
+
+    zassert_true(stim_sched_pop(&sched, &edge));
+    zassert_equal(edge.channel, channel, "channel %u", edge.channel);
+    zassert_equal(edge.phase, phase, "phase %u", edge.phase);
+    zassert_equal(edge.deadline, deadline, "deadline %u", edge.deadline);
+}
+
+ZTEST(stim_sched, test_single_channel_phases) {
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 500));
+
+    expect_edge(0, STIM_PHASE_CATHODIC, 500);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 600);
+    expect_edge(0, STIM_PHASE_ANODIC, 620);
+    expect_edge(0, STIM_PHASE_REST, 720);
+    expect_edge(0, STIM_PHASE_CATHODIC, 1500);
+    zassert_equal(sched.collisions, 0);
+}
+
+ZTEST(stim_sched, test_queue_orders_channels) {
+    stim_sched_config slow = train;
+    slow.period_ticks = 3000;
+
+    zassert_ok(stim_sched_configure(&sched, 1, &slow, 50));
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    expect_edge(1, STIM_PHASE_CATHODIC, 50);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 100);
+    expect_edge(0, STIM_PHASE_ANODIC, 120);
+    expect_edge(1, STIM_PHASE_INTERPHASE, 150);
+    expect_edge(1, STIM_PHASE_ANODIC, 170);
+    expect_edge(0, STIM_PHASE_REST, 220);
+    expect_edge(1, STIM_PHASE_REST, 270);
+    expect_edge(0, STIM_PHASE_CATHODIC, 1000);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 1100);
+}
+
+ZTEST(stim_sched, test_tie_goes_to_lower_channel) {
+    zassert_ok(stim_sched_configure(&sched, 2, &train, 0));
+    zassert_ok(stim_sched_configure(&sched, 1, &train, 0));
+
+    expect_edge(1, STIM_PHASE_CATHODIC, 0);
+    expect_edge(2, STIM_PHASE_CATHODIC, GUARD);
+    zassert_equal(sched.collisions, 1);
+    zassert_equal(sched.channels[2].collisions, 1);
+    zassert_equal(sched.channels[1].collisions, 0);
+}
+
+ZTEST(stim_sched, test_collision_shift_does_not_drift) {
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+    zassert_ok(stim_sched_configure(&sched, 1, &train, 4));
+
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    expect_edge(1, STIM_PHASE_CATHODIC, GUARD);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 100);
+    // The whole channel 1 pulse moves with its first edge...
+    expect_edge(1, STIM_PHASE_INTERPHASE, 110);
+    expect_edge(0, STIM_PHASE_ANODIC, 120);
+    expect_edge(1, STIM_PHASE_ANODIC, 130);
+    expect_edge(0, STIM_PHASE_REST, 220);
+    expect_edge(1, STIM_PHASE_REST, 230);
+    // ...but the next period still starts from 4
+    expect_edge(0, STIM_PHASE_CATHODIC, 1000);
+    expect_edge(1, STIM_PHASE_CATHODIC, 1010);
+    zassert_equal(sched.channels[1].cathodic_ticks, 100);
+}
+
+ZTEST(stim_sched, test_collision_keeps_phases_equal) {
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+    zassert_ok(stim_sched_configure(&sched, 1, &train, 25));
+
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    expect_edge(1, STIM_PHASE_CATHODIC, 25);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 100);
+    expect_edge(0, STIM_PHASE_ANODIC, 120);
+    // Channel 1 ends its cathodic phase 5 ticks late, so its anodic phase
+    // runs 5 ticks longer too
+    expect_edge(1, STIM_PHASE_INTERPHASE, 130);
+    expect_edge(1, STIM_PHASE_ANODIC, 150);
+    expect_edge(0, STIM_PHASE_REST, 220);
+    expect_edge(1, STIM_PHASE_REST, 255);
+}
+
+ZTEST(stim_sched, test_edges_make_way_for_pulse_ends) {
+    stim_sched_config late = train;
+
+    // Channel 1 starts just before channel 0 ends its anodic phase
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 100);
+    expect_edge(0, STIM_PHASE_ANODIC, 120);
+    zassert_ok(stim_sched_configure(&sched, 1, &late, 215));
+    expect_edge(0, STIM_PHASE_REST, 220);
+    expect_edge(1, STIM_PHASE_CATHODIC, 220 + GUARD);
+
+    // An anodic phase that would end within a guard of another one starts late
+    stim_sched_init(&sched, GUARD);
+    late.pulse_width_ticks = 75;
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+    zassert_ok(stim_sched_configure(&sched, 1, &late, 55));
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    expect_edge(1, STIM_PHASE_CATHODIC, 55);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 100);
+    expect_edge(0, STIM_PHASE_ANODIC, 120);
+    expect_edge(1, STIM_PHASE_INTERPHASE, 130);
+    expect_edge(1, STIM_PHASE_ANODIC, 155);
+    expect_edge(0, STIM_PHASE_REST, 220);
+    expect_edge(1, STIM_PHASE_REST, 230);
+}
+
+ZTEST(stim_sched, test_crowded_channels_stay_balanced) {
+    static const uint32_t periods[] = {1000, 1130, 770, 1290};
+    uint32_t start[STIM_SCHED_MAX_CHANNELS], end[STIM_SCHED_MAX_CHANNELS];
+    uint32_t last = 0;
+    stim_sched_edge edge;
+
+    for (uint8_t ch = 0; ch < ARRAY_SIZE(periods); ch++) {
+        stim_sched_config config = train;
+
+        config.period_ticks = periods[ch];
+        config.pulse_width_ticks = 60 + 13 * ch;
+        zassert_ok(stim_sched_configure(&sched, ch, &config, 7 * ch));
+    }
+    for (int i = 0; i < 4000; i++) {
+        zassert_true(stim_sched_pop(&sched, &edge));
+        if (i > 0) {
+            zassert_true(edge.deadline - last >= GUARD, "edge %d %u after %u", i,
+                         edge.deadline, last);
+        }
+        last = edge.deadline;
+        if (edge.phase == STIM_PHASE_CATHODIC || edge.phase == STIM_PHASE_ANODIC) {
+            start[edge.channel] = edge.deadline;
+        } else if (edge.phase == STIM_PHASE_INTERPHASE) {
+            end[edge.channel] = edge.deadline - start[edge.channel];
+        } else {
+            zassert_equal(edge.deadline - start[edge.channel], end[edge.channel],
+                          "channel %u unbalanced at %u", edge.channel, edge.deadline);
+        }
+    }
+    zassert_true(sched.collisions > 0);
+}
+
+ZTEST(stim_sched, test_chained_collisions) {
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+    zassert_ok(stim_sched_configure(&sched, 1, &train, 0));
+    zassert_ok(stim_sched_configure(&sched, 2, &train, 0));
+
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    expect_edge(1, STIM_PHASE_CATHODIC, GUARD);
+    expect_edge(2, STIM_PHASE_CATHODIC, 2 * GUARD);
+    zassert_equal(sched.collisions, 3);
+}
+
+ZTEST(stim_sched, test_reconfigure_at_period_boundary) {
+    stim_sched_config wide = train;
+    wide.pulse_width_ticks = 200;
+
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    zassert_ok(stim_sched_configure(&sched, 0, &wide, 50));
+
+    // The pulse in flight keeps the old width
+    expect_edge(0, STIM_PHASE_INTERPHASE, 100);
+    expect_edge(0, STIM_PHASE_ANODIC, 120);
+    expect_edge(0, STIM_PHASE_REST, 220);
+    expect_edge(0, STIM_PHASE_CATHODIC, 1000);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 1200);
+}
+
+ZTEST(stim_sched, test_stop_after_current_pulse) {
+    stim_sched_config stop = {0};
+    uint32_t deadline;
+
+    zassert_ok(stim_sched_configure(&sched, 0, &train, 0));
+    expect_edge(0, STIM_PHASE_CATHODIC, 0);
+    zassert_ok(stim_sched_configure(&sched, 0, &stop, 10));
+
+    expect_edge(0, STIM_PHASE_INTERPHASE, 100);
+    expect_edge(0, STIM_PHASE_ANODIC, 120);
+    expect_edge(0, STIM_PHASE_REST, 220);
+    zassert_false(stim_sched_peek(&sched, &deadline));
+    zassert_false(sched.channels[0].running);
+}
+
+ZTEST(stim_sched, test_counter_wrap) {
+    zassert_ok(stim_sched_configure(&sched, 0, &train, UINT32_MAX - 50));
+    zassert_ok(stim_sched_configure(&sched, 1, &train, 30));
+
+    expect_edge(0, STIM_PHASE_CATHODIC, UINT32_MAX - 50);
+    expect_edge(1, STIM_PHASE_CATHODIC, 30);
+    expect_edge(0, STIM_PHASE_INTERPHASE, 49);
+}
+
+ZTEST(stim_sched, test_invalid_configurations) {
+    stim_sched_config bad = train;
+
+    zassert_equal(stim_sched_configure(&sched, STIM_SCHED_MAX_CHANNELS, &train, 0), -EINVAL);
+    bad.pulse_width_ticks = 0;
+    zassert_equal(stim_sched_configure(&sched, 0, &bad, 0), -EINVAL);
+    bad.pulse_width_ticks = 490;
+    zassert_equal(stim_sched_configure(&sched, 0, &bad, 0), -EINVAL);
+    zassert_false(sched.channels[0].running);
+}
+
+ZTEST_SUITE(stim_sched, NULL, NULL, before, NULL, NULL);
@@ -0,0 +1,28 @@
+#include <errno.h>
+#include <string.h>
+#include "fake_stim_hal.h"
+
+fake_hal_channel fake_hal_channels[STIM_SEQ_MAX_CHANNELS];
+size_t fake_hal_channel_count;
+int fake_hal_fail_after = -1;
+
+void fake_stim_hal_reset(void) {
+    memset(fake_hal_channels, 0, sizeof(fake_hal_channels));
+    fake_hal_channel_count = 0;
+    fake_hal_fail_after = -1;
+}
+
+int stim_hal_connect(uint8_t event_mask, const stim_seq_task *tasks, uint8_t task_count) {
+    if ((fake_hal_fail_after >= 0) && (fake_hal_channel_count == (size_t)fake_hal_fail_after)) {
+        return -EIO;
+    }
+    fake_hal_channel *ch = &fake_hal_channels[fake_hal_channel_count++];
+    ch->event_mask = event_mask;
+    ch->task_count = task_count;
+    memcpy(ch->tasks, tasks, task_count * sizeof(tasks[0]));
+    return 0;
+}
+
+void stim_hal_disconnect_all(void) {
+    fake_hal_channel_count = 0;
+}
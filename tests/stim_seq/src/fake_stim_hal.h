@@ -0,0 +1,19 @@
+#ifndef FAKE_STIM_HAL_H
+#define FAKE_STIM_HAL_H
+
+#include "stim_hal.h"
+
+// Records what stim_seq_apply asked the hardware to wire up.
+typedef struct {
+    uint8_t event_mask;
+    uint8_t task_count;
+    stim_seq_task tasks[STIM_SEQ_MAX_TASKS];
+} fake_hal_channel;
+
+extern fake_hal_channel fake_hal_channels[STIM_SEQ_MAX_CHANNELS];
+extern size_t fake_hal_channel_count;
+extern int fake_hal_fail_after;     // fail the Nth connect, -1 never
+
+void fake_stim_hal_reset(void);
+
+#endif // FAKE_STIM_HAL_H
@@ -0,0 +1,147 @@
+#include <zephyr/ztest.h>
+#include "stim_seq.h"
+#include "fake_stim_hal.h"
+
+#define PHASE_PIN   ((1 << 5) | 3)     // P1.03
+#define SWITCH0_PIN ((1 << 5) | 0)     // P1.00
+#define SWITCH1_PIN ((1 << 5) | 1)     // P1.01
+#define DAC1_CS     16                 // P0.16
+#define DAC2_CS     26                 // P0.26
+
+static stim_seq_table table;
+
+static void before(void *fixture) {
+    ARG_UNUSED(fixture);
+    stim_seq_reset(&table);
+    fake_stim_hal_reset();
+}
+
+static const stim_seq_channel *find_channel(uint8_t event_mask) {
+    for (size_t c = 0; c < table.channel_count; c++) {
+        if (table.channels[c].event_mask == event_mask) {
+            return &table.channels[c];
+        }
+    }
+    return NULL;
+}
+
+static bool channel_has(const stim_seq_channel *ch, stim_seq_task_type type, uint32_t pin) {
+    for (uint8_t i = 0; i < ch->task_count; i++) {
+        if ((ch->tasks[i].type == type) && (ch->tasks[i].pin == pin)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ZTEST(stim_seq, test_biphasic_compiles_to_two_channels) {
+    zassert_ok(stim_seq_add_biphasic(&table, PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN));
+    zassert_equal(table.link_count, 8);
+    zassert_ok(stim_seq_compile(&table));
+    zassert_equal(table.channel_count, 2);
+
+    const stim_seq_channel *on = find_channel(BIT(STIM_EVT_COMPARE0) | BIT(STIM_EVT_COMPARE2));
+    const stim_seq_channel *off = find_channel(BIT(STIM_EVT_COMPARE1) | BIT(STIM_EVT_COMPARE3));
+    zassert_not_null(on);
+    zassert_not_null(off);
+
+    zassert_equal(on->task_count, 1);
+    zassert_true(channel_has(on, STIM_TASK_PIN_SET, PHASE_PIN));
+
+    zassert_equal(off->task_count, 3);
+    zassert_true(channel_has(off, STIM_TASK_PIN_CLR, PHASE_PIN));
+    zassert_true(channel_has(off, STIM_TASK_PIN_SET, SWITCH0_PIN));
+    zassert_true(channel_has(off, STIM_TASK_PIN_SET, SWITCH1_PIN));
+}
+
+ZTEST(stim_seq, test_dac_links_share_start_channel) {
+    zassert_ok(stim_seq_add_biphasic(&table, PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN));
+    zassert_ok(stim_seq_add_dac(&table, DAC1_CS, DAC2_CS));
+    zassert_ok(stim_seq_compile(&table));
+    zassert_equal(table.channel_count, 5);
+
+    const stim_seq_channel *on = find_channel(BIT(STIM_EVT_COMPARE0) | BIT(STIM_EVT_COMPARE2));
+    zassert_not_null(on);
+    zassert_equal(on->task_count, 2);
+    zassert_true(channel_has(on, STIM_TASK_PIN_SET, PHASE_PIN));
+    zassert_true(channel_has(on, STIM_TASK_SPIM_START, 0));
+
+    const stim_seq_channel *cs1 = find_channel(BIT(STIM_EVT_COMPARE4));
+    const stim_seq_channel *cs2 = find_channel(BIT(STIM_EVT_COMPARE5));
+    zassert_not_null(cs1);
+    zassert_not_null(cs2);
+    zassert_true(channel_has(cs1, STIM_TASK_PIN_CLR, DAC1_CS));
+    zassert_true(channel_has(cs2, STIM_TASK_PIN_CLR, DAC2_CS));
+
+    const stim_seq_channel *end = find_channel(BIT(STIM_EVT_SPIM_END));
+    zassert_not_null(end);
+    zassert_equal(end->task_count, 2);
+    zassert_true(channel_has(end, STIM_TASK_PIN_SET, DAC1_CS));
+    zassert_true(channel_has(end, STIM_TASK_PIN_SET, DAC2_CS));
+}
+
+ZTEST(stim_seq, test_waveform_links) {
+    zassert_ok(stim_seq_add_biphasic(&table, PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN));
+    zassert_ok(stim_seq_add_waveform(&table, DAC1_CS));
+    zassert_ok(stim_seq_compile(&table));
+    zassert_equal(table.channel_count, 6);
+
+    const stim_seq_channel *start = find_channel(BIT(STIM_EVT_COMPARE5));
+    const stim_seq_channel *stop = find_channel(BIT(STIM_EVT_COMPARE4));
+    const stim_seq_channel *sample = find_channel(BIT(STIM_EVT_SAMPLE));
+    zassert_not_null(start);
+    zassert_not_null(stop);
+    zassert_not_null(sample);
+    zassert_true(channel_has(start, STIM_TASK_SAMPLE_START, 0));
+    zassert_true(channel_has(stop, STIM_TASK_SAMPLE_STOP, 0));
+    zassert_true(channel_has(stop, STIM_TASK_SAMPLE_CLEAR, 0));
+    zassert_true(channel_has(sample, STIM_TASK_PIN_CLR, DAC1_CS));
+    zassert_true(channel_has(sample, STIM_TASK_SPIM_START, 0));
+}
+
+ZTEST(stim_seq, test_duplicate_links_are_merged) {
+    zassert_ok(stim_seq_add(&table, STIM_EVT_COMPARE0, STIM_TASK_PIN_SET, PHASE_PIN));
+    zassert_ok(stim_seq_add(&table, STIM_EVT_COMPARE0, STIM_TASK_PIN_SET, PHASE_PIN));
+    zassert_ok(stim_seq_compile(&table));
+    zassert_equal(table.channel_count, 1);
+    zassert_equal(table.channels[0].task_count, 1);
+}
+
+ZTEST(stim_seq, test_overlapping_event_sets_rejected) {
+    // COMPARE0 would have to publish to two different channels
+    zassert_ok(stim_seq_add(&table, STIM_EVT_COMPARE0, STIM_TASK_PIN_SET, PHASE_PIN));
+    zassert_ok(stim_seq_add(&table, STIM_EVT_COMPARE2, STIM_TASK_PIN_SET, PHASE_PIN));
+    zassert_ok(stim_seq_add(&table, STIM_EVT_COMPARE0, STIM_TASK_PIN_CLR, SWITCH0_PIN));
+    zassert_equal(stim_seq_compile(&table), -EINVAL);
+}
+
+ZTEST(stim_seq, test_invalid_event_and_table_full) {
+    zassert_equal(stim_seq_add(&table, STIM_EVT_COUNT, STIM_TASK_PIN_SET, PHASE_PIN), -EINVAL);
+
+    for (int i = 0; i < STIM_SEQ_MAX_LINKS; i++) {
+        zassert_ok(stim_seq_add(&table, STIM_EVT_COMPARE0, STIM_TASK_PIN_SET, i));
+    }
+    zassert_equal(stim_seq_add(&table, STIM_EVT_COMPARE0, STIM_TASK_PIN_SET, 0), -ENOMEM);
+}
+
+ZTEST(stim_seq, test_apply_wires_every_channel) {
+    zassert_ok(stim_seq_add_biphasic(&table, PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN));
+    zassert_ok(stim_seq_compile(&table));
+    zassert_ok(stim_seq_apply(&table));
+
+    zassert_equal(fake_hal_channel_count, table.channel_count);
+    for (size_t c = 0; c < table.channel_count; c++) {
+        zassert_equal(fake_hal_channels[c].event_mask, table.channels[c].event_mask);
+        zassert_equal(fake_hal_channels[c].task_count, table.channels[c].task_count);
+    }
+}
+
+ZTEST(stim_seq, test_apply_failure_releases_channels) {
+    zassert_ok(stim_seq_add_biphasic(&table, PHASE_PIN, SWITCH0_PIN, SWITCH1_PIN));
+    zassert_ok(stim_seq_compile(&table));
+    fake_hal_fail_after = 1;
+    zassert_equal(stim_seq_apply(&table), -EIO);
+    zassert_equal(fake_hal_channel_count, 0);
+}
+
+ZTEST_SUITE(stim_seq, NULL, NULL, before, NULL, NULL);
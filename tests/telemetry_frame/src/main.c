@@ -0,0 +1,43 @@
+#include <zephyr/ztest.h>
+#include "telemetry_frame.h"
+
+static uint8_t frame[TELEMETRY_FRAME_MAX];
+
+ZTEST(telemetry_frame, test_capacity) {
+    zassert_equal(telemetry_frame_capacity(0), 0);
+    zassert_equal(telemetry_frame_capacity(19), 0);
+    // Default ATT MTU of 23
+    zassert_equal(telemetry_frame_capacity(20), 1);
+    zassert_equal(telemetry_frame_capacity(244), 15);
+    // Never more than one frame buffer
+    zassert_equal(telemetry_frame_capacity(495), 15);
+}
+
+ZTEST(telemetry_frame, test_pack) {
+    const telemetry_record records[2] = {
+        {.timestamp = 0x11223344, .type = TELEMETRY_PULSE, .value = {7, 0x90007000}},
+        {.timestamp = 0x55667788, .type = TELEMETRY_JITTER, .index = 3, .value = {15, 0x1234}},
+    };
+    static const uint8_t expected[] = {
+        TELEMETRY_MAGIC, 2, 0x02, 0x01,
+        0x44, 0x33, 0x22, 0x11, TELEMETRY_PULSE, 0, 0, 0,
+        7, 0, 0, 0, 0x00, 0x70, 0x00, 0x90,
+        0x88, 0x77, 0x66, 0x55, TELEMETRY_JITTER, 3, 0, 0,
+        15, 0, 0, 0, 0x34, 0x12, 0, 0,
+    };
+
+    zassert_equal(telemetry_frame_pack(frame, sizeof(frame), 0x0102, records, 2),
+                  sizeof(expected));
+    zassert_mem_equal(frame, expected, sizeof(expected));
+}
+
+ZTEST(telemetry_frame, test_pack_limits) {
+    telemetry_record records[16] = {0};
+
+    zassert_equal(telemetry_frame_pack(frame, sizeof(frame), 0, records, 0), 0);
+    zassert_equal(telemetry_frame_pack(frame, sizeof(frame), 0, records, 16), 0);
+    zassert_equal(telemetry_frame_pack(frame, 20, 0, records, 1), 20);
+    zassert_equal(telemetry_frame_pack(frame, 35, 0, records, 2), 0);
+}
+
+ZTEST_SUITE(telemetry_frame, NULL, NULL, NULL, NULL, NULL);